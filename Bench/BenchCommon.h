@@ -0,0 +1,43 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define NOGDI
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace FLOOF::Bench {
+    // Nearest rank percentile of sorted values.
+    inline double Percentile(const std::vector<double>& sorted, double percent) {
+        if (sorted.empty())
+            return 0.0;
+        const size_t rank = static_cast<size_t>(percent / 100.0 * static_cast<double>(sorted.size() - 1) + 0.5);
+        return sorted[std::min(rank, sorted.size() - 1)];
+    }
+
+    // Peak resident set of the process. It never goes down, so measure small workloads before large ones.
+    inline uint64_t PeakMemoryBytes() {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters{};
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+            return counters.PeakWorkingSetSize;
+        return 0;
+#else
+        rusage usage{};
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0;
+#ifdef __APPLE__
+        return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+        return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+    }
+}
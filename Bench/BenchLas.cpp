@@ -0,0 +1,1149 @@
+// LAS loading benchmark. Writes a synthetic LAS 1.4 file (50M format 2 points by default), loads it with LasLoader
+// and prints read throughput, triangulation time, terrain and peak memory as JSON.
+//
+// floof_bench_las [--points 50000000] [--format 0-10] [--file <temp>/floof_bench.las] [--keep] [--seed 24301]
+//                 [--threads 0] [--verify] [--cache] [--tiles] [--tile-size 128] [--stream-budget 128] [--frames 600]
+//                 [--lod] [--chunk-size 64] [--cell-size 1] [--levels 1] [--normals]
+//                 [--voxel-size 0] [--octree] [--point-budget 1000000] [--quantize] [--text]
+//
+// --verify loads the file a second time on one thread and fails if the result differs from the threaded load.
+// --cache bakes a .floofterrain cache and times loading through it.
+// --tiles cuts the baked terrain into .flooftiles, flies a camera across it for --frames frames with a
+// TerrainStreamer limited to --stream-budget MB and checks every streamed tile against the loaded terrain.
+// --lod builds a TerrainLod with --chunk-size chunks from the loaded grid, checks that its finest level draws
+// the loaded mesh and reports the triangles selected from a few camera heights and pixel errors.
+// --cell-size sets the distance between height samples and --levels the number of grids in the pyramid,
+// the build time of every level is reported.
+// --normals times the grid normals against the scalar cross product pass they replaced, on all workers and on one,
+// and checks that normals made per tile match the ones made for the whole grid.
+// --voxel-size decimates the loaded points to voxels of that size on all workers and on one, checks that both
+// agree and that every voxel holds one point, and reports the points and bytes left for drawing.
+// --octree builds a PointOctree from the loaded points on all workers and on one, checks that both agree, that
+// every point is in exactly one node and inside it, and reports what a few camera positions select under
+// --point-budget.
+// --quantize encodes the loaded points, the grid normals and random directions to the quantized vertex formats,
+// checks the round trip errors and reports the bytes saved.
+// --text writes the loaded points as an XYZ text export and as a .visim file next to --file, reads both with the
+// loaders and with the stringstream parsing they replaced, checks that the points agree and reports MB/s.
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "Components.h"
+#include "HeightGrid.h"
+#include "LasLoader.h"
+#include "Parallel.h"
+#include "PointCloud.h"
+#include "PointOctree.h"
+#include "Quantize.h"
+#include "Random.h"
+#include "TerrainCache.h"
+#include "TerrainLod.h"
+#include "TerrainStreamer.h"
+#include "Timer.h"
+#include "Utils.h"
+
+using namespace FLOOF;
+
+namespace {
+    struct BenchSettings {
+        uint64_t Points{ 50'000'000 };
+        uint8_t Format{ 2 };
+        std::string File;
+        bool Keep{ false };
+        uint64_t Seed{ Random::s_DefaultSeed };
+        // 0 uses every hardware thread.
+        uint32_t Threads{ 0 };
+        bool Verify{ false };
+        bool Cache{ false };
+        bool Tiles{ false };
+        uint32_t TileSize{ TerrainTileSet::DefaultTileSize };
+        uint64_t StreamBudgetMB{ 128 };
+        uint32_t Frames{ 600 };
+        bool Lod{ false };
+        uint32_t ChunkSize{ TerrainLod::DefaultChunkSize };
+        float CellSize{ 1.f };
+        uint32_t Levels{ 1 };
+        bool Normals{ false };
+        float VoxelSize{ 0.f };
+        bool Octree{ false };
+        uint64_t PointBudget{ 1'000'000 };
+        bool Quantize{ false };
+        bool Text{ false };
+    };
+
+    struct StreamResult {
+        double TileWriteSeconds{ 0.0 };
+        uint32_t TileCount{ 0 };
+        std::vector<double> UpdateMs;
+        size_t PeakResidentBytes{ 0 };
+        size_t BudgetBytes{ 0 };
+        size_t MaxTileBytes{ 0 };
+        uint64_t Loaded{ 0 };
+        uint64_t Evicted{ 0 };
+        uint32_t TilesChecked{ 0 };
+        bool Matches{ false };
+    };
+
+    struct LodView {
+        float CameraHeight;
+        float PixelError;
+        uint32_t Triangles{ 0 };
+        double SelectMs{ 0.0 };
+    };
+
+    struct LodResult {
+        double BuildSeconds{ 0.0 };
+        uint32_t ChunkSize{ 0 };
+        uint32_t Chunks{ 0 };
+        uint32_t Levels{ 0 };
+        uint64_t FullTriangles{ 0 };
+        size_t Bytes{ 0 };
+        size_t ExpectedBytes{ 0 };
+        std::vector<LodView> Views;
+        bool Matches{ false };
+    };
+
+    struct NormalResult {
+        double LegacySeconds{ 0.0 };
+        double SerialSeconds{ 0.0 };
+        double Seconds{ 0.0 };
+        float MaxErrorDegrees{ 0.f };
+        bool Matches{ false };
+    };
+
+    struct DecimationResult {
+        double Seconds{ 0.0 };
+        double SerialSeconds{ 0.0 };
+        size_t Points{ 0 };
+        bool Matches{ false };
+    };
+
+    struct OctreeView {
+        float CameraHeight;
+        bool LookingAway;
+        uint32_t Nodes{ 0 };
+        uint64_t Points{ 0 };
+        double SelectMs{ 0.0 };
+    };
+
+    struct OctreeResult {
+        double Seconds{ 0.0 };
+        double SerialSeconds{ 0.0 };
+        uint32_t Nodes{ 0 };
+        uint32_t Depth{ 0 };
+        size_t Bytes{ 0 };
+        std::vector<OctreeView> Views;
+        bool Matches{ false };
+    };
+
+    struct QuantizeResult {
+        double Seconds{ 0.0 };
+        size_t PointBytes{ 0 };
+        size_t QuantizedPointBytes{ 0 };
+        size_t TerrainVertexBytes{ 0 };
+        size_t QuantizedTerrainVertexBytes{ 0 };
+        float MaxPositionSteps{ 0.f };
+        float MaxColorError{ 0.f };
+        float NormalMaxDegrees{ 0.f };
+        float NormalMeanDegrees{ 0.f };
+        bool Matches{ false };
+    };
+
+    struct TextResult {
+        size_t Bytes{ 0 };
+        double LegacySeconds{ 0.0 };
+        double Seconds{ 0.0 };
+        size_t Points{ 0 };
+        size_t VisimBytes{ 0 };
+        double VisimLegacySeconds{ 0.0 };
+        double VisimSeconds{ 0.0 };
+        bool Matches{ false };
+    };
+
+    // Ground extent of the generated survey in meters, heights go up to MaxHeight.
+    constexpr double s_Extent = 1000.0;
+    constexpr double s_MaxHeight = 100.0;
+    constexpr double s_Scale = 0.001;
+    // Worst octahedral normal error accepted by --quantize.
+    constexpr float s_MaxNormalDegrees = 1.f;
+    constexpr uint32_t s_RandomNormals = 1'000'000;
+    constexpr uint16_t s_HeaderSize = 375;
+
+    template<typename T>
+    void Append(std::vector<char>& buffer, const T& value) {
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    std::vector<char> MakeHeader(const BenchSettings& settings) {
+        // Legacy counts are only allowed for formats 0-5 below 4G points.
+        const bool legacy = settings.Format < 6 && settings.Points <= UINT32_MAX;
+        const uint32_t legacyPoints = legacy ? static_cast<uint32_t>(settings.Points) : 0;
+
+        std::vector<char> header;
+        header.insert(header.end(), { 'L', 'A', 'S', 'F' });
+        Append<uint16_t>(header, 0);            // source id
+        Append<uint16_t>(header, 0);            // global encoding
+        header.insert(header.end(), 16, 0);     // GUID
+        Append<uint8_t>(header, 1);             // version 1.4
+        Append<uint8_t>(header, 4);
+        header.insert(header.end(), 32, 0);     // system identifier
+        char software[32]{ "floof_bench_las" };
+        header.insert(header.end(), software, software + 32);
+        Append<uint16_t>(header, 1);            // creation day
+        Append<uint16_t>(header, 2022);         // creation year
+        Append<uint16_t>(header, s_HeaderSize);
+        Append<uint32_t>(header, s_HeaderSize); // offset to point data
+        Append<uint32_t>(header, 0);            // variable length records
+        Append<uint8_t>(header, settings.Format);
+        Append<uint16_t>(header, lasPointFormats[settings.Format].size);
+        Append<uint32_t>(header, legacyPoints);
+        for (int i = 0; i < 5; i++)
+            Append<uint32_t>(header, i == 0 ? legacyPoints : 0);
+        for (int i = 0; i < 3; i++)
+            Append<double>(header, s_Scale);
+        for (int i = 0; i < 3; i++)
+            Append<double>(header, 0.0);
+        Append<double>(header, s_Extent);       // max x, min x
+        Append<double>(header, 0.0);
+        Append<double>(header, s_Extent);       // max y, min y
+        Append<double>(header, 0.0);
+        Append<double>(header, s_MaxHeight);    // max z, min z
+        Append<double>(header, 0.0);
+        Append<uint64_t>(header, 0);            // waveform data packets
+        Append<uint64_t>(header, 0);            // first extended variable length record
+        Append<uint32_t>(header, 0);            // extended variable length records
+        Append<uint64_t>(header, settings.Points);
+        for (int i = 0; i < 15; i++)
+            Append<uint64_t>(header, i == 0 ? settings.Points : 0);
+        return header;
+    }
+
+    // Rolling hills with a little noise, so the height grid has something to average. Fields the loader
+    // does not read are left zero.
+    bool GenerateLas(const BenchSettings& settings) {
+        std::ofstream file(settings.File, std::ios::binary);
+        if (!file)
+            return false;
+
+        const auto header = MakeHeader(settings);
+        file.write(header.data(), header.size());
+
+        const lasPointFormat format = lasPointFormats[settings.Format];
+        Random random(settings.Seed);
+        constexpr uint64_t chunkPoints = 1 << 20;
+        std::vector<char> chunk;
+        for (uint64_t written = 0; written < settings.Points;) {
+            const uint64_t points = std::min(chunkPoints, settings.Points - written);
+            chunk.assign(points * format.size, 0);
+            for (uint64_t i = 0; i < points; i++) {
+                char* record = chunk.data() + i * format.size;
+                const double x = random.Double(0.0, s_Extent);
+                const double y = random.Double(0.0, s_Extent);
+                const double z = (0.5 + 0.25 * (std::sin(x * 0.01) + std::cos(y * 0.013))) * s_MaxHeight * 0.9 + random.Double(0.0, s_MaxHeight * 0.05);
+                const int32_t position[3]{ static_cast<int32_t>(x / s_Scale), static_cast<int32_t>(y / s_Scale), static_cast<int32_t>(z / s_Scale) };
+                std::memcpy(record, position, sizeof(position));
+                if (format.rgbOffset != 0) {
+                    const uint16_t rgb[3]{ static_cast<uint16_t>(random.Int(0, 65535)), static_cast<uint16_t>(random.Int(0, 65535)), static_cast<uint16_t>(random.Int(0, 65535)) };
+                    std::memcpy(record + format.rgbOffset, rgb, sizeof(rgb));
+                }
+            }
+            file.write(chunk.data(), chunk.size());
+            written += points;
+        }
+        return static_cast<bool>(file);
+    }
+
+    // Bit for bit comparison of the first levels of the height grids, everything else is derived from them.
+    bool SameTerrain(LasLoader& a, LasLoader& b, uint32_t levels = 1) {
+        if (a.GetMinY() != b.GetMinY() || a.GetLevelCount() < levels || b.GetLevelCount() < levels)
+            return false;
+        for (uint32_t level = 0; level < levels; level++) {
+            const auto& gridA = a.GetHeightGrid(level);
+            const auto& gridB = b.GetHeightGrid(level);
+            if (gridA.Width != gridB.Width || gridA.Height != gridB.Height || gridA.CellSize != gridB.CellSize
+                || gridA.Heights != gridB.Heights || gridA.Colors != gridB.Colors)
+                return false;
+        }
+        return true;
+    }
+
+    bool SamePoints(const LasLoader& a, const LasLoader& b) {
+        const auto& pointsA = a.GetPointData();
+        const auto& pointsB = b.GetPointData();
+        if (pointsA.size() != pointsB.size())
+            return false;
+        for (size_t i = 0; i < pointsA.size(); i++) {
+            if (pointsA[i].Pos != pointsB[i].Pos || pointsA[i].Color != pointsB[i].Color)
+                return false;
+        }
+        return true;
+    }
+
+    // Same as SameTerrain, plus the decoded points.
+    bool SameOutput(LasLoader& a, LasLoader& b) {
+        return SamePoints(a, b) && a.GetLevelCount() == b.GetLevelCount() && SameTerrain(a, b, a.GetLevelCount());
+    }
+
+    // Every square of a streamed tile must hold the same triangles as the terrain built in one piece.
+    bool SameTriangles(const TerrainTile& tile, const HeightGrid& terrain) {
+        auto same = [](const Triangle& a, const Triangle& b) {
+            return a.A == b.A && a.B == b.B && a.C == b.C && a.N == b.N;
+        };
+        Triangle bottom, top, expectedBottom, expectedTop;
+        for (uint32_t z = 0; z < tile.Info.SamplesZ - 1; z++) {
+            for (uint32_t x = 0; x < tile.Info.SamplesX - 1; x++) {
+                tile.Grid.GetSquare(x, z, bottom, top);
+                terrain.GetSquare(tile.Info.X0 + x, tile.Info.Z0 + z, expectedBottom, expectedTop);
+                if (!same(bottom, expectedBottom) || !same(top, expectedTop))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    // What the terrain took before it was kept as one height grid: the loader's MeshVertex and
+    // ColorNormalVertex arrays and indices, then two Triangles per square in the component's rectangles and
+    // again in its flat triangle list.
+    size_t GetLegacyTerrainBytes(const HeightGrid& grid) {
+        if (grid.IsEmpty())
+            return 0;
+        const size_t samples = static_cast<size_t>(grid.Width) * grid.Height;
+        const size_t squares = static_cast<size_t>(grid.Width - 1) * (grid.Height - 1);
+        return samples * (sizeof(MeshVertex) + sizeof(ColorNormalVertex)) + squares * 6 * sizeof(uint32_t)
+            + squares * 2 * 2 * sizeof(Triangle);
+    }
+
+    // Flies the camera in a straight line across the middle of the terrain, then lets the queue drain and
+    // compares what ended up resident.
+    bool StreamTiles(const BenchSettings& settings, LasLoader& loader, StreamResult& result) {
+        const std::string cachePath = TerrainCache::GetCachePath(settings.File);
+        TerrainCache cache;
+        if (!cache.Open(cachePath, settings.File) || cache.GetCellSize() != settings.CellSize) {
+            cache.Close();
+            { LasLoader baking(settings.File, true, settings.CellSize); }
+            if (!cache.Open(cachePath, settings.File))
+                return false;
+        }
+
+        const std::string tilePath = TerrainTileSet::GetTilePath(settings.File);
+        Timer timer;
+        if (!TerrainTileSet::Write(tilePath, cache, settings.TileSize))
+            return false;
+        result.TileWriteSeconds = timer.Delta();
+
+        TerrainTileSet tiles;
+        if (!tiles.Open(tilePath, cache.GetSourceHash(), cache.GetCellSize()))
+            return false;
+        cache.Close();
+        result.TileCount = tiles.GetTileCount();
+        for (uint32_t tile = 0; tile < tiles.GetTileCount(); tile++)
+            result.MaxTileBytes = std::max(result.MaxTileBytes, TerrainTile::GetBytes(tiles.GetTileInfo(tile)));
+
+        TerrainStreamer streamer(std::move(tiles));
+        streamer.MemoryBudget = settings.StreamBudgetMB << 20;
+        streamer.LoadRadius = 256.f;
+        result.BudgetBytes = streamer.MemoryBudget;
+
+        const float width = static_cast<float>(streamer.GetTileSet().GetWidth() - 1) * settings.CellSize;
+        const float middle = static_cast<float>(streamer.GetTileSet().GetHeight() - 1) * settings.CellSize * 0.5f;
+        const std::vector<glm::vec3> bodies{ glm::vec3(width * 0.25f, 0.f, middle * 0.5f), glm::vec3(width * 0.75f, 0.f, middle * 1.5f) };
+        std::vector<std::shared_ptr<const TerrainTile>> resident;
+        auto update = [&](const glm::vec3& camera) {
+            streamer.Update(camera, bodies);
+            for (auto& tile : streamer.TakeLoaded())
+                resident.push_back(std::move(tile));
+            for (uint32_t tile : streamer.TakeEvicted())
+                std::erase_if(resident, [tile](const auto& loaded) { return loaded->Index == tile; });
+            result.PeakResidentBytes = std::max(result.PeakResidentBytes, streamer.GetResidentBytes());
+        };
+
+        glm::vec3 camera(0.f, 0.f, middle);
+        result.UpdateMs.reserve(settings.Frames);
+        for (uint32_t frame = 0; frame < settings.Frames; frame++) {
+            camera.x = width * static_cast<float>(frame) / static_cast<float>(std::max(settings.Frames - 1, 1u));
+            timer.Delta();
+            update(camera);
+            result.UpdateMs.push_back(timer.Delta() * 1000.0);
+            // Roughly a 60 Hz frame, so the loading threads get the time they would have in the app.
+            std::this_thread::sleep_for(std::chrono::milliseconds(16));
+        }
+
+        // Give the threads time to finish what the last position wants.
+        for (int settle = 0; settle < 200 && streamer.GetQueuedCount() > 0; settle++) {
+            update(camera);
+            std::this_thread::sleep_for(std::chrono::milliseconds(16));
+        }
+        update(camera);
+        result.Loaded = streamer.GetLoadedTotal();
+        result.Evicted = streamer.GetEvictedTotal();
+
+        const auto& terrain = loader.GetHeightGrid();
+        result.Matches = true;
+        for (const auto& tile : resident) {
+            result.Matches = result.Matches && SameTriangles(*tile, terrain);
+            result.TilesChecked++;
+        }
+        std::error_code error;
+        if (!settings.Keep)
+            std::filesystem::remove(tilePath, error);
+        return true;
+    }
+
+    // The finest level of every chunk must draw the triangles of the loaded mesh for the squares inside the
+    // grid, within half a step of the chunk's box. Errors must never shrink with the level and the mesh must be as
+    // large as GetBytes predicts.
+    bool CheckLod(const TerrainLodMesh& mesh, const std::vector<ColorNormalVertex>& vertices, const std::vector<uint32_t>& indices,
+        uint32_t width, uint32_t height) {
+        const auto& lod = mesh.Lod;
+        const uint32_t size = lod.GetChunkSize();
+        const uint32_t chunksX = (width - 2) / size + 1;
+        const auto& finest = lod.GetLevels().front();
+        for (uint32_t c = 0; c < lod.GetChunks().size(); c++) {
+            const auto& chunk = lod.GetChunks()[c];
+            const uint32_t x0 = (c % chunksX) * size;
+            const uint32_t z0 = (c / chunksX) * size;
+            for (uint32_t z = 0; z < size && z0 + z < height - 1; z++) {
+                for (uint32_t x = 0; x < size && x0 + x < width - 1; x++) {
+                    const size_t drawn = finest.FirstIndex + (static_cast<size_t>(z) * size + x) * 6;
+                    const size_t loaded = (static_cast<size_t>(z0 + z) * (width - 1) + x0 + x) * 6;
+                    for (size_t i = 0; i < 6; i++) {
+                        const glm::vec3 pos = chunk.Box.Decode(glm::u16vec3(mesh.Vertices[chunk.VertexOffset + mesh.Indices[drawn + i]].PosNormal));
+                        const glm::vec3& expected = vertices[indices[loaded + i]].Pos;
+                        if (glm::any(glm::greaterThan(glm::abs(pos - expected), chunk.Box.Step * 0.5f + glm::abs(expected) * 1e-6f)))
+                            return false;
+                    }
+                }
+            }
+            for (uint32_t level = 1; level < TerrainLod::MaxLevels; level++) {
+                if (chunk.Errors[level] < chunk.Errors[level - 1])
+                    return false;
+            }
+        }
+        return mesh.GetBytes() == TerrainLodMesh::GetBytes(width, height, size);
+    }
+
+    bool BuildLod(const BenchSettings& settings, LasLoader& loader, LodResult& result) {
+        const auto& grid = loader.GetHeightGrid();
+        const auto vertices = grid.MakeVertices();
+        const auto indices = grid.MakeIndices();
+        const uint32_t width = static_cast<uint32_t>(loader.GetGridWidth());
+        const uint32_t height = static_cast<uint32_t>(loader.GetGridHeight());
+        if (width < 2 || height < 2)
+            return false;
+
+        Timer timer;
+        TerrainLodMesh mesh(vertices, width, height, settings.ChunkSize);
+        result.BuildSeconds = timer.Delta();
+        const auto& lod = mesh.Lod;
+        result.ChunkSize = lod.GetChunkSize();
+        result.Chunks = static_cast<uint32_t>(lod.GetChunks().size());
+        result.Levels = static_cast<uint32_t>(lod.GetLevels().size());
+        result.FullTriangles = indices.size() / 3;
+        result.Bytes = mesh.GetBytes();
+        result.ExpectedBytes = TerrainLodMesh::GetBytes(width, height, result.ChunkSize);
+        result.Matches = CheckLod(mesh, vertices, indices, width, height);
+
+        // A 1080 pixel high viewport with the app's 70 degree field of view, looking from above the middle.
+        const float pixelsPerUnit = 1080.f / (2.f * std::tan(glm::radians(70.f) * 0.5f));
+        float top = std::numeric_limits<float>::lowest();
+        for (const auto& chunk : lod.GetChunks())
+            top = std::max(top, chunk.Max.y);
+        std::vector<TerrainLod::Selection> selection;
+        for (float cameraHeight : { 10.f, 100.f, 1000.f }) {
+            for (float pixelError : { 1.f, 4.f }) {
+                const glm::vec3 eye(width * settings.CellSize * 0.5f, top + cameraHeight, height * settings.CellSize * 0.5f);
+                LodView view{ cameraHeight, pixelError };
+                timer.Delta();
+                lod.Select(eye, pixelsPerUnit, pixelError, selection);
+                view.SelectMs = timer.Delta() * 1000.0;
+                view.Triangles = lod.GetTriangleCount(selection);
+                result.Views.push_back(view);
+            }
+        }
+        return true;
+    }
+
+    // The normal pass before the grid computed them: six cross products per sample, one sample at a time.
+    std::vector<glm::vec3> MakeLegacyNormals(const HeightGrid& grid) {
+        std::vector<glm::vec3> normals(grid.Heights.size(), glm::vec3(0.f, 1.f, 0.f));
+        for (uint32_t z = 1; z + 1 < grid.Height; z++) {
+            for (uint32_t x = 1; x + 1 < grid.Width; x++) {
+                const glm::vec3 a = grid.GetPosition(x, z);
+                const glm::vec3 b = grid.GetPosition(x + 1, z);
+                const glm::vec3 c = grid.GetPosition(x + 1, z + 1);
+                const glm::vec3 d = grid.GetPosition(x, z + 1);
+                const glm::vec3 e = grid.GetPosition(x - 1, z);
+                const glm::vec3 f = grid.GetPosition(x - 1, z - 1);
+                const glm::vec3 g = grid.GetPosition(x, z - 1);
+                normals[grid.GetIndex(x, z)] = glm::normalize(glm::cross(c - a, b - a) + glm::cross(d - a, c - a) + glm::cross(e - a, d - a)
+                    + glm::cross(f - a, e - a) + glm::cross(g - a, f - a) + glm::cross(b - a, g - a));
+            }
+        }
+        return normals;
+    }
+
+    // Normals of the whole grid must match GetNormal, the serial pass and every --tile-size block made on its own,
+    // and stay within rounding of the cross product pass.
+    void CompareNormals(const BenchSettings& settings, const HeightGrid& grid, NormalResult& result) {
+        Timer timer;
+        const auto legacy = MakeLegacyNormals(grid);
+        result.LegacySeconds = timer.Delta();
+        Parallel::SetWorkerCount(1);
+        timer.Delta();
+        const auto serial = grid.MakeNormals();
+        result.SerialSeconds = timer.Delta();
+        Parallel::SetWorkerCount(settings.Threads);
+        timer.Delta();
+        const auto normals = grid.MakeNormals();
+        result.Seconds = timer.Delta();
+
+        result.Matches = normals == serial;
+        float minDot{ 1.f };
+        for (uint32_t z = 0; z < grid.Height; z++) {
+            for (uint32_t x = 0; x < grid.Width; x++) {
+                const size_t i = grid.GetIndex(x, z);
+                minDot = std::min(minDot, glm::dot(normals[i], legacy[i]));
+                result.Matches = result.Matches && normals[i] == grid.GetNormal(x, z);
+            }
+        }
+        result.MaxErrorDegrees = glm::degrees(std::acos(std::clamp(minDot, -1.f, 1.f)));
+
+        const uint32_t size = settings.TileSize;
+        std::vector<glm::vec3> tile;
+        for (uint32_t z0 = 0; z0 + 1 < grid.Height; z0 += size) {
+            for (uint32_t x0 = 0; x0 + 1 < grid.Width; x0 += size) {
+                const uint32_t samplesX = std::min(size, grid.Width - 1 - x0) + 1;
+                const uint32_t samplesZ = std::min(size, grid.Height - 1 - z0) + 1;
+                tile.resize(static_cast<size_t>(samplesX) * samplesZ);
+                grid.MakeNormals(x0, z0, samplesX, samplesZ, tile);
+                for (uint32_t z = 0; z < samplesZ; z++) {
+                    result.Matches = result.Matches && std::equal(tile.begin() + static_cast<size_t>(z) * samplesX,
+                        tile.begin() + static_cast<size_t>(z + 1) * samplesX, normals.begin() + grid.GetIndex(x0, z0 + z));
+                }
+            }
+        }
+    }
+
+    bool DecimatePoints(const BenchSettings& settings, const LasLoader& loader, DecimationResult& result) {
+        const auto& points = loader.GetPointData();
+        Timer timer;
+        const auto decimated = PointCloud::Decimate(points, settings.VoxelSize);
+        result.Seconds = timer.Delta();
+        Parallel::SetWorkerCount(1);
+        timer.Delta();
+        const auto serial = PointCloud::Decimate(points, settings.VoxelSize);
+        result.SerialSeconds = timer.Delta();
+        Parallel::SetWorkerCount(settings.Threads);
+        result.Points = decimated.size();
+
+        auto same = [](const ColorVertex& a, const ColorVertex& b) { return a.Pos == b.Pos && a.Color == b.Color; };
+        result.Matches = std::equal(decimated.begin(), decimated.end(), serial.begin(), serial.end(), same);
+
+        // Means stay inside their voxel, so no two output points may share one. Points within rounding of a
+        // voxel face are left out of the check.
+        std::vector<glm::ivec3> voxels;
+        voxels.reserve(decimated.size());
+        for (const auto& point : decimated) {
+            const glm::vec3 voxel = point.Pos / settings.VoxelSize;
+            if (glm::any(glm::lessThan(glm::abs(voxel - glm::round(voxel)), glm::vec3(1e-3f))))
+                continue;
+            voxels.push_back(glm::ivec3(glm::floor(voxel)));
+        }
+        auto less = [](const glm::ivec3& a, const glm::ivec3& b) { return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z); };
+        std::sort(voxels.begin(), voxels.end(), less);
+        result.Matches = result.Matches && std::adjacent_find(voxels.begin(), voxels.end()) == voxels.end();
+        return true;
+    }
+
+    // Nodes must hold every point once, inside their cube, with children inside their parent.
+    bool CheckOctree(const PointOctree& octree, const std::vector<ColorVertex>& points) {
+        const auto& nodes = octree.GetNodes();
+        for (const auto& node : nodes) {
+            const float margin = node.Size * 1e-4f;
+            for (const auto& point : octree.GetPoints(node)) {
+                if (glm::any(glm::lessThan(point.Pos, node.Min - margin)) || glm::any(glm::greaterThan(point.Pos, node.Min + node.Size + margin)))
+                    return false;
+            }
+            for (uint32_t child = node.FirstChild; child < node.FirstChild + node.ChildCount; child++) {
+                const auto& childNode = nodes[child];
+                if (childNode.Depth != node.Depth + 1 || childNode.Size != node.Size * 0.5f
+                    || glm::any(glm::lessThan(childNode.Min, node.Min)) || glm::any(glm::greaterThan(childNode.Min + childNode.Size, node.Min + node.Size + margin)))
+                    return false;
+            }
+        }
+
+        auto less = [](const ColorVertex& a, const ColorVertex& b) {
+            return std::tie(a.Pos.x, a.Pos.y, a.Pos.z, a.Color.r, a.Color.g, a.Color.b) < std::tie(b.Pos.x, b.Pos.y, b.Pos.z, b.Color.r, b.Color.g, b.Color.b);
+        };
+        auto same = [](const ColorVertex& a, const ColorVertex& b) { return a.Pos == b.Pos && a.Color == b.Color; };
+        auto expected = points;
+        auto stored = octree.GetPoints();
+        std::sort(expected.begin(), expected.end(), less);
+        std::sort(stored.begin(), stored.end(), less);
+        return std::equal(expected.begin(), expected.end(), stored.begin(), stored.end(), same);
+    }
+
+    bool BuildOctree(const BenchSettings& settings, const LasLoader& loader, OctreeResult& result) {
+        const auto& points = loader.GetPointData();
+        Timer timer;
+        PointOctree octree(points);
+        result.Seconds = timer.Delta();
+        Parallel::SetWorkerCount(1);
+        timer.Delta();
+        PointOctree serial(points);
+        result.SerialSeconds = timer.Delta();
+        Parallel::SetWorkerCount(settings.Threads);
+        result.Nodes = static_cast<uint32_t>(octree.GetNodes().size());
+        result.Depth = octree.GetDepth();
+        result.Bytes = octree.GetBytes();
+        if (octree.GetNodes().empty())
+            return false;
+
+        auto same = [](const ColorVertex& a, const ColorVertex& b) { return a.Pos == b.Pos && a.Color == b.Color; };
+        result.Matches = std::equal(octree.GetPoints().begin(), octree.GetPoints().end(), serial.GetPoints().begin(), serial.GetPoints().end(), same)
+            && CheckOctree(octree, points);
+
+        // The app's 70 degree field of view on a 1080 pixel high viewport, looking down at 45 degrees from above
+        // the middle of the cloud, or straight up into the sky.
+        const auto& root = octree.GetNodes().front();
+        const glm::vec3 middle = root.Min + root.Size * 0.5f;
+        const float pixelsPerUnit = 1080.f / (2.f * std::tan(glm::radians(70.f) * 0.5f));
+        CameraComponent camera(middle);
+        camera.FOV = glm::radians(70.f);
+        camera.Near = 0.01f;
+        camera.Far = 2000.f;
+        std::vector<uint32_t> selection;
+        for (float cameraHeight : { 10.f, 100.f, 1000.f }) {
+            for (bool lookingAway : { false, true }) {
+                camera.Position = glm::vec3(middle.x, root.Min.y + root.Size + cameraHeight, middle.z);
+                camera.Forward = lookingAway ? glm::vec3(0.f, 1.f, 0.f) : glm::normalize(glm::vec3(0.f, -1.f, 1.f));
+                camera.Right = glm::vec3(1.f, 0.f, 0.f);
+                camera.Up = glm::cross(camera.Right, camera.Forward);
+                Frustum frustum(camera);
+
+                OctreeView view{ cameraHeight, lookingAway };
+                timer.Delta();
+                view.Points = octree.Select(frustum, camera.Position, pixelsPerUnit, 2.f, settings.PointBudget, selection);
+                view.SelectMs = timer.Delta() * 1000.0;
+                view.Nodes = static_cast<uint32_t>(selection.size());
+                result.Views.push_back(view);
+
+                // Within budget, nothing above the camera, and every node after the root comes after its parent.
+                std::vector<uint8_t> selected(octree.GetNodes().size());
+                for (uint32_t node : selection) {
+                    const auto& current = octree.GetNodes()[node];
+                    for (uint32_t child = current.FirstChild; child < current.FirstChild + current.ChildCount; child++)
+                        selected[child] = 1;
+                    result.Matches = result.Matches && (node == 0 || selected[node]);
+                }
+                result.Matches = result.Matches && view.Points <= settings.PointBudget && (!lookingAway || selection.empty());
+            }
+        }
+        return true;
+    }
+
+    // Positions must come back within half a step of their box, colors within half of 1 / 255 and normals within
+    // s_MaxNormalDegrees, checked on the loaded points, the grid's normals and random directions.
+    bool QuantizeVertices(const BenchSettings& settings, const LasLoader& loader, QuantizeResult& result) {
+        const auto& points = loader.GetPointData();
+        if (points.empty())
+            return false;
+        glm::vec3 min(std::numeric_limits<float>::max());
+        glm::vec3 max(std::numeric_limits<float>::lowest());
+        for (const auto& point : points) {
+            min = glm::min(min, point.Pos);
+            max = glm::max(max, point.Pos);
+        }
+        const Quantize::Box box(min, max);
+        Timer timer;
+        const auto quantized = Quantize::Encode(points, box);
+        result.Seconds = timer.Delta();
+        result.PointBytes = points.size() * sizeof(ColorVertex);
+        result.QuantizedPointBytes = quantized.size() * sizeof(QuantizedColorVertex);
+        for (size_t i = 0; i < points.size(); i++) {
+            const ColorVertex decoded = Quantize::Decode(quantized[i], box);
+            for (int axis = 0; axis < 3; axis++) {
+                if (box.Step[axis] > 0.f)
+                    result.MaxPositionSteps = std::max(result.MaxPositionSteps, std::abs(decoded.Pos[axis] - points[i].Pos[axis]) / box.Step[axis]);
+            }
+            const glm::vec3 colorError = glm::abs(decoded.Color - glm::clamp(points[i].Color, glm::vec3(0.f), glm::vec3(1.f)));
+            result.MaxColorError = std::max({ result.MaxColorError, colorError.r, colorError.g, colorError.b });
+        }
+
+        const auto& grid = loader.GetHeightGrid();
+        auto normals = grid.MakeNormals();
+        result.TerrainVertexBytes = normals.size() * sizeof(ColorNormalVertex);
+        result.QuantizedTerrainVertexBytes = normals.size() * sizeof(QuantizedColorNormalVertex);
+        Random random(settings.Seed);
+        for (uint32_t i = 0; i < s_RandomNormals; i++) {
+            const float y = random.Float() * 2.f - 1.f;
+            const float angle = random.Float() * glm::two_pi<float>();
+            const float radius = std::sqrt(std::max(1.f - y * y, 0.f));
+            normals.push_back(glm::vec3(radius * std::cos(angle), y, radius * std::sin(angle)));
+        }
+        float minDot{ 1.f };
+        double sumDegrees{ 0.0 };
+        for (const auto& normal : normals) {
+            const float cosine = std::clamp(glm::dot(Quantize::DecodeNormal(Quantize::EncodeNormal(normal)), glm::normalize(normal)), -1.f, 1.f);
+            minDot = std::min(minDot, cosine);
+            sumDegrees += glm::degrees(std::acos(cosine));
+        }
+        result.NormalMaxDegrees = glm::degrees(std::acos(minDot));
+        result.NormalMeanDegrees = static_cast<float>(sumDegrees / normals.size());
+
+        // Min + steps * Step rounds a little past the half step.
+        result.Matches = result.MaxPositionSteps <= 0.51f && result.MaxColorError <= 0.5f / 255.f + 1e-6f
+            && result.NormalMaxDegrees <= s_MaxNormalDegrees;
+        return true;
+    }
+
+    // Every point as "x z y" with z up like LAS, or as a .visim vertex with a friction and a label after it.
+    bool WriteText(const std::string& path, const std::vector<ColorVertex>& points, bool visim) {
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+        if (visim)
+            file << points.size() << "\n";
+        std::vector<char> chunk;
+        char number[64];
+        auto append = [&](float value, char separator) {
+            const auto end = std::to_chars(number, number + sizeof(number), value, std::chars_format::fixed, 3).ptr;
+            chunk.insert(chunk.end(), number, end);
+            chunk.push_back(separator);
+        };
+        for (size_t i = 0; i < points.size(); i++) {
+            const glm::vec3& pos = points[i].Pos;
+            if (visim) {
+                append(pos.x, ' ');
+                append(pos.y, ' ');
+                append(pos.z, ' ');
+                chunk.insert(chunk.end(), { '0', '.', '2', ' ', 'A', '\n' });
+            } else {
+                append(pos.x, ' ');
+                append(pos.z, ' ');
+                append(pos.y, '\n');
+            }
+            if (chunk.size() > (1 << 20) || i + 1 == points.size()) {
+                file.write(chunk.data(), chunk.size());
+                chunk.clear();
+            }
+        }
+        return static_cast<bool>(file);
+    }
+
+    // LasLoader::ReadTxt before it mapped the file: a stringstream per line.
+    std::vector<ColorVertex> ReadLegacyTxt(const std::string& path) {
+        std::vector<ColorVertex> points;
+        std::ifstream file(path);
+        std::string line;
+        ColorVertex vertex{};
+        while (std::getline(file, line)) {
+            std::stringstream ss(line);
+            ss >> vertex.Pos.x;
+            ss >> vertex.Pos.z;
+            ss >> vertex.Pos.y;
+            vertex.Color = glm::vec3(0.f, 1.f, 0.f);
+            points.push_back(vertex);
+        }
+        return points;
+    }
+
+    // The position part of Utils::GetVisimVertexData before it mapped the file.
+    std::vector<glm::vec3> ReadLegacyVisim(const std::string& path) {
+        std::ifstream file(path);
+        uint32_t count{};
+        file >> count;
+        std::string line;
+        std::getline(file, line);
+        std::vector<glm::vec3> positions(count);
+        for (auto& pos : positions) {
+            std::getline(file, line);
+            std::stringstream ss(line);
+            ss >> pos.x;
+            ss >> pos.y;
+            ss >> pos.z;
+        }
+        return positions;
+    }
+
+    bool ReadText(const BenchSettings& settings, const LasLoader& loader, TextResult& result) {
+        const auto& points = loader.GetPointData();
+        const std::string txtPath = settings.File + ".txt";
+        const std::string visimPath = settings.File + ".visim";
+        if (points.empty() || !WriteText(txtPath, points, false) || !WriteText(visimPath, points, true))
+            return false;
+        std::error_code error;
+        result.Bytes = std::filesystem::file_size(txtPath, error);
+        result.VisimBytes = std::filesystem::file_size(visimPath, error);
+
+        Timer timer;
+        const auto legacy = ReadLegacyTxt(txtPath);
+        result.LegacySeconds = timer.Delta();
+        const auto parsed = LasLoader::ReadTxt(txtPath);
+        result.Seconds = timer.Delta();
+        result.Points = parsed.size();
+        auto same = [](const ColorVertex& a, const ColorVertex& b) { return a.Pos == b.Pos && a.Color == b.Color; };
+        result.Matches = parsed.size() == points.size() && std::equal(parsed.begin(), parsed.end(), legacy.begin(), legacy.end(), same);
+
+        timer.Delta();
+        const auto legacyVisim = ReadLegacyVisim(visimPath);
+        result.VisimLegacySeconds = timer.Delta();
+        const auto visim = Utils::GetVisimVertexData(visimPath);
+        result.VisimSeconds = timer.Delta();
+        result.Matches = result.Matches && std::equal(visim.begin(), visim.end(), legacyVisim.begin(), legacyVisim.end(),
+            [](const MeshVertex& a, const glm::vec3& b) { return a.Pos == b; });
+
+        if (!settings.Keep) {
+            std::filesystem::remove(txtPath, error);
+            std::filesystem::remove(visimPath, error);
+        }
+        return true;
+    }
+
+    bool ParseArgs(int argc, char** argv, BenchSettings& settings) {
+        for (int i = 1; i < argc; i++) {
+            const char* arg = argv[i];
+            if (std::strcmp(arg, "--keep") == 0) {
+                settings.Keep = true;
+                continue;
+            }
+            if (std::strcmp(arg, "--verify") == 0) {
+                settings.Verify = true;
+                continue;
+            }
+            if (std::strcmp(arg, "--cache") == 0) {
+                settings.Cache = true;
+                continue;
+            }
+            if (std::strcmp(arg, "--tiles") == 0) {
+                settings.Tiles = true;
+                continue;
+            }
+            if (std::strcmp(arg, "--normals") == 0) {
+                settings.Normals = true;
+                continue;
+            }
+            if (std::strcmp(arg, "--octree") == 0) {
+                settings.Octree = true;
+                continue;
+            }
+            if (std::strcmp(arg, "--quantize") == 0) {
+                settings.Quantize = true;
+                continue;
+            }
+            if (std::strcmp(arg, "--text") == 0) {
+                settings.Text = true;
+                continue;
+            }
+            if (std::strcmp(arg, "--lod") == 0) {
+                settings.Lod = true;
+                continue;
+            }
+            const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+            if (!value) {
+                std::cerr << "Missing value for " << arg << "\n";
+                return false;
+            }
+            if (std::strcmp(arg, "--points") == 0)
+                settings.Points = std::strtoull(value, nullptr, 10);
+            else if (std::strcmp(arg, "--format") == 0)
+                settings.Format = static_cast<uint8_t>(std::atoi(value));
+            else if (std::strcmp(arg, "--file") == 0)
+                settings.File = value;
+            else if (std::strcmp(arg, "--threads") == 0)
+                settings.Threads = static_cast<uint32_t>(std::atoi(value));
+            else if (std::strcmp(arg, "--seed") == 0)
+                settings.Seed = std::strtoull(value, nullptr, 10);
+            else if (std::strcmp(arg, "--tile-size") == 0)
+                settings.TileSize = static_cast<uint32_t>(std::atoi(value));
+            else if (std::strcmp(arg, "--stream-budget") == 0)
+                settings.StreamBudgetMB = std::strtoull(value, nullptr, 10);
+            else if (std::strcmp(arg, "--frames") == 0)
+                settings.Frames = static_cast<uint32_t>(std::atoi(value));
+            else if (std::strcmp(arg, "--chunk-size") == 0)
+                settings.ChunkSize = static_cast<uint32_t>(std::atoi(value));
+            else if (std::strcmp(arg, "--cell-size") == 0)
+                settings.CellSize = static_cast<float>(std::atof(value));
+            else if (std::strcmp(arg, "--point-budget") == 0)
+                settings.PointBudget = std::strtoull(value, nullptr, 10);
+            else if (std::strcmp(arg, "--voxel-size") == 0)
+                settings.VoxelSize = static_cast<float>(std::atof(value));
+            else if (std::strcmp(arg, "--levels") == 0)
+                settings.Levels = static_cast<uint32_t>(std::atoi(value));
+            else {
+                std::cerr << "Unknown argument " << arg << "\n";
+                return false;
+            }
+            i++;
+        }
+        return settings.Points > 0 && settings.Format < lasPointFormats.size() && settings.CellSize > 0.f && settings.Levels > 0;
+    }
+
+    // The optional checks run on the loaded survey, in the order their fields are printed. Each one prints its
+    // JSON fields to out and returns whether its results match.
+    bool RunVerify(const BenchSettings& settings, LasLoader& loader, std::ostream& out) {
+        Parallel::SetWorkerCount(1);
+        Timer timer;
+        LasLoader serial(settings.File, false, settings.CellSize, settings.Levels);
+        const double serialTime = timer.Delta();
+        const bool deterministic = SameOutput(loader, serial);
+        Parallel::SetWorkerCount(settings.Threads);
+        out << "  \"serialSeconds\": " << serialTime << ",\n";
+        out << "  \"deterministic\": " << (deterministic ? "true" : "false") << ",\n";
+        return deterministic;
+    }
+
+    // The cached terrain only keeps the grid, so compare what is built from it and the points read next to it.
+    bool RunCache(const BenchSettings& settings, LasLoader& loader, std::ostream& out) {
+        std::error_code error;
+        std::filesystem::remove(TerrainCache::GetCachePath(settings.File), error);
+        Timer timer;
+        { LasLoader baking(settings.File, true, settings.CellSize); }
+        const double cacheWriteTime = timer.Delta();
+        LasLoader cached(settings.File, true, settings.CellSize, settings.Levels);
+        const double cachedTime = timer.Delta();
+        const bool cacheMatches = cached.IsFromCache() && SameTerrain(cached, loader) && SamePoints(cached, loader);
+        out << "  \"cacheWriteSeconds\": " << cacheWriteTime << ",\n";
+        out << "  \"cachedLoadSeconds\": " << cachedTime << ",\n";
+        out << "  \"cacheMatches\": " << (cacheMatches ? "true" : "false") << ",\n";
+        return cacheMatches;
+    }
+
+    bool RunTiles(const BenchSettings& settings, LasLoader& loader, std::ostream& out) {
+        StreamResult stream;
+        const bool streamMatches = StreamTiles(settings, loader, stream) && stream.Matches;
+        out << "  \"tileWriteSeconds\": " << stream.TileWriteSeconds << ",\n";
+        out << "  \"tiles\": " << stream.TileCount << ",\n";
+        auto& updateMs = stream.UpdateMs;
+        std::sort(updateMs.begin(), updateMs.end());
+        const double meanMs = updateMs.empty() ? 0.0 : std::accumulate(updateMs.begin(), updateMs.end(), 0.0) / updateMs.size();
+        out << "  \"streamUpdateMs\": { \"mean\": " << meanMs << ", \"p99\": " << Bench::Percentile(updateMs, 99.0)
+            << ", \"max\": " << Bench::Percentile(updateMs, 100.0) << " },\n";
+        out << "  \"streamBudgetBytes\": " << stream.BudgetBytes << ",\n";
+        out << "  \"streamPeakResidentBytes\": " << stream.PeakResidentBytes << ",\n";
+        out << "  \"streamMaxTileBytes\": " << stream.MaxTileBytes << ",\n";
+        out << "  \"tilesLoaded\": " << stream.Loaded << ",\n";
+        out << "  \"tilesEvicted\": " << stream.Evicted << ",\n";
+        out << "  \"tilesChecked\": " << stream.TilesChecked << ",\n";
+        out << "  \"tilesMatch\": " << (streamMatches ? "true" : "false") << ",\n";
+        return streamMatches;
+    }
+
+    bool RunLod(const BenchSettings& settings, LasLoader& loader, std::ostream& out) {
+        LodResult lod;
+        const bool lodMatches = BuildLod(settings, loader, lod) && lod.Matches;
+        out << "  \"lodBuildSeconds\": " << lod.BuildSeconds << ",\n";
+        out << "  \"lodChunkSize\": " << lod.ChunkSize << ",\n";
+        out << "  \"lodChunks\": " << lod.Chunks << ",\n";
+        out << "  \"lodLevels\": " << lod.Levels << ",\n";
+        out << "  \"lodBytes\": " << lod.Bytes << ",\n";
+        out << "  \"lodExpectedBytes\": " << lod.ExpectedBytes << ",\n";
+        out << "  \"fullTriangles\": " << lod.FullTriangles << ",\n";
+        out << "  \"lodViews\": [";
+        for (size_t i = 0; i < lod.Views.size(); i++) {
+            const auto& view = lod.Views[i];
+            out << (i ? ", " : "") << "{ \"cameraHeight\": " << view.CameraHeight << ", \"pixelError\": " << view.PixelError
+                << ", \"triangles\": " << view.Triangles << ", \"selectMs\": " << view.SelectMs << " }";
+        }
+        out << "],\n";
+        out << "  \"lodMatches\": " << (lodMatches ? "true" : "false") << ",\n";
+        return lodMatches;
+    }
+
+    bool RunNormals(const BenchSettings& settings, LasLoader& loader, std::ostream& out) {
+        NormalResult normals;
+        CompareNormals(settings, loader.GetHeightGrid(), normals);
+        out << "  \"normalsLegacySeconds\": " << normals.LegacySeconds << ",\n";
+        out << "  \"normalsSerialSeconds\": " << normals.SerialSeconds << ",\n";
+        out << "  \"normalsSeconds\": " << normals.Seconds << ",\n";
+        out << "  \"normalsMaxErrorDegrees\": " << normals.MaxErrorDegrees << ",\n";
+        out << "  \"normalsMatch\": " << (normals.Matches ? "true" : "false") << ",\n";
+        return normals.Matches;
+    }
+
+    bool RunDecimation(const BenchSettings& settings, LasLoader& loader, std::ostream& out) {
+        DecimationResult decimation;
+        const bool decimationMatches = DecimatePoints(settings, loader, decimation) && decimation.Matches;
+        out << "  \"voxelSize\": " << settings.VoxelSize << ",\n";
+        out << "  \"decimateSeconds\": " << decimation.Seconds << ",\n";
+        out << "  \"decimateSerialSeconds\": " << decimation.SerialSeconds << ",\n";
+        out << "  \"decimatedPoints\": " << decimation.Points << ",\n";
+        out << "  \"pointBytesBefore\": " << loader.GetPointData().size() * sizeof(ColorVertex) << ",\n";
+        out << "  \"pointBytesAfter\": " << decimation.Points * sizeof(ColorVertex) << ",\n";
+        out << "  \"decimationMatches\": " << (decimationMatches ? "true" : "false") << ",\n";
+        return decimationMatches;
+    }
+
+    bool RunOctree(const BenchSettings& settings, LasLoader& loader, std::ostream& out) {
+        OctreeResult octree;
+        const bool octreeMatches = BuildOctree(settings, loader, octree) && octree.Matches;
+        out << "  \"octreeSeconds\": " << octree.Seconds << ",\n";
+        out << "  \"octreeSerialSeconds\": " << octree.SerialSeconds << ",\n";
+        out << "  \"octreeNodes\": " << octree.Nodes << ",\n";
+        out << "  \"octreeDepth\": " << octree.Depth << ",\n";
+        out << "  \"octreeBytes\": " << octree.Bytes << ",\n";
+        out << "  \"pointBudget\": " << settings.PointBudget << ",\n";
+        out << "  \"octreeViews\": [";
+        for (size_t i = 0; i < octree.Views.size(); i++) {
+            const auto& view = octree.Views[i];
+            out << (i ? ", " : "") << "{ \"cameraHeight\": " << view.CameraHeight << ", \"lookingAway\": " << (view.LookingAway ? "true" : "false")
+                << ", \"nodes\": " << view.Nodes << ", \"points\": " << view.Points << ", \"selectMs\": " << view.SelectMs << " }";
+        }
+        out << "],\n";
+        out << "  \"octreeMatches\": " << (octreeMatches ? "true" : "false") << ",\n";
+        return octreeMatches;
+    }
+
+    bool RunQuantize(const BenchSettings& settings, LasLoader& loader, std::ostream& out) {
+        QuantizeResult quantize;
+        const bool quantizeMatches = QuantizeVertices(settings, loader, quantize) && quantize.Matches;
+        out << "  \"quantizeSeconds\": " << quantize.Seconds << ",\n";
+        out << "  \"quantizePointBytesBefore\": " << quantize.PointBytes << ",\n";
+        out << "  \"quantizePointBytesAfter\": " << quantize.QuantizedPointBytes << ",\n";
+        out << "  \"quantizeTerrainVertexBytesBefore\": " << quantize.TerrainVertexBytes << ",\n";
+        out << "  \"quantizeTerrainVertexBytesAfter\": " << quantize.QuantizedTerrainVertexBytes << ",\n";
+        out << "  \"quantizeMaxPositionSteps\": " << quantize.MaxPositionSteps << ",\n";
+        out << "  \"quantizeMaxColorError\": " << quantize.MaxColorError << ",\n";
+        out << "  \"quantizeNormalMaxDegrees\": " << quantize.NormalMaxDegrees << ",\n";
+        out << "  \"quantizeNormalMeanDegrees\": " << quantize.NormalMeanDegrees << ",\n";
+        out << "  \"quantizeMatches\": " << (quantizeMatches ? "true" : "false") << ",\n";
+        return quantizeMatches;
+    }
+
+    bool RunText(const BenchSettings& settings, LasLoader& loader, std::ostream& out) {
+        TextResult text;
+        const bool textMatches = ReadText(settings, loader, text) && text.Matches;
+        auto megabytesPerSecond = [](size_t bytes, double seconds) { return seconds > 0.0 ? bytes / seconds / (1024.0 * 1024.0) : 0.0; };
+        out << "  \"textBytes\": " << text.Bytes << ",\n";
+        out << "  \"textPoints\": " << text.Points << ",\n";
+        out << "  \"textLegacySeconds\": " << text.LegacySeconds << ",\n";
+        out << "  \"textSeconds\": " << text.Seconds << ",\n";
+        out << "  \"textLegacyMBps\": " << megabytesPerSecond(text.Bytes, text.LegacySeconds) << ",\n";
+        out << "  \"textMBps\": " << megabytesPerSecond(text.Bytes, text.Seconds) << ",\n";
+        out << "  \"visimBytes\": " << text.VisimBytes << ",\n";
+        out << "  \"visimLegacyMBps\": " << megabytesPerSecond(text.VisimBytes, text.VisimLegacySeconds) << ",\n";
+        out << "  \"visimMBps\": " << megabytesPerSecond(text.VisimBytes, text.VisimSeconds) << ",\n";
+        out << "  \"textMatches\": " << (textMatches ? "true" : "false") << ",\n";
+        return textMatches;
+    }
+
+    struct Check {
+        const char* Name;
+        bool (*IsEnabled)(const BenchSettings&);
+        bool (*Run)(const BenchSettings&, LasLoader&, std::ostream&);
+    };
+
+    const Check s_Checks[] = {
+        { "Loading again on one thread", [](const BenchSettings& settings) { return settings.Verify; }, RunVerify },
+        { "Loading through the cache", [](const BenchSettings& settings) { return settings.Cache; }, RunCache },
+        { "Streaming tiles", [](const BenchSettings& settings) { return settings.Tiles; }, RunTiles },
+        { "Building terrain LOD", [](const BenchSettings& settings) { return settings.Lod; }, RunLod },
+        { "Comparing normals", [](const BenchSettings& settings) { return settings.Normals; }, RunNormals },
+        { "Decimating points", [](const BenchSettings& settings) { return settings.VoxelSize > 0.f; }, RunDecimation },
+        { "Building point octree", [](const BenchSettings& settings) { return settings.Octree; }, RunOctree },
+        { "Quantizing vertices", [](const BenchSettings& settings) { return settings.Quantize; }, RunQuantize },
+        { "Reading text exports", [](const BenchSettings& settings) { return settings.Text; }, RunText },
+    };
+}
+
+int main(int argc, char** argv) {
+    BenchSettings settings;
+    if (!ParseArgs(argc, argv, settings))
+        return 1;
+    if (settings.File.empty())
+        settings.File = (std::filesystem::temp_directory_path() / "floof_bench.las").string();
+
+    // Reuse a kept file of the right size instead of writing gigabytes again.
+    const uint64_t fileBytes = s_HeaderSize + settings.Points * lasPointFormats[settings.Format].size;
+    std::error_code error;
+    if (std::filesystem::file_size(settings.File, error) != fileBytes || error) {
+        std::cerr << "Writing " << settings.Points << " points to " << settings.File << "\n";
+        if (!GenerateLas(settings)) {
+            std::cerr << "Could not write " << settings.File << "\n";
+            return 1;
+        }
+    }
+
+    std::cerr << "Loading " << settings.File << "\n";
+    Parallel::SetWorkerCount(settings.Threads);
+    const uint32_t workers = Parallel::GetWorkerCount();
+    Timer timer;
+    auto loader = std::make_unique<LasLoader>(settings.File, false, settings.CellSize, settings.Levels);
+    const double totalTime = timer.Delta();
+    const double readTime = loader->GetReadTime();
+    const double triangulateTime = loader->GetTriangulateTime();
+    const size_t terrainBytesBefore = GetLegacyTerrainBytes(loader->GetHeightGrid());
+    const size_t terrainBytesAfter = loader->GetHeightGrid().GetBytes();
+    struct GridLevel {
+        float CellSize;
+        uint32_t Width;
+        uint32_t Height;
+        size_t Holes;
+        double Seconds;
+    };
+    std::vector<GridLevel> levels;
+    for (uint32_t level = 0; level < loader->GetLevelCount(); level++) {
+        const auto& grid = loader->GetHeightGrid(level);
+        levels.push_back({ grid.CellSize, grid.Width, grid.Height, loader->GetLevelHoles(level), loader->GetLevelTime(level) });
+    }
+
+    std::ostringstream checkFields;
+    bool matches{ true };
+    for (const auto& check : s_Checks) {
+        if (!check.IsEnabled(settings))
+            continue;
+        std::cerr << check.Name << "\n";
+        matches = check.Run(settings, *loader, checkFields) && matches;
+    }
+    loader.reset();
+
+    std::cout << "{\n";
+    std::cout << "  \"benchmark\": \"las\",\n";
+    std::cout << "  \"points\": " << settings.Points << ",\n";
+    std::cout << "  \"format\": " << static_cast<int>(settings.Format) << ",\n";
+    std::cout << "  \"workers\": " << workers << ",\n";
+    std::cout << "  \"fileBytes\": " << fileBytes << ",\n";
+    std::cout << "  \"readSeconds\": " << readTime << ",\n";
+    std::cout << "  \"readMBps\": " << (readTime > 0.0 ? fileBytes / readTime / (1024.0 * 1024.0) : 0.0) << ",\n";
+    std::cout << "  \"readMillionPointsPerSecond\": " << (readTime > 0.0 ? settings.Points / readTime / 1e6 : 0.0) << ",\n";
+    std::cout << "  \"triangulateSeconds\": " << triangulateTime << ",\n";
+    std::cout << "  \"totalSeconds\": " << totalTime << ",\n";
+    std::cout << "  \"cellSize\": " << settings.CellSize << ",\n";
+    std::cout << "  \"levels\": [";
+    for (size_t i = 0; i < levels.size(); i++) {
+        const auto& level = levels[i];
+        std::cout << (i ? ", " : "") << "{ \"cellSize\": " << level.CellSize << ", \"width\": " << level.Width << ", \"height\": " << level.Height
+            << ", \"holes\": " << level.Holes << ", \"seconds\": " << level.Seconds << " }";
+    }
+    std::cout << "],\n";
+    std::cout << "  \"terrainBytesBefore\": " << terrainBytesBefore << ",\n";
+    std::cout << "  \"terrainBytesAfter\": " << terrainBytesAfter << ",\n";
+    std::cout << checkFields.str();
+    std::cout << "  \"peakMemoryBytes\": " << Bench::PeakMemoryBytes() << "\n";
+    std::cout << "}\n";
+
+    if (!settings.Keep) {
+        std::filesystem::remove(settings.File, error);
+        std::filesystem::remove(TerrainCache::GetCachePath(settings.File), error);
+    }
+    return matches ? 0 : 2;
+}
@@ -0,0 +1,305 @@
+// Headless rain stress benchmark. Loads a terrain, drops a fixed seeded rain of balls on it, steps the physics
+// a fixed number of frames and prints step time percentiles, broadphase pairs and peak memory as JSON.
+//
+// floof_bench_rain [--terrain Assets/france.las] [--balls 1000,10000,100000] [--frames 300] [--warmup 10]
+//                  [--seed 24301] [--dt 0.016667] [--out result.json]
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "Simulate.h"
+#include "CollisionEvents.h"
+#include "LasLoader.h"
+#include "Logger.h"
+#include "Profiler.h"
+#include "Random.h"
+#include "Timer.h"
+
+using namespace FLOOF;
+
+namespace {
+    struct BenchSettings {
+        std::string Terrain{ "Assets/france.las" };
+        std::vector<int> BallCounts{ 1000, 10000, 100000 };
+        int Frames{ 300 };
+        int Warmup{ 10 };
+        uint64_t Seed{ Random::s_DefaultSeed };
+        float DeltaTime{ 1.f / 60.f };
+        std::string Out;
+    };
+
+    struct Summary {
+        double Mean{ 0.0 };
+        double P50{ 0.0 };
+        double P95{ 0.0 };
+        double P99{ 0.0 };
+        double Max{ 0.0 };
+    };
+
+    struct RunResult {
+        int Balls{ 0 };
+        Summary StepMs;
+        Summary Pairs;
+        Summary CollidingPairs;
+        double AllocationsPerFrame{ 0.0 };
+        uint64_t PeakMemoryBytes{ 0 };
+        uint64_t PositionHash{ 0 };
+    };
+
+    Summary Summarize(std::vector<double> values) {
+        Summary summary;
+        if (values.empty())
+            return summary;
+
+        std::sort(values.begin(), values.end());
+        double sum{ 0.0 };
+        for (auto value : values)
+            sum += value;
+        summary.Mean = sum / static_cast<double>(values.size());
+        summary.P50 = Bench::Percentile(values, 50.0);
+        summary.P95 = Bench::Percentile(values, 95.0);
+        summary.P99 = Bench::Percentile(values, 99.0);
+        summary.Max = values.back();
+        return summary;
+    }
+
+    // Same rain as Application::SpawnRain, minus everything that needs a renderer.
+    void SpawnRain(entt::registry& registry, const TerrainComponent& terrain, int count) {
+        std::vector<float> radii(count);
+        std::vector<glm::vec3> positions(count);
+        auto& random = Random::Get();
+        random.Fill(radii, 0.2f, 0.7f);
+        random.Fill(positions, glm::vec3(0.f, 20.f, 0.f), glm::vec3(terrain.Height, 20.f, terrain.Width));
+
+        TimeComponent time;
+        time.CreationTime = Timer::GetTime();
+        time.LastPoint = time.CreationTime;
+
+        for (int i = 0; i < count; i++) {
+            const auto entity = registry.create();
+
+            auto& transform = registry.emplace<TransformComponent>(entity);
+            transform.Position = positions[i];
+            transform.Scale = glm::vec3(radii[i]);
+
+            auto& ball = registry.emplace<BallComponent>(entity);
+            ball.Radius = radii[i];
+            ball.Mass = ball.Radius * 10.f;
+            ball.Elasticity = 0.10f;
+            ball.CollisionSphere.radius = ball.Radius;
+            ball.CollisionSphere.pos = transform.Position;
+
+            registry.emplace<VelocityComponent>(entity, glm::vec3(0.f), glm::vec3(0.f));
+            registry.emplace<TimeComponent>(entity, time);
+        }
+    }
+
+    // One physics frame, the same stages as Application::Simulate without LOD, trails and debug drawing.
+    double Step(entt::registry& registry, TerrainComponent& terrain, ContactCache& contacts, CollisionEventStream& events, float deltaTime) {
+        Profiler::BeginFrame();
+        Timer physicsTimer;
+        Timer stageTimer;
+
+        AABB worldExtents{};
+        worldExtents.extent = glm::vec3(static_cast<float>(terrain.Width));
+        worldExtents.pos = worldExtents.extent / 2.f;
+        Octree octree(worldExtents);
+        Profiler::Count(ProfileCounter::OctreeNodes);
+
+        auto view = registry.view<TransformComponent, VelocityComponent, BallComponent, TimeComponent>();
+        for (auto [entity, transform, velocity, ball, time] : view.each())
+            octree.Insert(std::make_shared<CollisionObject>(entity, &ball.CollisionSphere, transform, velocity, ball));
+        Profiler::AddTime(ProfileStage::OctreeBuild, stageTimer.Delta());
+
+        Simulate::ResolveBallCollisions(octree, contacts, events, 0);
+        stageTimer.Delta();
+
+        glm::vec3 friction(0.f);
+        for (auto [entity, transform, velocity, ball, time] : view.each()) {
+            Profiler::Count(ProfileCounter::BallsSimulated);
+            CollisionObject ballObject(entity, &ball.CollisionSphere, transform, velocity, ball);
+            Simulate::StepBall(ballObject, terrain, time, events, 0, deltaTime, friction);
+            velocity.Force = glm::vec3(0.f);
+
+            if (transform.Position.y <= terrain.MinY * 1.2f) {
+                auto& random = Random::Get();
+                transform.Position = glm::vec3(random.Float(0.f, terrain.Height), 20.f, random.Float(0.f, terrain.Width));
+                velocity.Velocity = glm::vec3(0.f);
+                ball.CollisionSphere.pos = transform.Position;
+            }
+        }
+        Profiler::AddTime(ProfileStage::BallUpdate, stageTimer.Delta());
+
+        const double physicsTime = physicsTimer.Delta();
+        events.Dispatch();
+
+        Profiler::AddTime(ProfileStage::Physics, physicsTime);
+        Profiler::EndFrame();
+        return physicsTime;
+    }
+
+    // FNV-1a over the final ball positions. Equal hashes mean the run reproduced exactly.
+    uint64_t HashPositions(entt::registry& registry) {
+        uint64_t hash = 0xCBF29CE484222325ull;
+        auto view = registry.view<TransformComponent, BallComponent>();
+        for (auto [entity, transform, ball] : view.each()) {
+            const auto* bytes = reinterpret_cast<const unsigned char*>(&transform.Position);
+            for (size_t i = 0; i < sizeof(transform.Position); i++) {
+                hash ^= bytes[i];
+                hash *= 0x100000001B3ull;
+            }
+        }
+        return hash;
+    }
+
+    RunResult Run(const BenchSettings& settings, TerrainComponent& terrain, int balls) {
+        Random::SetSeed(settings.Seed);
+
+        entt::registry registry;
+        ContactCache contacts;
+        CollisionEventStream events;
+        SpawnRain(registry, terrain, balls);
+
+        for (int i = 0; i < settings.Warmup; i++)
+            Step(registry, terrain, contacts, events, settings.DeltaTime);
+
+        std::vector<double> stepMs;
+        std::vector<double> pairs;
+        std::vector<double> collidingPairs;
+        double allocations{ 0.0 };
+        for (int i = 0; i < settings.Frames; i++) {
+            stepMs.push_back(Step(registry, terrain, contacts, events, settings.DeltaTime) * 1000.0);
+            pairs.push_back(static_cast<double>(Profiler::GetCounter(ProfileCounter::PairsTested)));
+            collidingPairs.push_back(static_cast<double>(Profiler::GetCounter(ProfileCounter::PairsColliding)));
+            allocations += static_cast<double>(Profiler::GetCounter(ProfileCounter::Allocations));
+        }
+
+        RunResult result;
+        result.Balls = balls;
+        result.StepMs = Summarize(std::move(stepMs));
+        result.Pairs = Summarize(std::move(pairs));
+        result.CollidingPairs = Summarize(std::move(collidingPairs));
+        result.AllocationsPerFrame = settings.Frames > 0 ? allocations / settings.Frames : 0.0;
+        result.PeakMemoryBytes = Bench::PeakMemoryBytes();
+        result.PositionHash = HashPositions(registry);
+        return result;
+    }
+
+    void WriteSummary(std::ostream& out, const char* name, const Summary& summary) {
+        out << "\"" << name << "\": { \"mean\": " << summary.Mean << ", \"p50\": " << summary.P50
+            << ", \"p95\": " << summary.P95 << ", \"p99\": " << summary.P99 << ", \"max\": " << summary.Max << " }";
+    }
+
+    void WriteJson(std::ostream& out, const BenchSettings& settings, const std::vector<RunResult>& results) {
+        out << "{\n";
+        out << "  \"benchmark\": \"rain\",\n";
+        out << "  \"terrain\": \"" << settings.Terrain << "\",\n";
+        out << "  \"seed\": " << settings.Seed << ",\n";
+        out << "  \"frames\": " << settings.Frames << ",\n";
+        out << "  \"warmup\": " << settings.Warmup << ",\n";
+        out << "  \"deltaTime\": " << settings.DeltaTime << ",\n";
+        out << "  \"runs\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            const auto& result = results[i];
+            out << "    {\n";
+            out << "      \"balls\": " << result.Balls << ",\n";
+            out << "      "; WriteSummary(out, "stepMs", result.StepMs); out << ",\n";
+            out << "      "; WriteSummary(out, "pairs", result.Pairs); out << ",\n";
+            out << "      "; WriteSummary(out, "collidingPairs", result.CollidingPairs); out << ",\n";
+            out << "      \"allocationsPerFrame\": " << result.AllocationsPerFrame << ",\n";
+            out << "      \"peakMemoryBytes\": " << result.PeakMemoryBytes << ",\n";
+            out << "      \"positionHash\": \"" << std::hex << result.PositionHash << std::dec << "\"\n";
+            out << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n";
+        out << "}\n";
+    }
+
+    std::vector<int> ParseCounts(const std::string& list) {
+        std::vector<int> counts;
+        std::stringstream stream(list);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            const int count = std::atoi(item.c_str());
+            if (count > 0)
+                counts.push_back(count);
+        }
+        return counts;
+    }
+
+    bool ParseArgs(int argc, char** argv, BenchSettings& settings) {
+        for (int i = 1; i < argc; i++) {
+            const char* arg = argv[i];
+            const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+            if (!value) {
+                std::cerr << "Missing value for " << arg << "\n";
+                return false;
+            }
+            if (std::strcmp(arg, "--terrain") == 0)
+                settings.Terrain = value;
+            else if (std::strcmp(arg, "--balls") == 0)
+                settings.BallCounts = ParseCounts(value);
+            else if (std::strcmp(arg, "--frames") == 0)
+                settings.Frames = std::max(std::atoi(value), 1);
+            else if (std::strcmp(arg, "--warmup") == 0)
+                settings.Warmup = std::max(std::atoi(value), 0);
+            else if (std::strcmp(arg, "--seed") == 0)
+                settings.Seed = std::strtoull(value, nullptr, 10);
+            else if (std::strcmp(arg, "--dt") == 0)
+                settings.DeltaTime = static_cast<float>(std::atof(value));
+            else if (std::strcmp(arg, "--out") == 0)
+                settings.Out = value;
+            else {
+                std::cerr << "Unknown argument " << arg << "\n";
+                return false;
+            }
+            i++;
+        }
+        return !settings.BallCounts.empty();
+    }
+}
+
+int main(int argc, char** argv) {
+    BenchSettings settings;
+    if (!ParseArgs(argc, argv, settings))
+        return 1;
+
+    Utils::Logger::s_Logger = new Utils::Logger("FloofBench.log");
+    // Pair and allocation counts are read back from the profiler.
+    Profiler::SetEnabled(true);
+
+    LasLoader mapData(settings.Terrain);
+    TerrainComponent terrain(mapData.TakeHeightGrid());
+    terrain.MinY = mapData.GetMinY();
+    if (terrain.Width == 0 || terrain.Height == 0) {
+        std::cerr << "Could not load terrain " << settings.Terrain << "\n";
+        delete Utils::Logger::s_Logger;
+        return 1;
+    }
+
+    std::sort(settings.BallCounts.begin(), settings.BallCounts.end());
+
+    std::vector<RunResult> results;
+    for (auto balls : settings.BallCounts) {
+        std::cerr << "Rain " << balls << " balls, " << settings.Frames << " frames\n";
+        results.push_back(Run(settings, terrain, balls));
+    }
+
+    if (settings.Out.empty()) {
+        WriteJson(std::cout, settings, results);
+    } else {
+        std::ofstream file(settings.Out);
+        WriteJson(file, settings, results);
+    }
+
+    delete Utils::Logger::s_Logger;
+    return 0;
+}
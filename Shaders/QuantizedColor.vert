@@ -0,0 +1,18 @@
+#version 450
+
+// Positions are steps on the 16-bit grid of a box, the box matrix in the MVP takes them back. See QuantizedColorVertex.
+layout(location = 0) in uvec4 pos;
+layout(location = 1) in vec4 color;
+
+layout(location = 0) out vec4 fragColor;
+
+layout(push_constant) uniform PushConstants {
+    mat4 MVP;
+} pushConstants;
+
+
+void main() {
+    gl_PointSize = 1.0;
+    gl_Position = pushConstants.MVP * vec4(vec3(pos.xyz), 1.0);
+    fragColor = vec4(color.rgb, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#version 450
+
+// Positions are steps on the 16-bit grid of a box, the box matrix in the mvp takes them back. The normal is
+// octahedral in the last component. See QuantizedColorNormalVertex and Quantize::DecodeNormal.
+layout(location = 0) in uvec4 posNormal;
+layout(location = 1) in vec4 color;
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec3 fragNormal;
+
+layout(push_constant) uniform PushConstants {
+    mat4 mvp;
+    mat4 imodel;
+} pushConstants;
+
+vec3 decodeNormal(uint encoded) {
+    vec2 e = (vec2(encoded & 0xFFu, encoded >> 8u) - 127.0) / 127.0;
+    vec3 normal = vec3(e.x, 1.0 - abs(e.x) - abs(e.y), e.y);
+    if (normal.y < 0.0) {
+        normal.x = (1.0 - abs(e.y)) * (e.x >= 0.0 ? 1.0 : -1.0);
+        normal.z = (1.0 - abs(e.x)) * (e.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(normal);
+}
+
+
+void main() {
+    gl_Position = pushConstants.mvp * vec4(vec3(posNormal.xyz), 1.0);
+    fragColor = vec4(color.rgb, 1.0);
+    fragNormal = normalize(mat3(transpose(pushConstants.imodel)) * decodeNormal(posNormal.w));
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#include "Profiler.h"
+
+#include <cstdlib>
+#include <new>
+
+// Replaces the global operator new so the profiler can count allocations per frame. Linked into the app and
+// floof_bench_rain, not into FloofCore, so programs that do not show the counters keep the default allocator.
+
+void* operator new(std::size_t size) {
+    FLOOF::Profiler::RecordAllocation(size);
+    if (void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
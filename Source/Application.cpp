@@ -1,15 +1,21 @@
 #include "Application.h"
 #include "Timer.h"
+#include "Profiler.h"
+#include "Random.h"
 #include "Components.h"
 #include "Input.h"
 #include "Utils.h"
 #include "Physics.h"
+#include <algorithm>
 #include <string>
+#include <cfloat>
+#include <cstdlib>
 #include "stb_image.h"
 #include "imgui_impl_glfw.h"
 #include "LasLoader.h"
 #include "Octree.h"
 #include "Simulate.h"
+#include "LoggerMacros.h"
 
 namespace FLOOF {
     Application::Application() {
@@ -57,6 +63,11 @@ namespace FLOOF {
         // Init Logger. Writes to specified log file.
         Utils::Logger::s_Logger = new Utils::Logger("Floof.log");
 
+        // Same seed, same rain. FLOOF_SEED overrides the default.
+        if (const char* seed = std::getenv("FLOOF_SEED"))
+            m_Seed = std::strtoull(seed, nullptr, 10);
+        Random::SetSeed(m_Seed);
+
     }
 
     Application::~Application() {
@@ -78,17 +89,21 @@ namespace FLOOF {
     int Application::Run() {
         DebugInit();
 
-        {
-            LasLoader mapData("Assets/jotun.las");
-            auto [vData, iData] = mapData.GetIndexedColorNormalVertexData();
-            auto terrainData = mapData.GetTerrainData();
+        m_TrailPool = std::make_unique<TrailPool>(m_MaxBSplinePoints, m_TrailVerticesPerSlot);
+        m_Registry.on_destroy<BSplineComponent>().connect<&Application::OnBSplineDestroyed>(this);
 
+        const std::string terrainPath = "Assets/jotun.las";
+        // FLOOF_STREAM_TERRAIN=<MB> streams the terrain in tiles within that memory budget.
+        const char* streamBudget = std::getenv("FLOOF_STREAM_TERRAIN");
+        if (!streamBudget || !LoadStreamedTerrain(terrainPath, static_cast<size_t>(std::max(std::atoi(streamBudget), 1)) << 20)) {
+            // The terrain components are added by UpdateTerrainLoading as the stages come in.
             m_TerrainEntity = m_Registry.create();
-            m_Registry.emplace<PointCloudComponent>(m_TerrainEntity, mapData.GetPointData());
-            m_Registry.emplace<MeshComponent>(m_TerrainEntity, vData, iData);
             m_Registry.emplace<TransformComponent>(m_TerrainEntity);
-            auto& terrain = m_Registry.emplace<TerrainComponent>(m_TerrainEntity, terrainData);
-            terrain.MinY = mapData.GetMinY();
+            TerrainLoader::Settings settings;
+            settings.CellSize = m_TerrainCellSize;
+            settings.PhysicsLevel = m_TerrainPhysicsLevel;
+            settings.PointCloudVoxelSize = m_PointCloudVoxelSize;
+            m_TerrainLoader = std::make_unique<TerrainLoader>(terrainPath, settings);
         }
 
         {
@@ -98,8 +113,6 @@ namespace FLOOF {
             camera.Pitch(0.5f);
         }
 
-        MakeHeightLines();
-
         Timer timer;
         float titleBarUpdateTimer{};
         float titlebarUpdateRate = 0.1f;
@@ -142,7 +155,12 @@ namespace FLOOF {
         }
 
         m_Renderer->FinishAllFrames();
+        m_TerrainLoader.reset();
         m_Registry.clear();
+        m_TrailPool.reset();
+        m_TerrainTileEntities.clear();
+        m_RetiredTerrainMeshes.clear();
+        m_TerrainStreamer.reset();
 
         return 0;
     }
@@ -156,35 +174,35 @@ namespace FLOOF {
         }
 
         // Terrain triangles
-        if (m_BDebugLines[DebugLine::TerrainTriangle]) {
+        if (m_BDebugLines[DebugLine::TerrainTriangle] && m_Registry.all_of<TerrainComponent>(m_TerrainEntity)) {
             TerrainComponent& triangleSurface = m_Registry.get<TerrainComponent>(m_TerrainEntity);
             glm::vec3 surfaceTriangleColor{ 1.f, 0.f, 1.f };
-            for (auto& triangle : triangleSurface.Triangles) {
+            triangleSurface.Grid.ForEachTriangle([&](const Triangle& triangle) {
                 DebugDrawTriangle(triangle, surfaceTriangleColor);
-            }
+            });
         }
 
         // Closest point on triangle to ball center
-        if (m_BDebugLines[DebugLine::ClosestPointToBall]) {
+        if (m_BDebugLines[DebugLine::ClosestPointToBall] && m_Registry.all_of<TerrainComponent>(m_TerrainEntity)) {
             auto& terrain = m_Registry.get<TerrainComponent>(m_TerrainEntity);
             auto view = m_Registry.view<BallComponent>();
             static constexpr glm::vec3 pointColor = glm::vec3(1.f);
             for (auto [entity, ball] : view.each()) {
-                for (auto& triangle : terrain.Triangles) {
+                terrain.Grid.ForEachTriangle([&](const Triangle& triangle) {
                     glm::vec3 start = CollisionShape::ClosestPointToPointOnTriangle(ball.CollisionSphere.pos, triangle);
                     glm::vec3 end = start + (triangle.N * 0.1f);
                     DebugDrawLine(start, end, pointColor);
-                }
+                });
             }
         }
 
         // Terrain triangles
-        if (m_BDebugLines[DebugLine::TerrainTriangle]) {
+        if (m_BDebugLines[DebugLine::TerrainTriangle] && m_Registry.all_of<TerrainComponent>(m_TerrainEntity)) {
             TerrainComponent& triangleSurface = m_Registry.get<TerrainComponent>(m_TerrainEntity);
             glm::vec3 surfaceTriangleColor{ 1.f, 0.f, 1.f };
-            for (auto& triangle : triangleSurface.Triangles) {
+            triangleSurface.Grid.ForEachTriangle([&](const Triangle& triangle) {
                 DebugDrawTriangle(triangle, surfaceTriangleColor);
-            }
+            });
         }
 
         {	// Update camera.
@@ -225,13 +243,16 @@ namespace FLOOF {
             }
         }
 
+        UpdateTerrainLoading();
+        UpdateTerrainStreaming();
+
         {	// UI
             if (m_ShowImguiDemo)
                 ImGui::ShowDemoWindow(&m_ShowImguiDemo);
 
             ImGui::Begin("Utils");
             if (ImGui::Button("Spawn ball")) {
-                const auto& camera = m_Registry.get<CameraComponent>(m_CameraEntity);
+                auto& camera = m_Registry.get<CameraComponent>(m_CameraEntity);
                 SpawnBall(camera.Position, 2.f, 200.f, 0.9f, "Assets/BallTexture.png");
             }
             /*if(ImGui::Button("DrawNormals")){
@@ -259,17 +280,154 @@ namespace FLOOF {
             (ImGui::Checkbox(("Point Cloud"), &m_BShowPointcloud));
             ImGui::End();
 
+            ImGui::Begin("Terrain LOD");
+            ImGui::SliderFloat("Max Error (px)", &m_TerrainPixelError, 0.f, 16.f);
+            ImGui::Text("Triangles = %u", m_TerrainTrianglesDrawn);
+            ImGui::End();
+
+            ImGui::Begin("Point Cloud LOD");
+            ImGui::SliderInt("Point Budget", &m_PointBudget, 100000, 20000000);
+            ImGui::SliderFloat("Max Spacing (px)", &m_PointPixelSpacing, 0.5f, 16.f);
+            ImGui::Text("Points = %llu", static_cast<unsigned long long>(m_PointsDrawn));
+            for (auto [entity, cloud] : m_Registry.view<PointCloudLodComponent>().each())
+                ImGui::Text("Resident = %u nodes, %.2f MB", cloud.GetResidentNodes(), cloud.GetResidentBytes() / (1024.0 * 1024.0));
+            ImGui::End();
+
             ImGui::Begin("Oppgaver");
             static int raincount = 100;
             ImGui::SliderInt("Rain Ball Count", &raincount, 100, 5000);
             if (ImGui::Button("Spawn Rain"))
                 SpawnRain(raincount);
+            if (ImGui::Button("Benchmark Spawn 10k")) {
+                SpawnRain(10000);
+                std::string msg = "Spawned " + std::to_string(m_LastSpawnCount) + " balls in " + std::to_string(m_LastSpawnTime * 1000.0) + " ms";
+                LOG_INFO(msg.c_str());
+            }
+            ImGui::InputScalar("Seed", ImGuiDataType_U64, &m_Seed);
+            ImGui::SameLine();
+            if (ImGui::Button("Reseed"))
+                Random::SetSeed(m_Seed);
             ImGui::Text("Balls In World = %i", m_BallCount);
+            ImGui::Text("Last Spawn = %zu balls in %.2f ms", m_LastSpawnCount, m_LastSpawnTime * 1000.0);
+            ImGui::SliderFloat("Trail Error (px)", &m_TrailPixelError, 0.1f, 10.f);
+            ImGui::Text("Trails = %u / %u slots, %u vertices", m_TrailPool->GetActiveSlotCount(), m_TrailPool->GetSlotCount(), m_TrailPool->GetUsedVertexCount());
+            ImGui::Text("Trail Memory = %.2f MB GPU, %.2f MB CPU", m_TrailPool->GetGpuMemoryUsage() / (1024.0 * 1024.0), m_TrailPool->GetCpuMemoryUsage() / (1024.0 * 1024.0));
+            ImGui::End();
+
+            ImGui::Begin("Contact Cache");
+            const auto& stats = m_ContactCache.GetStats();
+            ImGui::Checkbox("Warm Starting", &m_ContactCache.WarmStarting);
+            ImGui::SliderFloat("Warm Start Factor", &m_ContactCache.WarmStartFactor, 0.f, 1.f);
+            ImGui::Text("Pairs = %u", stats.Pairs);
+            ImGui::Text("Begin = %u  Persist = %u  End = %u", stats.Began, stats.Persisted, stats.Ended);
+            ImGui::Text("Hit Rate = %.1f%%", stats.HitRate() * 100.f);
+            ImGui::Text("Narrowphase Skipped = %u", stats.Reused);
+            ImGui::Separator();
+            bool countEvents = !m_EventCounterHandles.empty();
+            if (ImGui::Checkbox("Count Collision Events", &countEvents))
+                ToggleCollisionEventCounter(countEvents);
+            ImGui::SliderFloat("Min Terrain Impulse", &m_CollisionEvents.MinTerrainImpulse, 0.f, 100.f);
+            if (countEvents) {
+                ImGui::Text("Contact Begin = %u", m_EventCounts[static_cast<size_t>(CollisionEventType::ContactBegin)]);
+                ImGui::Text("Contact End = %u", m_EventCounts[static_cast<size_t>(CollisionEventType::ContactEnd)]);
+                ImGui::Text("Terrain Impact = %u", m_EventCounts[static_cast<size_t>(CollisionEventType::TerrainImpact)]);
+            }
+            ImGui::End();
+
+            ImGui::Begin("Simulation LOD");
+            ImGui::Checkbox("Enabled", &m_SimulationLod.Enabled);
+            ImGui::SliderFloat("Budget (ms)", &m_SimulationLod.BudgetMs, 0.5f, 33.f);
+            ImGui::SliderFloat("Max Step", &m_SimulationLod.MaxStep, 0.01f, 1.f);
+            const auto& tierCounts = m_SimulationLod.GetTierCounts();
+            for (size_t i = 0; i < m_SimulationLod.Tiers.size(); i++) {
+                auto& tier = m_SimulationLod.Tiers[i];
+                ImGui::PushID(static_cast<int>(i));
+                ImGui::Text("Tier %zu: %u balls", i, i < tierCounts.size() ? tierCounts[i] : 0u);
+                // The last tier takes every visible ball past the others, its distance is never read.
+                if (i + 1 < m_SimulationLod.Tiers.size())
+                    ImGui::SliderFloat("Max Distance", &tier.MaxDistance, 0.f, 2000.f);
+                else
+                    ImGui::Text("Max Distance: unbounded");
+                const uint32_t minInterval{ 1 };
+                const uint32_t maxInterval{ 32 };
+                ImGui::SliderScalar("Interval", ImGuiDataType_U32, &tier.Interval, &minInterval, &maxInterval);
+                ImGui::PopID();
+            }
+            ImGui::Text("Off-screen: %u balls", tierCounts.empty() ? 0u : tierCounts.back());
+            const uint32_t minOffscreenInterval{ 1 };
+            const uint32_t maxOffscreenInterval{ 64 };
+            ImGui::SliderScalar("Off-screen Interval", ImGuiDataType_U32, &m_SimulationLod.OffscreenInterval, &minOffscreenInterval, &maxOffscreenInterval);
+            ImGui::Separator();
+            ImGui::Text("Stepped This Frame = %u", m_SimulationLod.GetSteppedCount());
+            ImGui::Text("Interval Scale = %u", m_SimulationLod.GetIntervalScale());
+            ImGui::Text("Physics = %.2f ms", m_SimulationLod.GetPhysicsTime() * 1000.0);
+            ImGui::End();
+
+            if (m_TerrainLoader) {
+                ImGui::Begin("Terrain Loading");
+                const uint32_t step = m_TerrainLoader->GetStep();
+                const float fraction = static_cast<float>(step) / static_cast<float>(TerrainLoader::GetStepCount());
+                ImGui::ProgressBar(fraction, ImVec2(-1.f, 0.f), m_TerrainLoader->GetStepName());
+                ImGui::Text("%.1f s", m_TerrainLoader->GetSeconds());
+                ImGui::End();
+            }
+            if (m_TerrainStreamer) {
+                ImGui::Begin("Terrain Streaming");
+                ImGui::SliderFloat("Load Radius", &m_TerrainStreamer->LoadRadius, 64.f, 4096.f);
+                int budgetMB = static_cast<int>(m_TerrainStreamer->MemoryBudget >> 20);
+                if (ImGui::SliderInt("Budget (MB)", &budgetMB, 16, 4096))
+                    m_TerrainStreamer->MemoryBudget = static_cast<size_t>(budgetMB) << 20;
+                const auto& tiles = m_TerrainStreamer->GetTileSet();
+                ImGui::Text("Resident = %u / %u tiles, %.1f MB", m_TerrainStreamer->GetResidentCount(), tiles.GetTileCount(),
+                    m_TerrainStreamer->GetResidentBytes() / (1024.0 * 1024.0));
+                ImGui::Text("Queued = %u", m_TerrainStreamer->GetQueuedCount());
+                ImGui::Text("Loaded = %llu  Evicted = %llu", static_cast<unsigned long long>(m_TerrainStreamer->GetLoadedTotal()),
+                    static_cast<unsigned long long>(m_TerrainStreamer->GetEvictedTotal()));
+                ImGui::End();
+            }
+
+            ImGui::Begin("Profiler");
+            bool profile = Profiler::IsEnabled();
+            if (ImGui::Checkbox("Enabled", &profile))
+                Profiler::SetEnabled(profile);
+            ImGui::SameLine();
+            if (ImGui::Button("Dump CSV")) {
+                if (Profiler::DumpCsv("FloofProfile.csv")) {
+                    LOG_INFO("Wrote profiler history to FloofProfile.csv");
+                } else {
+                    LOG_ERROR("Failed to write FloofProfile.csv");
+                }
+            }
+            for (size_t i = 0; i < Profiler::StageCount; i++) {
+                auto stage = static_cast<ProfileStage>(i);
+                std::string overlay = std::to_string(Profiler::GetTime(stage) * 1000.0) + " ms";
+                ImGui::PlotLines(Profiler::GetName(stage), Profiler::GetHistory(stage), Profiler::HistorySize,
+                    Profiler::GetHistoryOffset(), overlay.c_str(), 0.f, FLT_MAX, ImVec2(0.f, 40.f));
+            }
+            ImGui::Separator();
+            for (size_t i = 0; i < Profiler::CounterCount; i++) {
+                auto counter = static_cast<ProfileCounter>(i);
+                std::string overlay = std::to_string(Profiler::GetCounter(counter));
+                ImGui::PlotLines(Profiler::GetName(counter), Profiler::GetHistory(counter), Profiler::HistorySize,
+                    Profiler::GetHistoryOffset(), overlay.c_str(), 0.f, FLT_MAX, ImVec2(0.f, 40.f));
+            }
+            const uint64_t ballsSimulated = Profiler::GetCounter(ProfileCounter::BallsSimulated);
+            if (ballsSimulated > 0) {
+                ImGui::Text("Triangles Tested Per Ball = %.2f",
+                    static_cast<double>(Profiler::GetCounter(ProfileCounter::TrianglesTested)) / static_cast<double>(ballsSimulated));
+            }
             ImGui::End();
         }
     }
 
     void Application::Simulate(double deltaTime) {
+        // Balls wait in the air until the first terrain stage is in.
+        if (!m_Registry.all_of<TerrainComponent>(m_TerrainEntity))
+            return;
+
+        Profiler::BeginFrame();
+        Timer physicsTimer;
+        Timer stageTimer;
 
         deltaTime *= m_DeltaTimeModifier;
 
@@ -278,12 +436,14 @@ namespace FLOOF {
         worldExtents.extent = glm::vec3(static_cast<float>(terrain.Width));
         worldExtents.pos = worldExtents.extent / 2.f;
         Octree octree(worldExtents);
+        Profiler::Count(ProfileCounter::OctreeNodes);
 
         {
             auto view = m_Registry.view<TransformComponent, VelocityComponent, BallComponent>();
             for (auto [entity, transform, velocity, ball] : view.each()) {
-                octree.Insert(std::make_shared<CollisionObject>(&ball.CollisionSphere, transform, velocity, ball));
+                octree.Insert(std::make_shared<CollisionObject>(entity, &ball.CollisionSphere, transform, velocity, ball));
             }
+            Profiler::AddTime(ProfileStage::OctreeBuild, stageTimer.Delta());
 
 
             if (m_BDebugLines[DebugLine::OctTree]) {
@@ -295,76 +455,59 @@ namespace FLOOF {
                     DebugDrawAABB(aabb.pos, aabb.extent);
                 }
             }
-
+            stageTimer.Delta();
         }
 
         {	// Calculate ball
 
-            std::vector<std::pair<CollisionObject*, CollisionObject*>> collisionPairs;
-            octree.GetCollisionPairs(collisionPairs);
-
-            for (auto& [obj1, obj2] : collisionPairs) {
-                Simulate::CalculateCollision(obj1, obj2);
-                Simulate::BallBallOverlap(obj1, obj2);
-
-            }
+            Simulate::ResolveBallCollisions(octree, m_ContactCache, m_CollisionEvents, s_MainPhysicsWorker);
+            stageTimer.Delta();
 
             glm::vec3 fri(0.f);
 
-            auto view = m_Registry.view<TransformComponent, BallComponent, VelocityComponent, TimeComponent, BSplineComponent>();
-            for (auto [entity, transform, ball, velocity, time, bSpline] : view.each()) {
+            // World space size of one pixel at unit distance, scales the trail error tolerance.
+            auto& camera = m_Registry.get<CameraComponent>(m_CameraEntity);
+            const float pixelSize = 2.f * std::tan(glm::radians(m_FieldOfView) * 0.5f) / static_cast<float>(std::max(m_Renderer->GetExtent().height, 1u));
+            const float trailErrorPerDistance = m_TrailPixelError * pixelSize;
 
-                CollisionObject ballObject(&ball.CollisionSphere, transform, velocity, ball);
+            m_SimulationLod.BeginFrame(camera);
 
-                velocity.Force = Math::GravitationalPull * ball.Mass;
+            auto view = m_Registry.view<TransformComponent, BallComponent, VelocityComponent, TimeComponent, BSplineComponent, SimulationLodComponent>();
+            for (auto [entity, transform, ball, velocity, time, bSpline, lod] : view.each()) {
+                const float ballDeltaTime = m_SimulationLod.Schedule(entity, ball.CollisionSphere, lod, static_cast<float>(deltaTime));
+                if (ballDeltaTime == 0.f)
+                    continue;
+                Profiler::Count(ProfileCounter::BallsSimulated);
 
-                //ball Large terrain collision//
-                auto collisions = terrain.GetOverlappingTriangles(&ball.CollisionSphere);
-                for (auto& tri : collisions) {
-                    if (ball.CollisionSphere.Intersect(tri)) {
-                        Simulate::CalculateCollision(&ballObject, *tri, time, fri);
-                        if (bSpline.empty()) {
-                            std::vector<glm::vec3> first;
-                            for (int i{ 0 }; i <= (BSplineComponent::D + 1); i++)
-                                first.emplace_back(transform.Position);
-                            bSpline.Update(first);
-                        }
+                CollisionObject ballObject(entity, &ball.CollisionSphere, transform, velocity, ball);
 
-                    }
-                    //Triangle checking collision with
-                    if (m_BDebugLines[DebugLine::CollisionTriangle])
-                        DebugDrawTriangle(*tri, glm::vec3(255.f, 0.f, 0.f));
+                //Triangle checking collision with
+                if (m_BDebugLines[DebugLine::CollisionTriangle]) {
+                    for (auto& tri : terrain.GetOverlappingTriangles(&ball.CollisionSphere))
+                        DebugDrawTriangle(tri, glm::vec3(255.f, 0.f, 0.f));
                 }
 
-                //https://en.wikipedia.org/wiki/Verlet_integration
-                transform.Position += (velocity.Velocity * static_cast<float>(deltaTime)) + (((velocity.Force) + fri) * (static_cast<float>(deltaTime) * static_cast<float>(deltaTime) * 0.5f));
-                velocity.Velocity += (((velocity.Force / ball.Mass) + fri) * static_cast<float>(deltaTime) * 0.5f);
-
-                //set collision sphere location
-                ball.CollisionSphere.pos = transform.Position;
+                const bool touchedTerrain = Simulate::StepBall(ballObject, terrain, time, m_CollisionEvents, s_MainPhysicsWorker, ballDeltaTime, fri);
+                if (touchedTerrain && bSpline.empty()) {
+                    std::vector<glm::vec3> first;
+                    for (int i{ 0 }; i <= (BSplineComponent::D + 1); i++)
+                        first.emplace_back(transform.Position);
+                    bSpline.Update(first);
+                }
 
                 const float pointIntervall{ 0.5f };
 
                 // Save ball path and draw BSpline
                 if (Timer::GetTimeSince(time.LastPoint) >= pointIntervall && !bSpline.empty()) {
+                    ProfileScope scope(ProfileStage::BSplineUpdate);
                     time.LastPoint = Timer::GetTime();
-                    if (bSpline.Isvalid() && bSpline.size() < m_MaxBSplineLines) {
-                        bSpline.AddControllPoint(transform.Position);
+                    if (bSpline.Isvalid()) {
+                        bSpline.AddControllPoint(transform.Position, trailErrorPerDistance * glm::distance(camera.Position, transform.Position));
 
                         if (m_BDebugLines[DebugLine::BSpline]) {
-                            std::vector<ColorVertex> vBuffer(m_MaxBSplineLines);
-                            float deltaT = (bSpline.TMax - bSpline.TMin) / (float)m_MaxBSplineLines;
                             glm::vec3 color{ 0.05f, 0.1f, 0.8f };
-                            //glm::vec3 color{4,  Math::RandFloat(0.f,1.f),  Math::RandFloat(0.f,1.f) };
-                            float currentT = bSpline.TMin;
-                            for (auto& vertex : vBuffer) {
-                                vertex.Pos = bSpline.EvaluateBSpline(currentT);
-                                vertex.Color = color;
-                                currentT += deltaT;
-                            }
-
-                            auto& lineMesh = m_Registry.get<LineMeshComponent>(entity);
-                            lineMesh.UpdateBuffer(vBuffer);
+                            //glm::vec3 color{4,  Random::Get().Float(0.f,1.f),  Random::Get().Float(0.f,1.f) };
+                            bSpline.Tessellate(m_BSplineMaxSamplesPerSpan, trailErrorPerDistance, camera.Position, color);
                         }
                     }
                 }
@@ -389,14 +532,27 @@ namespace FLOOF {
                     const int maxX{ terrain.Height };
                     const int minZ{ 0 };
                     const int maxZ{ terrain.Width };
-                    glm::vec3 loc(Math::RandDouble(minX, maxX), 20.f, Math::RandDouble(minZ, maxZ));
+                    auto& random = Random::Get();
+                    glm::vec3 loc(random.Float(minX, maxX), 20.f, random.Float(minZ, maxZ));
                     transform.Position = loc;
                     velocity.Velocity = glm::vec3(0.f);
                     bSpline.clear();
                 }
 
             }
+            Profiler::AddTime(ProfileStage::BallUpdate, stageTimer.Delta());
+        }
+
+        const double physicsTime = physicsTimer.Delta();
+        m_SimulationLod.EndFrame(physicsTime);
+
+        {
+            ProfileScope scope(ProfileStage::EventDispatch);
+            m_CollisionEvents.Dispatch();
         }
+
+        Profiler::AddTime(ProfileStage::Physics, physicsTime);
+        Profiler::EndFrame();
     }
 
     void Application::Draw() {
@@ -405,7 +561,7 @@ namespace FLOOF {
         // Camera setup
         auto extent = m_Renderer->GetExtent();
         CameraComponent& camera = m_Registry.get<CameraComponent>(m_CameraEntity);
-        glm::mat4 vp = camera.GetVP(glm::radians(70.f), extent.width / (float)extent.height, 0.01f, 2000.f);
+        glm::mat4 vp = camera.GetVP(glm::radians(m_FieldOfView), extent.width / (float)extent.height, 0.01f, 2000.f);
 
         if (!m_DrawNormals) {	// Geometry pass
 
@@ -416,8 +572,8 @@ namespace FLOOF {
                 vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT,
                     0, sizeof(ColorPushConstants), &constants);
 
-                auto& lineMesh = m_Registry.get<LineMeshComponent>(m_HeightLinesEntity);
-                lineMesh.Draw(commandBuffer);
+                if (m_Registry.valid(m_HeightLinesEntity))
+                    m_Registry.get<LineMeshComponent>(m_HeightLinesEntity).Draw(commandBuffer);
             }
             if (m_BDebugLines[DebugLine::BSpline]) {	// Draw BSplines
                 ColorPushConstants constants;
@@ -426,20 +582,15 @@ namespace FLOOF {
                 vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT,
                     0, sizeof(ColorPushConstants), &constants);
 
-                auto view = m_Registry.view<LineMeshComponent, BSplineComponent>();
-                for (auto [entity, lineMesh, bSpline] : view.each()) {
-                    lineMesh.Draw(commandBuffer);
-                }
+                m_TrailPool->Draw(commandBuffer);
             }
             {	// Draw terrain
-                MeshPushConstants constants;
-                constants.MVP = vp;
-                constants.InvModelMat = glm::mat4(1.f);
-                auto pipelineLayout = m_Renderer->BindGraphicsPipeline(commandBuffer, RenderPipelineKeys::LitColor);
-                vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT,
-                    0, sizeof(MeshPushConstants), &constants);
-                auto& terrain = m_Registry.get<MeshComponent>(m_TerrainEntity);
-                terrain.Draw(commandBuffer);
+                auto pipelineLayout = m_Renderer->BindGraphicsPipeline(commandBuffer, RenderPipelineKeys::QuantizedLitColor);
+                const float pixelsPerUnit = static_cast<float>(extent.height) / (2.f * std::tan(glm::radians(m_FieldOfView) * 0.5f));
+                m_TerrainTrianglesDrawn = 0;
+                auto view = m_Registry.view<TerrainLodComponent>();
+                for (auto [entity, terrain] : view.each())
+                    m_TerrainTrianglesDrawn += terrain.Draw(commandBuffer, pipelineLayout, vp, camera.Position, pixelsPerUnit, m_TerrainPixelError);
             }
             {	// Draw models
                 auto pipelineLayout = m_Renderer->BindGraphicsPipeline(commandBuffer, RenderPipelineKeys::Basic);
@@ -479,15 +630,13 @@ namespace FLOOF {
         }
 
         if (m_BShowPointcloud) {	// Draw point cloud
-            auto pipelineLayout = m_Renderer->BindGraphicsPipeline(commandBuffer, RenderPipelineKeys::Point);
-            auto view = m_Registry.view<PointCloudComponent>();
-            for (auto [entity, cloud] : view.each()) {
-                ColorPushConstants constants;
-                constants.MVP = vp;
-                vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT,
-                    0, sizeof(ColorPushConstants), &constants);
-                cloud.Draw(commandBuffer);
-            }
+            auto pipelineLayout = m_Renderer->BindGraphicsPipeline(commandBuffer, RenderPipelineKeys::QuantizedPoint);
+            Frustum frustum(camera);
+            const float pixelsPerUnit = static_cast<float>(extent.height) / (2.f * std::tan(glm::radians(m_FieldOfView) * 0.5f));
+            m_PointsDrawn = 0;
+            auto view = m_Registry.view<PointCloudLodComponent>();
+            for (auto [entity, cloud] : view.each())
+                m_PointsDrawn += cloud.Draw(commandBuffer, pipelineLayout, vp, frustum, camera.Position, pixelsPerUnit, m_PointPixelSpacing, static_cast<uint64_t>(m_PointBudget));
         }
 
         if (m_DebugDraw) { // Draw debug lines
@@ -624,30 +773,18 @@ namespace FLOOF {
         std::vector<ColorVertex> heightLines;
         glm::vec3 color{ 1.f, 1.f, 1.f };
         auto& terrain = m_Registry.get<TerrainComponent>(m_TerrainEntity);
-        float minY = std::numeric_limits<float>::max();
-        float maxY = std::numeric_limits<float>::min();
-        for (auto& triangle : terrain.Triangles) {
-            if (triangle.A.y < minY)
-                minY = triangle.A.y;
-            if (triangle.B.y < minY)
-                minY = triangle.B.y;
-            if (triangle.C.y < minY)
-                minY = triangle.C.y;
-
-            if (triangle.A.y > maxY)
-                maxY = triangle.A.y;
-            if (triangle.B.y > maxY)
-                maxY = triangle.B.y;
-            if (triangle.C.y > maxY)
-                maxY = triangle.C.y;
-        }
+        const auto [minHeight, maxHeight] = std::minmax_element(terrain.Grid.Heights.begin(), terrain.Grid.Heights.end());
+        if (minHeight == terrain.Grid.Heights.end())
+            return;
+        const float minY = *minHeight;
+        const float maxY = *maxHeight;
 
         Plane p;
         p.pos = glm::vec3(0.f, minY, 0.f);
         p.normal = glm::vec3(0.f, 1.f, 0.f);
         for (float height = minY; height < maxY; height += 50.f) {
             p.pos.y = height;
-            for (auto triangle : terrain.Triangles) {
+            terrain.Grid.ForEachTriangle([&](const Triangle& triangle) {
                 bool above = false;
                 bool below = false;
 
@@ -703,13 +840,115 @@ namespace FLOOF {
                         }
                     }
                 }
-            }
+            });
         }
         m_HeightLinesEntity = m_Registry.create();
         m_Registry.emplace<LineMeshComponent>(m_HeightLinesEntity, heightLines);
     }
 
+    bool Application::LoadStreamedTerrain(const std::string& path, size_t memoryBudget) {
+        const std::string cachePath = TerrainCache::GetCachePath(path);
+        TerrainCache cache;
+        if (!cache.Open(cachePath, path) || cache.GetCellSize() != m_TerrainCellSize) {
+            // Only happens the first time, streaming a survey too big for memory needs it baked beforehand.
+            cache.Close();
+            { LasLoader baking(path, true, m_TerrainCellSize); }
+            if (!cache.Open(cachePath, path)) {
+                LOG_ERROR("Terrain streaming needs a .las source, loading the whole terrain instead");
+                return false;
+            }
+        }
+
+        const std::string tilePath = TerrainTileSet::GetTilePath(path);
+        TerrainTileSet tiles;
+        if (!tiles.Open(tilePath, cache.GetSourceHash(), cache.GetCellSize())) {
+            Timer timer;
+            if (!TerrainTileSet::Write(tilePath, cache) || !tiles.Open(tilePath, cache.GetSourceHash(), cache.GetCellSize())) {
+                LOG_ERROR("Could not write terrain tiles, loading the whole terrain instead");
+                return false;
+            }
+            std::string msg = "Cut terrain into " + std::to_string(tiles.GetTileCount()) + " tiles in " + std::to_string(timer.Delta()) + " s";
+            LOG_INFO(msg.c_str());
+        }
+
+        m_TerrainStreamer = std::make_unique<TerrainStreamer>(std::move(tiles));
+        m_TerrainStreamer->MemoryBudget = memoryBudget;
+
+        m_TerrainEntity = m_Registry.create();
+        m_Registry.emplace<TransformComponent>(m_TerrainEntity);
+        m_Registry.emplace<TerrainComponent>(m_TerrainEntity, m_TerrainStreamer.get());
+        return true;
+    }
+
+    void Application::UpdateTerrainLoading() {
+        if (!m_TerrainLoader)
+            return;
+
+        for (auto& stage : m_TerrainLoader->TakeStages()) {
+            if (stage.Collision) {
+                auto& terrain = m_Registry.emplace_or_replace<TerrainComponent>(m_TerrainEntity, std::move(*stage.Collision));
+                terrain.MinY = stage.MinY;
+            }
+            if (stage.Mesh) {
+                if (m_Registry.valid(m_TerrainMeshEntity))
+                    m_RetiredTerrainMeshes.emplace_back(m_TerrainMeshEntity, m_TerrainFrame + m_Renderer->GetFramesInFlight());
+                m_TerrainMeshEntity = m_Registry.create();
+                m_Registry.emplace<TerrainLodComponent>(m_TerrainMeshEntity, *stage.Mesh);
+            }
+            if (stage.Points)
+                m_Registry.emplace<PointCloudLodComponent>(m_TerrainEntity, std::move(*stage.Points));
+            if (stage.IsPreview) {
+                std::string msg = "Terrain preview in after " + std::to_string(m_TerrainLoader->GetSeconds()) + " s";
+                LOG_INFO(msg.c_str());
+            }
+        }
+
+        if (m_TerrainLoader->IsDone()) {
+            std::string msg = "Terrain loaded in " + std::to_string(m_TerrainLoader->GetSeconds()) + " s";
+            LOG_INFO(msg.c_str());
+            m_TerrainLoader.reset();
+            // Height lines need the whole terrain.
+            MakeHeightLines();
+        }
+    }
+
+    void Application::UpdateTerrainStreaming() {
+        m_TerrainFrame++;
+        std::erase_if(m_RetiredTerrainMeshes, [this](const std::pair<entt::entity, uint64_t>& retired) {
+            if (retired.second > m_TerrainFrame)
+                return false;
+            m_Registry.destroy(retired.first);
+            return true;
+        });
+        if (!m_TerrainStreamer)
+            return;
+
+        m_StreamingBodies.clear();
+        auto view = m_Registry.view<TransformComponent, BallComponent>();
+        for (auto [entity, transform, ball] : view.each())
+            m_StreamingBodies.push_back(transform.Position);
+        auto& camera = m_Registry.get<CameraComponent>(m_CameraEntity);
+        m_TerrainStreamer->Update(camera.Position, m_StreamingBodies);
+
+        for (auto& tile : m_TerrainStreamer->TakeLoaded()) {
+            auto entity = m_Registry.create();
+            m_Registry.emplace<TerrainLodComponent>(entity, tile->Mesh);
+            m_Registry.emplace<TerrainTileComponent>(entity, tile->Index);
+            m_TerrainTileEntities[tile->Index] = entity;
+        }
+        for (uint32_t tile : m_TerrainStreamer->TakeEvicted()) {
+            auto it = m_TerrainTileEntities.find(tile);
+            if (it == m_TerrainTileEntities.end())
+                continue;
+            m_Registry.remove<TerrainTileComponent>(it->second);
+            m_RetiredTerrainMeshes.emplace_back(it->second, m_TerrainFrame + m_Renderer->GetFramesInFlight());
+            m_TerrainTileEntities.erase(it);
+        }
+    }
+
     const void Application::SpawnRain(const int count) {
+        if (!m_Registry.all_of<TerrainComponent>(m_TerrainEntity))
+            return;
 
         auto& terrain = m_Registry.get<TerrainComponent>(m_TerrainEntity);
         const int minX{ 0 };
@@ -717,42 +956,100 @@ namespace FLOOF {
         const int minZ{ 0 };
         const int maxZ{ terrain.Width };
 
+        std::vector<float> radii(count);
+        std::vector<glm::vec3> positions(count);
+        auto& random = Random::Get();
+        random.Fill(radii, 0.2f, 0.7f);
+        random.Fill(positions, glm::vec3(minX, 20.f, minZ), glm::vec3(maxX, 20.f, maxZ));
+
+        std::vector<BallDesc> balls(count);
         for (int i = 0; i < count; i++) {
-            float rad = Math::RandFloat(0.2f, 0.7f);
-            float mass = rad * 10.f;
-            glm::vec3 loc(Math::RandDouble(minX, maxX), 20.f, Math::RandDouble(minZ, maxZ));
-            SpawnBall(loc, rad, mass, 0.10f);
+            auto& ball = balls[i];
+            ball.Radius = radii[i];
+            ball.Mass = ball.Radius * 10.f;
+            ball.Elasticity = 0.10f;
+            ball.Position = positions[i];
         }
+        SpawnBalls(balls);
     }
 
     const void Application::SpawnBall(glm::vec3 location, const float radius, const float mass, const float elasticity, const std::string& texture) {
-        const auto ballEntity = m_Registry.create();
-        auto& transform = m_Registry.emplace<TransformComponent>(ballEntity);
-        auto& ball = m_Registry.emplace<BallComponent>(ballEntity);
-        auto& time = m_Registry.emplace<TimeComponent>(ballEntity);
-        auto& spline = m_Registry.emplace<BSplineComponent>(ballEntity);
-        std::vector<ColorVertex> tempBuffer(m_MaxBSplineLines);
-        auto& lineMesh = m_Registry.emplace<LineMeshComponent>(ballEntity, tempBuffer);
-        tempBuffer.clear();
-        lineMesh.UpdateBuffer(tempBuffer);
-
+        BallDesc ball;
+        ball.Position = location;
         ball.Radius = radius;
         ball.Mass = mass;
         ball.Elasticity = elasticity;
+        SpawnBalls(std::span<const BallDesc>(&ball, 1), texture);
+    }
+
+    const void Application::SpawnBalls(std::span<const BallDesc> balls, const std::string& texture) {
+        if (balls.empty())
+            return;
+
+        Timer timer;
+
+        std::vector<entt::entity> entities(balls.size());
+        m_Registry.create(entities.begin(), entities.end());
+
+        std::vector<TransformComponent> transforms(balls.size());
+        std::vector<BallComponent> ballComponents(balls.size());
+        for (size_t i = 0; i < balls.size(); i++) {
+            const auto& desc = balls[i];
+
+            auto& transform = transforms[i];
+            transform.Position = desc.Position;
+            transform.Scale = glm::vec3(desc.Radius);
+
+            auto& ball = ballComponents[i];
+            ball.Radius = desc.Radius;
+            ball.Mass = desc.Mass;
+            ball.Elasticity = desc.Elasticity;
+            ball.CollisionSphere.radius = desc.Radius;
+            ball.CollisionSphere.pos = desc.Position;
+        }
+        m_Registry.insert<TransformComponent>(entities.begin(), entities.end(), transforms.begin());
+        m_Registry.insert<BallComponent>(entities.begin(), entities.end(), ballComponents.begin());
+        m_Registry.insert<VelocityComponent>(entities.begin(), entities.end(), VelocityComponent{ glm::vec3(0.f), glm::vec3(0.f) });
+
+        TimeComponent time;
         time.CreationTime = Timer::GetTime();
         time.LastPoint = time.CreationTime;
+        m_Registry.insert<TimeComponent>(entities.begin(), entities.end(), time);
+        m_Registry.insert<BSplineComponent>(entities.begin(), entities.end(), BSplineComponent(m_TrailPool.get()));
+        m_Registry.insert<SimulationLodComponent>(entities.begin(), entities.end());
 
-        auto& velocity = m_Registry.emplace<VelocityComponent>(ballEntity);
-        m_Registry.emplace<MeshComponent>(ballEntity, "Assets/Ball.obj");
-        m_Registry.emplace<TextureComponent>(ballEntity, texture);
+        // Cached mesh and texture, every ball shares the same GPU resources.
+        const MeshComponent mesh("Assets/Ball.obj");
+        const TextureComponent textureComponent(texture);
+        m_Registry.insert<MeshComponent>(entities.begin(), entities.end(), mesh);
+        m_Registry.insert<TextureComponent>(entities.begin(), entities.end(), textureComponent);
 
-        transform.Position = location;
-        transform.Scale = glm::vec3(ball.Radius);
+        m_BallCount += static_cast<int>(balls.size());
 
-        ball.CollisionSphere.radius = ball.Radius;
-        ball.CollisionSphere.pos = transform.Position;
+        m_LastSpawnTime = timer.Delta();
+        m_LastSpawnCount = balls.size();
+    }
 
-        m_BallCount++;
+    void Application::OnBSplineDestroyed(entt::registry& registry, entt::entity entity) {
+        registry.get<BSplineComponent>(entity).clear();
+    }
+
+    void Application::ToggleCollisionEventCounter(bool enable) {
+        for (auto handle : m_EventCounterHandles)
+            m_CollisionEvents.Unsubscribe(handle);
+        m_EventCounterHandles.clear();
+        m_EventCounts.fill(0);
+
+        if (!enable)
+            return;
+
+        for (size_t type = 0; type < m_EventCounts.size(); type++) {
+            auto handle = m_CollisionEvents.Subscribe(static_cast<CollisionEventType>(type),
+                [this, type](std::span<const CollisionEvent> events) {
+                    m_EventCounts[type] += static_cast<uint32_t>(events.size());
+                });
+            m_EventCounterHandles.push_back(handle);
+        }
     }
 
     void Application::DebugDrawPath(std::vector<glm::vec3>& path) {
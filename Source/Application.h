@@ -7,11 +7,26 @@
 #include "Logger.h"
 #include <memory>
 #include <chrono>
+#include <span>
 #include <unordered_map>
 #include "Physics.h"
 #include "LasLoader.h"
+#include "TerrainStreamer.h"
+#include "TerrainLoader.h"
+#include "ContactCache.h"
+#include "CollisionEvents.h"
+#include "TrailPool.h"
+#include "SimulationLod.h"
+#include "Random.h"
 
 namespace FLOOF {
+    struct BallDesc {
+        glm::vec3 Position{ 0.f };
+        float Radius{ 0.5f };
+        float Mass{ 1.f };
+        float Elasticity{ 0.5f };
+    };
+
     class Application {
     public:
         Application();
@@ -28,18 +43,74 @@ namespace FLOOF {
         entt::entity m_CameraEntity;
         entt::entity m_TerrainEntity;
 
-        uint32_t m_MaxBSplineLines = 1000;
+        uint32_t m_BSplineMaxSamplesPerSpan = 16;
+        // Oldest control points are dropped once a trail holds this many, or its vertices no longer fit.
+        uint32_t m_MaxBSplinePoints = 64;
+        uint32_t m_TrailVerticesPerSlot = 192;
+        // Allowed trail deviation from the true curve, in pixels.
+        float m_TrailPixelError = 1.f;
+        float m_FieldOfView = 70.f;
+        std::unique_ptr<TrailPool> m_TrailPool;
+        void OnBSplineDestroyed(entt::registry& registry, entt::entity entity);
 
         // ----------- Terrain -------------------
         void MakeHeightLines();
-        entt::entity m_HeightLinesEntity;
+        entt::entity m_HeightLinesEntity{ entt::null };
+
+        // Bakes the .floofterrain cache and the .flooftiles next to the source when they are missing or stale,
+        // then streams the tiles instead of loading the whole terrain.
+        bool LoadStreamedTerrain(const std::string& path, size_t memoryBudget);
+        // Streams around the camera and the balls, creates meshes for new tiles and retires dropped ones.
+        void UpdateTerrainStreaming();
+        std::unique_ptr<TerrainStreamer> m_TerrainStreamer;
+        std::unordered_map<uint32_t, entt::entity> m_TerrainTileEntities;
+        // Dropped tile meshes and replaced terrain meshes are destroyed once the frames that may still draw them
+        // are done.
+        std::vector<std::pair<entt::entity, uint64_t>> m_RetiredTerrainMeshes;
+        std::vector<glm::vec3> m_StreamingBodies;
+        // Takes the stages m_TerrainLoader has finished. Collision is replaced between frames in one step, a new
+        // mesh goes on its own entity and retires the one it replaces.
+        void UpdateTerrainLoading();
+        std::unique_ptr<TerrainLoader> m_TerrainLoader;
+        entt::entity m_TerrainMeshEntity{ entt::null };
+        uint64_t m_TerrainFrame{ 0 };
+        // Screen space error allowed when picking terrain chunk levels, 0 draws every chunk in full.
+        float m_TerrainPixelError{ 2.f };
+        // World units between terrain samples. Collision can run on a coarser level of the same grid, every
+        // level doubling the cell size.
+        float m_TerrainCellSize{ 1.f };
+        uint32_t m_TerrainPhysicsLevel{ 0 };
+        // Edge of the voxels the drawn point cloud is thinned to, 0 draws every point.
+        float m_PointCloudVoxelSize{ 0.5f };
+        // Points drawn per frame at most, and the screen space spacing at which point cloud nodes stop opening.
+        int m_PointBudget{ 2000000 };
+        float m_PointPixelSpacing{ 2.f };
+        uint64_t m_PointsDrawn{ 0 };
+        uint32_t m_TerrainTrianglesDrawn{ 0 };
 
         // ----------- Physics utils -------------
         const void SpawnBall(glm::vec3 location, const float radius, const float mass, const float elasticity = 0.5f, const std::string& texture = "Assets/LightBlue.png");
+        // Creates all balls in one batch. Mesh and texture are resolved once and trail slots are acquired on first use.
+        const void SpawnBalls(std::span<const BallDesc> balls, const std::string& texture = "Assets/LightBlue.png");
         const void SpawnRain(const int count);
+        uint64_t m_Seed{ Random::s_DefaultSeed };
+        double m_LastSpawnTime{ 0.0 };
+        size_t m_LastSpawnCount{ 0 };
 
         int m_BallCount{ 0 };
 
+        SimulationLod m_SimulationLod;
+
+        ContactCache m_ContactCache;
+        CollisionEventStream m_CollisionEvents;
+        // Physics runs on the main thread, so everything is pushed to the first worker buffer.
+        static constexpr uint32_t s_MainPhysicsWorker = 0;
+
+        // Debug listener counting dispatched events.
+        void ToggleCollisionEventCounter(bool enable);
+        std::vector<CollisionEventStream::ListenerHandle> m_EventCounterHandles;
+        std::array<uint32_t, static_cast<size_t>(CollisionEventType::Count)> m_EventCounts{};
+
         enum DebugLine {
             WorldAxis = 0,
             TerrainTriangle,
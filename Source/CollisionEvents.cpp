@@ -0,0 +1,118 @@
+#include "CollisionEvents.h"
+
+#include <algorithm>
+#include <iterator>
+#include "Floof.h"
+
+namespace FLOOF {
+    CollisionEventStream::CollisionEventStream(uint32_t workerCount) {
+        SetWorkerCount(workerCount);
+    }
+
+    void CollisionEventStream::SetWorkerCount(uint32_t workerCount) {
+        ASSERT(workerCount > 0);
+        m_Buffers.resize(workerCount);
+    }
+
+    CollisionEventStream::ListenerHandle CollisionEventStream::Subscribe(CollisionEventType type, Listener listener) {
+        ListenerHandle handle = m_NextHandle++;
+        auto& listeners = m_Dispatching ? m_AddedListeners : m_Listeners;
+        listeners[static_cast<size_t>(type)].push_back({ handle, std::move(listener) });
+        if (!m_Dispatching)
+            UpdateListeningMask();
+        return handle;
+    }
+
+    void CollisionEventStream::Unsubscribe(ListenerHandle handle) {
+        auto matches = [handle](const ListenerEntry& entry) { return entry.Handle == handle; };
+        for (auto& listeners : m_AddedListeners) {
+            std::erase_if(listeners, matches);
+        }
+        // The vectors are being walked during Dispatch, so only mark the entry there.
+        for (auto& listeners : m_Listeners) {
+            if (!m_Dispatching) {
+                std::erase_if(listeners, matches);
+                continue;
+            }
+            for (auto& entry : listeners) {
+                if (matches(entry))
+                    entry.Removed = true;
+            }
+        }
+        if (!m_Dispatching)
+            UpdateListeningMask();
+    }
+
+    void CollisionEventStream::Dispatch() {
+        if (m_ListeningMask == 0)
+            return;
+
+        m_Dispatching = true;
+        for (size_t type = 0; type < s_TypeCount; type++) {
+            auto& listeners = m_Listeners[type];
+            if (listeners.empty())
+                continue;
+
+            // Avoid the copy when only one worker produced events.
+            std::vector<CollisionEvent>* single = nullptr;
+            uint32_t producers = 0;
+            size_t total = 0;
+            for (auto& buffer : m_Buffers) {
+                auto& events = buffer.Events[type];
+                if (events.empty())
+                    continue;
+                single = &events;
+                producers++;
+                total += events.size();
+            }
+
+            if (producers == 0)
+                continue;
+
+            std::span<const CollisionEvent> batch;
+            if (producers == 1) {
+                batch = *single;
+            } else {
+                m_Batch.clear();
+                m_Batch.reserve(total);
+                for (auto& buffer : m_Buffers) {
+                    auto& events = buffer.Events[type];
+                    m_Batch.insert(m_Batch.end(), events.begin(), events.end());
+                }
+                batch = m_Batch;
+            }
+
+            for (auto& listener : listeners) {
+                if (!listener.Removed)
+                    listener.Callback(batch);
+            }
+
+            for (auto& buffer : m_Buffers) {
+                buffer.Events[type].clear();
+            }
+        }
+        m_Dispatching = false;
+
+        for (size_t type = 0; type < s_TypeCount; type++) {
+            auto& listeners = m_Listeners[type];
+            std::erase_if(listeners, [](const ListenerEntry& entry) { return entry.Removed; });
+            auto& added = m_AddedListeners[type];
+            std::move(added.begin(), added.end(), std::back_inserter(listeners));
+            added.clear();
+        }
+        UpdateListeningMask();
+    }
+
+    void CollisionEventStream::UpdateListeningMask() {
+        m_ListeningMask = 0;
+        for (size_t type = 0; type < s_TypeCount; type++) {
+            if (!m_Listeners[type].empty())
+                m_ListeningMask |= 1u << type;
+            else {
+                // Drop anything still buffered for a type nobody listens to anymore.
+                for (auto& buffer : m_Buffers)
+                    buffer.Events[type].clear();
+            }
+        }
+    }
+}
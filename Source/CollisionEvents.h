@@ -0,0 +1,87 @@
+#pragma once
+
+#include <entt/entt.hpp>
+#include <array>
+#include <functional>
+#include <span>
+#include <vector>
+#include "Math.h"
+
+namespace FLOOF {
+    enum class CollisionEventType : uint8_t {
+        ContactBegin = 0,
+        ContactEnd,
+        TerrainImpact,
+        Count
+    };
+
+    struct CollisionEvent {
+        CollisionEventType Type{ CollisionEventType::ContactBegin };
+        entt::entity A = entt::null;
+        // entt::null for terrain impacts.
+        entt::entity B = entt::null;
+        glm::vec3 Point{ 0.f };
+        glm::vec3 Normal{ 0.f };
+        float Impulse{ 0.f };
+    };
+
+    // Collects collision events from physics workers and hands them to listeners in one batch after the step.
+    // Every worker writes to its own buffer so pushing needs no locking. Events of a type without listeners
+    // are dropped on push.
+    class CollisionEventStream {
+    public:
+        using Listener = std::function<void(std::span<const CollisionEvent> events)>;
+        using ListenerHandle = uint32_t;
+
+        explicit CollisionEventStream(uint32_t workerCount = 1);
+
+        // Must not be called while workers are pushing.
+        void SetWorkerCount(uint32_t workerCount);
+        uint32_t GetWorkerCount() const { return static_cast<uint32_t>(m_Buffers.size()); }
+
+        // Both can be called from a listener. Changes made during Dispatch take effect once it returns, a listener
+        // removed halfway is not called again and one added halfway gets the next dispatch.
+        ListenerHandle Subscribe(CollisionEventType type, Listener listener);
+        void Unsubscribe(ListenerHandle handle);
+
+        bool IsListening(CollisionEventType type) const {
+            return (m_ListeningMask & (1u << static_cast<uint32_t>(type))) != 0;
+        }
+
+        void Push(uint32_t worker, const CollisionEvent& event) {
+            if (!IsListening(event.Type))
+                return;
+            m_Buffers[worker].Events[static_cast<size_t>(event.Type)].push_back(event);
+        }
+
+        // Calls every listener once per type with all events pushed since the last dispatch.
+        void Dispatch();
+
+        // Terrain collisions with a smaller impulse magnitude are not reported as impacts.
+        float MinTerrainImpulse{ 1.f };
+    private:
+        static constexpr size_t s_TypeCount = static_cast<size_t>(CollisionEventType::Count);
+
+        struct alignas(64) WorkerBuffer {
+            std::array<std::vector<CollisionEvent>, s_TypeCount> Events;
+        };
+
+        struct ListenerEntry {
+            ListenerHandle Handle;
+            Listener Callback;
+            // Unsubscribed during Dispatch, erased once it returns.
+            bool Removed{ false };
+        };
+
+        void UpdateListeningMask();
+
+        std::vector<WorkerBuffer> m_Buffers;
+        std::array<std::vector<ListenerEntry>, s_TypeCount> m_Listeners;
+        // Subscribed during Dispatch, added to m_Listeners once it returns.
+        std::array<std::vector<ListenerEntry>, s_TypeCount> m_AddedListeners;
+        bool m_Dispatching{ false };
+        std::vector<CollisionEvent> m_Batch;
+        uint32_t m_ListeningMask{ 0 };
+        ListenerHandle m_NextHandle{ 0 };
+    };
+}
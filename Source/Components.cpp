@@ -1,11 +1,16 @@
 #include "Components.h"
 
 #include <cstring>
+#include <algorithm>
+#include <unordered_map>
 #include "stb_image.h"
 #include "ObjLoader.h"
 #include "LoggerMacros.h"
 #include "Utils.h"
 #include "Physics.h"
+#include "Quantize.h"
+#include "TrailPool.h"
+#include "TerrainStreamer.h"
 
 namespace FLOOF {
     TextureComponent::TextureComponent(const std::string& path) {
@@ -214,6 +219,41 @@ namespace FLOOF {
         }
     }
 
+    TerrainLodComponent::TerrainLodComponent(const TerrainLodMesh& mesh) : Lod{ mesh.Lod } {
+        auto* renderer = VulkanRenderer::Get();
+
+        VertexBuffer = renderer->CreateVertexBuffer(mesh.Vertices);
+        IndexBuffer = renderer->CreateIndexBuffer(mesh.Indices);
+    }
+
+    TerrainLodComponent::~TerrainLodComponent() {
+        auto* renderer = VulkanRenderer::Get();
+        vmaDestroyBuffer(renderer->m_Allocator, IndexBuffer.Buffer, IndexBuffer.Allocation);
+        vmaDestroyBuffer(renderer->m_Allocator, VertexBuffer.Buffer, VertexBuffer.Allocation);
+    }
+
+    uint32_t TerrainLodComponent::Draw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, const glm::mat4& vp, const glm::vec3& eye,
+        float pixelsPerUnit, float maxPixelError) {
+        Lod.Select(eye, pixelsPerUnit, maxPixelError, m_Selection);
+        if (m_Selection.empty())
+            return 0;
+
+        VkDeviceSize offset{ 0 };
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, &VertexBuffer.Buffer, &offset);
+        vkCmdBindIndexBuffer(commandBuffer, IndexBuffer.Buffer, 0, VK_INDEX_TYPE_UINT32);
+        const auto& levels = Lod.GetLevels();
+        const auto& chunks = Lod.GetChunks();
+        MeshPushConstants constants;
+        constants.InvModelMat = glm::mat4(1.f);
+        for (const auto& selected : m_Selection) {
+            const auto& level = levels[selected.Level];
+            constants.MVP = vp * chunks[selected.Chunk].Box.GetMatrix();
+            vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(MeshPushConstants), &constants);
+            vkCmdDrawIndexed(commandBuffer, level.IndexCount, 1, level.FirstIndex, chunks[selected.Chunk].VertexOffset, 0);
+        }
+        return Lod.GetTriangleCount(m_Selection);
+    }
+
     LineMeshComponent::LineMeshComponent(const std::vector<ColorVertex>& vertexData) {
         auto renderer = VulkanRenderer::Get();
 
@@ -303,43 +343,42 @@ namespace FLOOF {
 
     }
 
-    TerrainComponent::TerrainComponent(std::vector<std::vector<std::pair<Triangle, Triangle>>>& rectangles) {
-        Rectangles = rectangles;
-
-        Height = rectangles.size();
-        if (rectangles.empty())
-            Width = 0;
-        else
-            Width = rectangles[0].size();
+    TerrainComponent::TerrainComponent(HeightGrid&& grid) : Grid{ std::move(grid) } {
+        Width = Grid.IsEmpty() ? 0 : static_cast<int>((Grid.Width - 1) * Grid.CellSize);
+        Height = Grid.IsEmpty() ? 0 : static_cast<int>((Grid.Height - 1) * Grid.CellSize);
+    }
 
-        for (auto& rectVec : Rectangles) {
-            for (auto& rect : rectVec) {
-                Triangles.push_back(rect.first);
-                Triangles.push_back(rect.second);
-            }
-        }
+    TerrainComponent::TerrainComponent(TerrainStreamer* streamer) : Streamer{ streamer } {
+        const auto& tiles = streamer->GetTileSet();
+        Height = static_cast<int>((tiles.GetHeight() - 1) * tiles.GetCellSize());
+        Width = static_cast<int>((tiles.GetWidth() - 1) * tiles.GetCellSize());
+        MinY = -tiles.GetBounds().Max.y;
     }
 
     void TerrainComponent::PrintTriangleData() {
         uint32_t triangleId = 0;
-        for (auto& triangle : Triangles) {
+        Grid.ForEachTriangle([&](const Triangle& triangle) {
             std::cout << "Triangle: " << triangleId++ << std::endl;
             std::cout << "A: " << triangle.A << std::endl;
             std::cout << "B: " << triangle.B << std::endl;
             std::cout << "C: " << triangle.C << std::endl;
             std::cout << "Normal: " << triangle.N << std::endl;
-        }
+        });
     }
 
-    std::vector<Triangle*> TerrainComponent::GetOverlappingTriangles(CollisionShape* shape) {
-        std::vector<Triangle*> overlapping;
+    std::vector<Triangle> TerrainComponent::GetOverlappingTriangles(CollisionShape* shape) {
+        if (Streamer)
+            return Streamer->GetOverlappingTriangles(shape);
+
+        std::vector<Triangle> overlapping;
 
-        int xPos = shape->pos.x;
-        int zPos = shape->pos.z;
+        // In squares, not world units.
+        int xPos = shape->pos.x / Grid.CellSize;
+        int zPos = shape->pos.z / Grid.CellSize;
 
         int extent = 1;
         if (shape->shape == CollisionShape::Shape::Sphere)
-            extent += (int)reinterpret_cast<Sphere*>(shape)->radius;
+            extent += (int)(reinterpret_cast<Sphere*>(shape)->radius / Grid.CellSize);
 
         int xMin = xPos - extent;
         int xMax = xPos + extent;
@@ -347,16 +386,7 @@ namespace FLOOF {
         int zMin = zPos - extent;
         int zMax = zPos + extent;
 
-        for (int z = zMin; z <= zMax; z++) {
-            for (int x = xMin; x <= xMax; x++) {
-                if (x < 0.f || x >(Width - 1)
-                    || z < 0.f || z >(Height - 1)) {
-                    continue;
-                }
-                overlapping.push_back(&Rectangles[z][x].first);
-                overlapping.push_back(&Rectangles[z][x].second);
-            }
-        }
+        Grid.GetSquares(xMin, zMin, xMax, zMax, overlapping);
 
         return overlapping;
     }
@@ -382,52 +412,232 @@ namespace FLOOF {
         vkCmdDraw(commandBuffer, VertexCount, 1, 0, 0);
     }
 
-    BSplineComponent::BSplineComponent(const std::vector<glm::vec3>& controllPoints) {
-        Update(controllPoints);
+    PointCloudLodComponent::PointCloudLodComponent(PointOctree&& octree) : Octree{ std::move(octree) } {
+        m_Buffers.resize(Octree.GetNodes().size());
+        m_LastDrawn.resize(Octree.GetNodes().size(), 0);
     }
 
-    void BSplineComponent::Update(const std::vector<glm::vec3>& controllPoints) {
-        ASSERT(controllPoints.size() >= D + 1);
-        ControllPoints = controllPoints;
+    PointCloudLodComponent::~PointCloudLodComponent() {
+        auto* renderer = VulkanRenderer::Get();
+        for (uint32_t node : m_Resident)
+            renderer->DestroyVulkanBuffer(&m_Buffers[node]);
+        for (auto& [buffer, frame] : m_Retired)
+            renderer->DestroyVulkanBuffer(&buffer);
+    }
 
-        KnotPoints.resize(ControllPoints.size() + D + 1);
+    uint64_t PointCloudLodComponent::Draw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, const glm::mat4& vp, Frustum& frustum,
+        const glm::vec3& eye, float pixelsPerUnit, float maxPixelSpacing, uint64_t pointBudget) {
+        auto* renderer = VulkanRenderer::Get();
+        m_Frame++;
+        std::erase_if(m_Retired, [&](std::pair<VulkanBuffer, uint64_t>& retired) {
+            if (retired.second > m_Frame)
+                return false;
+            renderer->DestroyVulkanBuffer(&retired.first);
+            return true;
+        });
+
+        Octree.Select(frustum, eye, pixelsPerUnit, maxPixelSpacing, pointBudget, m_Selection);
+        const auto& nodes = Octree.GetNodes();
+        uint32_t uploads{ 0 };
+        uint64_t drawn{ 0 };
+        ColorPushConstants constants;
+        for (uint32_t index : m_Selection) {
+            auto& buffer = m_Buffers[index];
+            // Points are quantized to the node's cube.
+            const auto& node = nodes[index];
+            const Quantize::Box box(node.Min, node.Min + glm::vec3(node.Size));
+            if (buffer.Buffer == VK_NULL_HANDLE) {
+                if (uploads == MaxUploadsPerFrame)
+                    continue;
+                const auto vertices = Quantize::Encode(Octree.GetPoints(node), box);
+                buffer = renderer->QueueVertexBuffer(std::span<const QuantizedColorVertex>(vertices));
+                m_Resident.push_back(index);
+                m_ResidentBytes += node.PointCount * sizeof(QuantizedColorVertex);
+                uploads++;
+            }
+            m_LastDrawn[index] = m_Frame;
+
+            constants.MVP = vp * box.GetMatrix();
+            vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ColorPushConstants), &constants);
+            VkDeviceSize offset{ 0 };
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, &buffer.Buffer, &offset);
+            vkCmdDraw(commandBuffer, node.PointCount, 1, 0, 0);
+            drawn += node.PointCount;
+        }
 
-        int tValue = 0;
-        for (uint32_t i = 0; i < (D + 1); i++) {
-            KnotPoints[i] = tValue;
+        // Least recently drawn first, never a node drawn this frame.
+        if (m_ResidentBytes > MemoryBudget) {
+            std::sort(m_Resident.begin(), m_Resident.end(), [this](uint32_t a, uint32_t b) { return m_LastDrawn[a] < m_LastDrawn[b]; });
+            size_t dropped{ 0 };
+            while (dropped < m_Resident.size() && m_ResidentBytes > MemoryBudget && m_LastDrawn[m_Resident[dropped]] != m_Frame)
+                Retire(m_Resident[dropped++]);
+            m_Resident.erase(m_Resident.begin(), m_Resident.begin() + dropped);
         }
+        return drawn;
+    }
+
+    void PointCloudLodComponent::Retire(uint32_t node) {
+        m_ResidentBytes -= Octree.GetNodes()[node].PointCount * sizeof(QuantizedColorVertex);
+        m_Retired.emplace_back(m_Buffers[node], m_Frame + VulkanRenderer::Get()->GetFramesInFlight());
+        m_Buffers[node] = {};
+    }
 
-        tValue++;
+    BSplineComponent::BSplineComponent(TrailPool* pool) : Pool{ pool }, Slot{ TrailPool::InvalidSlot } {
+    }
 
-        for (uint32_t i = (D + 1); i < (KnotPoints.size() - (D + 1)); i++) {
-            KnotPoints[i] = tValue++;
+    void BSplineComponent::Update(const std::vector<glm::vec3>& controllPoints) {
+        ASSERT(controllPoints.size() >= D + 1);
+        ASSERT(Pool);
+        Pool->Release(Slot);
+        Slot = Pool->Acquire();
+
+        for (auto& point : controllPoints)
+            Pool->PushControlPoint(Slot, point);
+
+        m_TessellatedSpans = 0;
+        m_WindowSize = 0;
+        TMax = static_cast<float>(size() - D);
+    }
+
+    void BSplineComponent::AddControllPoint(const glm::vec3& point, float tolerance) {
+        ASSERT(size() >= D + 1);
+        const uint32_t n = size();
+        const uint32_t spans = n - D;
+
+        // Online Douglas-Peucker with an opening window. The last point slides to the new one while the
+        // segment from the point before it still covers every point it has replaced.
+        if (tolerance > 0.f && n > D + 1 && m_WindowSize < s_SimplifyWindow) {
+            const glm::vec3 anchor = ControllPoint(n - 2);
+            const glm::vec3 last = ControllPoint(n - 1);
+            bool fits = Math::DistanceToSegment(last, anchor, point) <= tolerance;
+            for (uint32_t i = 0; fits && i < m_WindowSize; i++)
+                fits = Math::DistanceToSegment(m_Window[i], anchor, point) <= tolerance;
+
+            if (fits) {
+                m_Window[m_WindowSize++] = last;
+                Pool->SetControlPoint(Slot, n - 1, point);
+                // Only the last span uses the moved point.
+                m_TessellatedSpans = std::min(m_TessellatedSpans, spans - 1);
+                return;
+            }
+        }
+        m_WindowSize = 0;
+
+        // The last D - 1 spans touch the clamped end knots and change shape once the curve grows past them.
+        m_TessellatedSpans = std::min(m_TessellatedSpans, spans - std::min<uint32_t>(spans, D - 1));
+
+        // A full ring drops the oldest point, and the oldest span goes with it. The new first span keeps
+        // the vertices it was tessellated with instead of being re-clamped.
+        const uint32_t oldestSpanVertices = Pool->SpanVertexCount(Slot, 0);
+        if (Pool->PushControlPoint(Slot, point) && oldestSpanVertices > 0) {
+            Pool->PopVertices(Slot, oldestSpanVertices);
+            if (m_TessellatedSpans > 0)
+                m_TessellatedSpans--;
         }
+        TMax = static_cast<float>(size() - D);
+    }
+
+    void BSplineComponent::Tessellate(uint32_t maxSamplesPerSpan, float errorPerDistance, const glm::vec3& eye, const glm::vec3& color) {
+        ASSERT(maxSamplesPerSpan > 0 && maxSamplesPerSpan < Pool->GetVerticesPerSlot());
+        if (size() < D + 1)
+            return;
+
+        if (m_TessellatedSpans == size() - D && Pool->GetVertexCount(Slot) > 0)
+            return;
 
-        for (uint32_t i = (KnotPoints.size() - (D + 1)); i < KnotPoints.size(); i++) {
-            KnotPoints[i] = tValue;
+        // Drop the end point and the vertices of every span that is evaluated again.
+        uint32_t stale = 0;
+        for (uint32_t span = m_TessellatedSpans; span < size() - D; span++) {
+            uint32_t count = Pool->SpanVertexCount(Slot, span);
+            if (count == 0)
+                break;
+            stale += count;
+        }
+        const uint32_t vertexCount = Pool->GetVertexCount(Slot);
+        const uint32_t endPoint = vertexCount > 0 ? 1 : 0;
+        Pool->TruncateVertices(Slot, vertexCount - std::min(vertexCount, stale + endPoint));
+
+        thread_local std::vector<glm::vec3> points;
+        points.resize(maxSamplesPerSpan);
+
+        ColorVertex vertex;
+        vertex.Color = color;
+        while (m_TessellatedSpans < size() - D) {
+            const uint32_t samples = SampleCount(m_TessellatedSpans, maxSamplesPerSpan, errorPerDistance, eye);
+            EvaluateSpan(m_TessellatedSpans, samples, points.data());
+
+            // Leave room for the end point.
+            while (Pool->GetVertexCount(Slot) + samples + 1 > Pool->GetVerticesPerSlot() && m_TessellatedSpans > 0)
+                DropOldestSpan();
+
+            for (uint32_t i = 0; i < samples; i++) {
+                vertex.Pos = points[i];
+                Pool->PushVertex(Slot, vertex);
+            }
+            Pool->SpanVertexCount(Slot, m_TessellatedSpans) = samples;
+            m_TessellatedSpans++;
         }
 
-        TMax = static_cast<float>(tValue);
+        vertex.Pos = EvaluateBSpline(TMax);
+        Pool->PushVertex(Slot, vertex);
     }
 
-    void BSplineComponent::AddControllPoint(const glm::vec3& point) {
-        ASSERT(ControllPoints.size() >= D + 1);
-        ControllPoints.push_back(point);
-        KnotPoints.push_back(KnotPoints[KnotPoints.size() - 1]);
+    uint32_t BSplineComponent::SampleCount(uint32_t span, uint32_t maxSamples, float errorPerDistance, const glm::vec3& eye) {
+        const int my = static_cast<int>(span) + D;
 
-        for (uint32_t i = (KnotPoints.size() - (D + 1)); i < KnotPoints.size(); i++) {
-            KnotPoints[i]++;
-        }
+        glm::vec3 p[D + 1];
+        for (int j = 0; j <= D; j++)
+            p[j] = ControllPoint(my - D + j);
+
+        // |C''| over the span is bounded by the largest second difference of its control points. The
+        // D(D - 1) factor makes the bound hold for the clamped end spans as well.
+        float secondDifference = 0.f;
+        for (int j = 0; j + 2 <= D; j++)
+            secondDifference = std::max(secondDifference, glm::length(p[j] - 2.f * p[j + 1] + p[j + 2]));
+        const float curvature = static_cast<float>(D * (D - 1)) * secondDifference;
+
+        // A chord over a parameter step h stays within curvature * h^2 / 8 of the curve.
+        const float tolerance = std::max(errorPerDistance * glm::distance(eye, p[D / 2]), 0.00001f);
+        const float samples = std::ceil(std::sqrt(curvature / (8.f * tolerance)));
+        return std::clamp(static_cast<uint32_t>(std::min(samples, static_cast<float>(maxSamples))), 1u, maxSamples);
+    }
+
+    void BSplineComponent::DropOldestSpan() {
+        ASSERT(m_TessellatedSpans > 0 && size() > D + 1);
+        Pool->PopVertices(Slot, Pool->SpanVertexCount(Slot, 0));
+        Pool->PopControlPoint(Slot);
+        m_TessellatedSpans--;
+        TMax = static_cast<float>(size() - D);
+    }
 
-        TMax = KnotPoints[KnotPoints.size() - 1];
+    void BSplineComponent::clear() {
+        if (Pool)
+            Pool->Release(Slot);
+        Slot = TrailPool::InvalidSlot;
+        m_TessellatedSpans = 0;
+        m_WindowSize = 0;
+        TMin = 0.f;
+        TMax = 0.f;
+    }
+
+    unsigned long BSplineComponent::size() {
+        if (Slot == TrailPool::InvalidSlot)
+            return 0;
+        return Pool->GetControlPointCount(Slot);
+    }
+
+    int BSplineComponent::Knot(int i) {
+        return std::clamp(i - D, 0, static_cast<int>(size()) - D);
+    }
+
+    glm::vec3 BSplineComponent::ControllPoint(int i) {
+        return Pool->GetControlPoint(Slot, static_cast<uint32_t>(i));
     }
 
     int BSplineComponent::FindKnotInterval(float t) {
-        int my = ControllPoints.size() - 1;
-        while (t < KnotPoints[my] && my > D) {
-            my--;
-        }
-        return my;
+        // Interior knots are consecutive integers, so the interval follows directly from t.
+        int my = static_cast<int>(std::floor(t)) + D;
+        return std::clamp(my, D, static_cast<int>(size()) - 1);
     }
 
     glm::vec3 BSplineComponent::EvaluateBSpline(float t) {
@@ -436,26 +646,74 @@ namespace FLOOF {
         glm::vec3 a[D + 1];
 
         for (int i = 0; i <= D; i++) {
-            a[D - i] = ControllPoints[my - i];
+            a[D - i] = ControllPoint(my - i);
         }
 
         for (int k = D; k > 0; k--) {
             int j = my - k;
             for (int i = 0; i < k; i++) {
                 j++;
-                float w = (t - KnotPoints[j]) / (KnotPoints[j + k] - KnotPoints[j]);
+                float w = (t - Knot(j)) / (Knot(j + k) - Knot(j));
                 a[i] = a[i] * (1.f - w) + a[i + 1] * w;
             }
         }
         return a[0];
     }
 
-    BSplineComponent::BSplineComponent() {
+    void BSplineComponent::EvaluateSpan(uint32_t span, uint32_t samples, glm::vec3* out) {
+        const int my = static_cast<int>(span) + D;
+        const float step = 1.f / static_cast<float>(samples);
 
+        // Spans near either end use clamped knots and go through de Boor.
+        if (my < 2 * D - 1 || my > static_cast<int>(size()) - D) {
+            for (uint32_t i = 0; i < samples; i++)
+                out[i] = EvaluateBSpline(static_cast<float>(span) + i * step);
+            return;
+        }
+
+        glm::vec3 p[D + 1];
+        for (int j = 0; j <= D; j++)
+            p[j] = ControllPoint(my - D + j);
+
+        const auto& basis = UniformBasis(samples);
+        for (uint32_t i = 0; i < samples; i++) {
+            glm::vec3 point(0.f);
+            for (int j = 0; j <= D; j++)
+                point += basis[i][j] * p[j];
+            out[i] = point;
+        }
+    }
+
+    const std::vector<std::array<float, BSplineComponent::D + 1>>& BSplineComponent::UniformBasis(uint32_t samples) {
+        thread_local std::unordered_map<uint32_t, std::vector<std::array<float, D + 1>>> cache;
+        auto [it, inserted] = cache.try_emplace(samples);
+        auto& basis = it->second;
+        if (!inserted)
+            return basis;
+
+        // de Boor on unit control values with knots i - D, evaluated in interval my = D.
+        basis.resize(samples);
+        for (uint32_t sample = 0; sample < samples; sample++) {
+            const float t = static_cast<float>(sample) / static_cast<float>(samples);
+            for (int basisIndex = 0; basisIndex <= D; basisIndex++) {
+                float a[D + 1]{};
+                a[basisIndex] = 1.f;
+                for (int k = D; k > 0; k--) {
+                    int j = D - k;
+                    for (int i = 0; i < k; i++) {
+                        j++;
+                        float w = (t - (j - D)) / static_cast<float>(k);
+                        a[i] = a[i] * (1.f - w) + a[i + 1] * w;
+                    }
+                }
+                basis[sample][basisIndex] = a[0];
+            }
+        }
+        return basis;
     }
 
     bool BSplineComponent::Isvalid() {
 
-        return ControllPoints.size() > (D + 1);
+        return size() > (D + 1);
     }
 }
\ No newline at end of file
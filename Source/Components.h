@@ -3,8 +3,12 @@
 
 #include "VulkanRenderer.h"
 #include "Floof.h"
+#include "HeightGrid.h"
 #include "Physics.h"
+#include "PointOctree.h"
+#include "TerrainLod.h"
 #include <chrono>
+#include <array>
 
 namespace FLOOF {
     struct TransformComponent {
@@ -59,6 +63,28 @@ namespace FLOOF {
         inline static std::unordered_map<std::string, MeshData> s_MeshDataCache;
     };
 
+    // Geomipmapped terrain, a level is picked for every chunk each time it is drawn.
+    struct TerrainLodComponent {
+        // Owns its buffers, so it is never copied or moved, not even over another one when an entity is destroyed.
+        inline static constexpr bool in_place_delete = true;
+
+        TerrainLodComponent(const TerrainLodMesh& mesh);
+        ~TerrainLodComponent();
+
+        TerrainLodComponent(const TerrainLodComponent&) = delete;
+        TerrainLodComponent& operator = (const TerrainLodComponent&) = delete;
+
+        // Returns the number of triangles drawn. Pushes the MeshPushConstants of every chunk, vp times its box.
+        uint32_t Draw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, const glm::mat4& vp, const glm::vec3& eye,
+            float pixelsPerUnit, float maxPixelError);
+
+        TerrainLod Lod;
+        VulkanBuffer VertexBuffer{};
+        VulkanBuffer IndexBuffer{};
+    private:
+        std::vector<TerrainLod::Selection> m_Selection;
+    };
+
     struct LineMeshComponent {
         LineMeshComponent(const std::vector<ColorVertex>& vertexData);
         ~LineMeshComponent();
@@ -81,6 +107,43 @@ namespace FLOOF {
         uint32_t VertexCount{};
     };
 
+    // Point cloud drawn through a PointOctree. A node's vertex buffer is quantized to the node's cube and uploaded
+    // the first time the node is selected, at most MaxUploadsPerFrame per frame, and the least recently drawn
+    // buffers are dropped once they take more than MemoryBudget. Selected nodes that are not uploaded yet are
+    // skipped, their parents are drawn. Uploads go out with the frame through VulkanRenderer::QueueVertexBuffer,
+    // nothing waits for the queue.
+    struct PointCloudLodComponent {
+        // Owns its buffers like TerrainLodComponent.
+        inline static constexpr bool in_place_delete = true;
+
+        PointCloudLodComponent(PointOctree&& octree);
+        ~PointCloudLodComponent();
+
+        PointCloudLodComponent(const PointCloudLodComponent&) = delete;
+        PointCloudLodComponent& operator = (const PointCloudLodComponent&) = delete;
+
+        // Returns the number of points drawn. Pushes the ColorPushConstants of every node, vp times its box.
+        uint64_t Draw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, const glm::mat4& vp, Frustum& frustum,
+            const glm::vec3& eye, float pixelsPerUnit, float maxPixelSpacing, uint64_t pointBudget);
+        size_t GetResidentBytes() const { return m_ResidentBytes; }
+        uint32_t GetResidentNodes() const { return static_cast<uint32_t>(m_Resident.size()); }
+
+        PointOctree Octree;
+        size_t MemoryBudget{ size_t{ 256 } << 20 };
+        uint32_t MaxUploadsPerFrame{ 8 };
+    private:
+        // Buffers of dropped nodes wait here until the frames that may still draw them are done.
+        void Retire(uint32_t node);
+
+        std::vector<VulkanBuffer> m_Buffers;
+        std::vector<uint64_t> m_LastDrawn;
+        std::vector<uint32_t> m_Resident;
+        std::vector<std::pair<VulkanBuffer, uint64_t>> m_Retired;
+        std::vector<uint32_t> m_Selection;
+        size_t m_ResidentBytes{ 0 };
+        uint64_t m_Frame{ 0 };
+    };
+
     struct TextureComponent {
         TextureComponent(const std::string& path);
         ~TextureComponent();
@@ -117,17 +180,28 @@ namespace FLOOF {
         float Aspect = 16.f / 9.f;
     };
 
+    class TerrainStreamer;
+
     struct TerrainComponent {
-        TerrainComponent(std::vector<std::vector<std::pair<Triangle, Triangle>>>& vertexData);
+        TerrainComponent(HeightGrid&& grid);
+        // Streamed terrain. Grid stays empty, collision goes through the resident tiles.
+        TerrainComponent(TerrainStreamer* streamer);
         void PrintTriangleData();
-        std::vector<Triangle*> GetOverlappingTriangles(CollisionShape* shape);
-        std::vector<std::vector<std::pair<Triangle, Triangle>>> Rectangles;
-        std::vector<Triangle> Triangles;
+        // Triangles of the squares under the shape, built from the grid on every call.
+        std::vector<Triangle> GetOverlappingTriangles(CollisionShape* shape);
+        HeightGrid Grid;
+        TerrainStreamer* Streamer{ nullptr };
+        // World extent along x and z.
         int Width;
         int Height;
         float MinY;
     };
 
+    // Mesh of one streamed terrain tile.
+    struct TerrainTileComponent {
+        uint32_t Tile;
+    };
+
     struct BallComponent {
         Sphere CollisionSphere;
         float Radius; // TODO dobbel lagring av radius !! fix??
@@ -141,25 +215,56 @@ namespace FLOOF {
 
     };
 
+    class TrailPool;
+
+    // Control points live in a TrailPool slot. Knots are clamped uniform, so they are computed instead of stored.
     class BSplineComponent {
     public:
-        BSplineComponent(const std::vector<glm::vec3>& controllPoints);
-        BSplineComponent();
+        BSplineComponent(TrailPool* pool = nullptr);
         void Update(const std::vector<glm::vec3>& controllPoints);
-        void AddControllPoint(const glm::vec3& point);
+        // With a tolerance the last point is moved to the new one instead, as long as every point it has
+        // stood in for stays within tolerance of the new segment.
+        void AddControllPoint(const glm::vec3& point, float tolerance = 0.f);
         glm::vec3 EvaluateBSpline(float t);
+        // Evaluates samples evenly spaced points of span [span, span + 1), excluding the end point.
+        void EvaluateSpan(uint32_t span, uint32_t samples, glm::vec3* out);
+        // Writes the spans changed since the last call to the slot's vertex ring. Every span gets just
+        // enough samples to stay within errorPerDistance * (distance to eye) of the curve. Oldest spans
+        // are dropped when the slot runs out of vertices.
+        void Tessellate(uint32_t maxSamplesPerSpan, float errorPerDistance, const glm::vec3& eye, const glm::vec3& color);
         float TMin = 0.f;
         float TMax = 0.f;
         inline static constexpr int D = 2;
-        bool empty() { return ControllPoints.empty(); }
-        void clear() { ControllPoints.clear(); KnotPoints.clear(); TMin = 0.f; TMax = 0.f; }
-        unsigned long size() { return ControllPoints.size(); }
+        bool empty() { return size() == 0; }
+        void clear();
+        unsigned long size();
         bool Isvalid();
 
+        TrailPool* Pool{ nullptr };
+        uint32_t Slot;
     private:
-        std::vector<int> KnotPoints;
-        std::vector<glm::vec3> ControllPoints;
+        int Knot(int i);
+        glm::vec3 ControllPoint(int i);
         int FindKnotInterval(float t);
+        // Basis weights of a span with uniform knots, one row per sample.
+        static const std::vector<std::array<float, D + 1>>& UniformBasis(uint32_t samples);
+        uint32_t SampleCount(uint32_t span, uint32_t maxSamples, float errorPerDistance, const glm::vec3& eye);
+        void DropOldestSpan();
+
+        // Spans at the front of the curve whose vertices are still valid.
+        uint32_t m_TessellatedSpans{ 0 };
+
+        // Points merged into the last control point since it was appended.
+        inline static constexpr uint32_t s_SimplifyWindow = 8;
+        std::array<glm::vec3, s_SimplifyWindow> m_Window;
+        uint32_t m_WindowSize{ 0 };
+    };
+
+    // Simulation LOD state, see SimulationLod.
+    struct SimulationLodComponent {
+        // Time that passed since the ball was last simulated.
+        float AccumulatedTime{ 0.f };
+        uint8_t Tier{ 0 };
     };
 
     struct DebugComponent {};
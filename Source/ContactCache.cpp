@@ -0,0 +1,76 @@
+#include "ContactCache.h"
+#include "Octree.h"
+
+namespace FLOOF {
+    void ContactCache::BeginFrame() {
+        m_Frame++;
+        m_Stats = Stats{};
+    }
+
+    ContactPoint& ContactCache::Touch(CollisionObject* a, CollisionObject* b, uint32_t worker) {
+        ASSERT(a->Entity < b->Entity);
+
+        auto [it, inserted] = m_Contacts.try_emplace(MakeKey(a->Entity, b->Entity));
+        auto& contact = it->second;
+        // Already touched this frame, through another leaf both balls share.
+        if (!inserted && contact.LastFrame == m_Frame)
+            return contact;
+        m_Stats.Pairs++;
+
+        glm::vec3 relativePosition = b->Transform.Position - a->Transform.Position;
+
+        if (!inserted && contact.LastFrame == m_Frame - 1 && contact.State != ContactState::End) {
+            contact.State = ContactState::Persist;
+            m_Stats.Persisted++;
+
+            glm::vec3 moved = relativePosition - contact.RelativePosition;
+            if (glm::dot(moved, moved) <= ReuseTolerance * ReuseTolerance) {
+                contact.LastFrame = m_Frame;
+                m_Stats.Reused++;
+                return contact;
+            }
+        } else {
+            contact = ContactPoint{};
+            contact.A = a->Entity;
+            contact.B = b->Entity;
+            contact.State = ContactState::Begin;
+            m_Stats.Began++;
+        }
+
+        contact.Normal = Physics::GetContactNormal(a->Transform.Position, b->Transform.Position, worker);
+        contact.Depth = (a->Ball.Radius + b->Ball.Radius) - glm::length(relativePosition);
+        contact.RelativePosition = relativePosition;
+        contact.LastFrame = m_Frame;
+
+        return contact;
+    }
+
+    void ContactCache::EndFrame() {
+        for (auto it = m_Contacts.begin(); it != m_Contacts.end();) {
+            auto& contact = it->second;
+            if (contact.LastFrame == m_Frame) {
+                ++it;
+                continue;
+            }
+
+            if (contact.State == ContactState::End) {
+                it = m_Contacts.erase(it);
+                continue;
+            }
+
+            contact.State = ContactState::End;
+            contact.AccumulatedImpulse = 0.f;
+            m_Stats.Ended++;
+            ++it;
+        }
+    }
+
+    void ContactCache::Clear() {
+        m_Contacts.clear();
+        m_Stats = Stats{};
+    }
+
+    uint64_t ContactCache::MakeKey(entt::entity a, entt::entity b) {
+        return (static_cast<uint64_t>(entt::to_integral(a)) << 32) | static_cast<uint64_t>(entt::to_integral(b));
+    }
+}
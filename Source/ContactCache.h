@@ -0,0 +1,73 @@
+#pragma once
+
+#include <entt/entt.hpp>
+#include <unordered_map>
+#include "Math.h"
+
+namespace FLOOF {
+    struct CollisionObject;
+
+    enum class ContactState : uint8_t {
+        Begin = 0,
+        Persist,
+        End
+    };
+
+    // Ball-ball contact kept alive between frames. Normal points from A to B.
+    struct ContactPoint {
+        entt::entity A = entt::null;
+        entt::entity B = entt::null;
+        glm::vec3 Normal{ 0.f };
+        float Depth{ 0.f };
+        float AccumulatedImpulse{ 0.f };
+        // B - A at the time Normal and Depth were computed.
+        glm::vec3 RelativePosition{ 0.f };
+        ContactState State{ ContactState::Begin };
+        uint64_t LastFrame{ 0 };
+    };
+
+    class ContactCache {
+    public:
+        struct Stats {
+            uint32_t Pairs{ 0 };
+            uint32_t Began{ 0 };
+            uint32_t Persisted{ 0 };
+            uint32_t Ended{ 0 };
+            uint32_t Reused{ 0 };
+
+            // Fraction of this frame's pairs that were already in the cache.
+            float HitRate() const { return Pairs == 0 ? 0.f : static_cast<float>(Persisted) / static_cast<float>(Pairs); }
+        };
+
+        void BeginFrame();
+        // Finds or creates the contact for the pair and refreshes normal/depth if the pair moved.
+        // a must have the lower entity id. Touching a pair again in the same frame returns its contact unchanged.
+        // worker picks the random stream used for the normal of coincident balls.
+        ContactPoint& Touch(CollisionObject* a, CollisionObject* b, uint32_t worker);
+        // Contacts not touched this frame are marked End. Contacts that ended last frame are dropped.
+        void EndFrame();
+        void Clear();
+
+        template<typename Func>
+        void ForEach(ContactState state, Func func) const {
+            for (auto& [key, contact] : m_Contacts) {
+                if (contact.State == state)
+                    func(contact);
+            }
+        }
+
+        const Stats& GetStats() const { return m_Stats; }
+        size_t Size() const { return m_Contacts.size(); }
+
+        bool WarmStarting = true;
+        float WarmStartFactor = 0.8f;
+        // Max movement of B relative to A before normal and depth are recomputed.
+        float ReuseTolerance = 0.0001f;
+    private:
+        static uint64_t MakeKey(entt::entity a, entt::entity b);
+
+        std::unordered_map<uint64_t, ContactPoint> m_Contacts;
+        uint64_t m_Frame{ 0 };
+        Stats m_Stats{};
+    };
+}
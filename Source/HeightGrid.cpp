@@ -0,0 +1,300 @@
+#include "HeightGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include "Parallel.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FLOOF_HEIGHTGRID_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace FLOOF {
+    namespace {
+        constexpr size_t s_MinRowsPerWorker = 64;
+
+        // The six triangle normals around a sample summed up and divided by the cell size, then normalized. up is
+        // six times the cell size. The SSE2 path below does the same operations in the same order, so both give
+        // the same bits.
+        glm::vec3 SmoothNormal(const float* prev, const float* row, const float* next, size_t x, float up) {
+            const float nx = 2.f * (row[x - 1] - row[x + 1]) + (next[x] - next[x + 1]) + (prev[x - 1] - prev[x]);
+            const float nz = (row[x + 1] - row[x - 1]) + (prev[x - 1] - next[x + 1]) + 2.f * (prev[x] - next[x]);
+            const float scale = 1.f / std::sqrt(nx * nx + up * up + nz * nz);
+            return glm::vec3(nx * scale, up * scale, nz * scale);
+        }
+
+        // SmoothNormal of the samples from begin to end of a row that is not on the border, out holds sample begin.
+        void SmoothNormals(const float* prev, const float* row, const float* next, size_t begin, size_t end, float up, glm::vec3* out) {
+            size_t x = begin;
+#ifdef FLOOF_HEIGHTGRID_SSE2
+            const __m128 two = _mm_set1_ps(2.f);
+            const __m128 one = _mm_set1_ps(1.f);
+            const __m128 ny = _mm_set1_ps(up);
+            const __m128 nyy = _mm_mul_ps(ny, ny);
+            alignas(16) float normal[3][4];
+            for (; x + 4 <= end; x += 4) {
+                const __m128 rowLeft = _mm_loadu_ps(row + x - 1);
+                const __m128 rowRight = _mm_loadu_ps(row + x + 1);
+                const __m128 prevLeft = _mm_loadu_ps(prev + x - 1);
+                const __m128 prevMiddle = _mm_loadu_ps(prev + x);
+                const __m128 nextMiddle = _mm_loadu_ps(next + x);
+                const __m128 nextRight = _mm_loadu_ps(next + x + 1);
+                const __m128 nx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(two, _mm_sub_ps(rowLeft, rowRight)), _mm_sub_ps(nextMiddle, nextRight)),
+                    _mm_sub_ps(prevLeft, prevMiddle));
+                const __m128 nz = _mm_add_ps(_mm_add_ps(_mm_sub_ps(rowRight, rowLeft), _mm_sub_ps(prevLeft, nextRight)),
+                    _mm_mul_ps(two, _mm_sub_ps(prevMiddle, nextMiddle)));
+                const __m128 scale = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), nyy), _mm_mul_ps(nz, nz))));
+                _mm_store_ps(normal[0], _mm_mul_ps(nx, scale));
+                _mm_store_ps(normal[1], _mm_mul_ps(ny, scale));
+                _mm_store_ps(normal[2], _mm_mul_ps(nz, scale));
+                for (size_t i = 0; i < 4; i++)
+                    out[x - begin + i] = glm::vec3(normal[0][i], normal[1][i], normal[2][i]);
+            }
+#endif
+            for (; x < end; x++)
+                out[x - begin] = SmoothNormal(prev, row, next, x, up);
+        }
+    }
+
+    HeightGrid::HeightGrid(uint32_t width, uint32_t height)
+        : Width{ width }, Height{ height }, Heights(static_cast<size_t>(width) * height), Colors(static_cast<size_t>(width) * height) {
+    }
+
+    glm::vec3 HeightGrid::GetPosition(uint32_t x, uint32_t z) const {
+        return glm::vec3(static_cast<float>(OriginX + x) * CellSize, Heights[GetIndex(x, z)], static_cast<float>(OriginZ + z) * CellSize);
+    }
+
+    glm::vec3 HeightGrid::GetNormal(uint32_t x, uint32_t z) const {
+        if (x == 0 || z == 0 || x + 1 >= Width || z + 1 >= Height)
+            return glm::vec3(0.f, 1.f, 0.f);
+        const float* row = Heights.data() + GetIndex(0, z);
+        return SmoothNormal(row - Width, row, row + Width, x, 6.f * CellSize);
+    }
+
+    void HeightGrid::GetNormals(uint32_t x0, uint32_t z, uint32_t count, glm::vec3* out) const {
+        // Border samples point straight up, only the ones between them need their neighbours.
+        const size_t end = static_cast<size_t>(x0) + count;
+        const size_t innerBegin = std::clamp<size_t>(1, x0, end);
+        const size_t innerEnd = z == 0 || z + 1 >= Height ? innerBegin : std::clamp<size_t>(Width - 1, innerBegin, end);
+        std::fill(out, out + (innerBegin - x0), glm::vec3(0.f, 1.f, 0.f));
+        std::fill(out + (innerEnd - x0), out + count, glm::vec3(0.f, 1.f, 0.f));
+        if (innerBegin < innerEnd) {
+            const float* row = Heights.data() + GetIndex(0, z);
+            SmoothNormals(row - Width, row, row + Width, innerBegin, innerEnd, 6.f * CellSize, out + (innerBegin - x0));
+        }
+    }
+
+    void HeightGrid::MakeNormals(uint32_t x0, uint32_t z0, uint32_t samplesX, uint32_t samplesZ, std::span<glm::vec3> out) const {
+        Parallel::For(samplesZ, Parallel::GetWorkerCount(samplesZ, s_MinRowsPerWorker), [&](size_t begin, size_t end, uint32_t) {
+            for (size_t z = begin; z < end; z++)
+                GetNormals(x0, z0 + static_cast<uint32_t>(z), samplesX, out.data() + z * samplesX);
+        });
+    }
+
+    std::vector<glm::vec3> HeightGrid::MakeNormals() const {
+        std::vector<glm::vec3> normals(Heights.size());
+        MakeNormals(0, 0, Width, Height, normals);
+        return normals;
+    }
+
+    void HeightGrid::GetSquare(uint32_t x, uint32_t z, Triangle& bottom, Triangle& top) const {
+        const glm::vec3 a = GetPosition(x, z);
+        const glm::vec3 b = GetPosition(x + 1, z);
+        const glm::vec3 c = GetPosition(x + 1, z + 1);
+        const glm::vec3 d = GetPosition(x, z + 1);
+
+        bottom.A = a;
+        bottom.B = c;
+        bottom.C = b;
+        top.A = a;
+        top.B = d;
+        top.C = c;
+        bottom.N = glm::normalize(glm::cross(bottom.B - bottom.A, bottom.C - bottom.A));
+        top.N = glm::normalize(glm::cross(top.B - top.A, top.C - top.A));
+    }
+
+    void HeightGrid::GetSquares(int xMin, int zMin, int xMax, int zMax, std::vector<Triangle>& out) const {
+        if (IsEmpty())
+            return;
+        xMin = std::max(xMin, 0);
+        zMin = std::max(zMin, 0);
+        xMax = std::min(xMax, static_cast<int>(Width) - 2);
+        zMax = std::min(zMax, static_cast<int>(Height) - 2);
+        for (int z = zMin; z <= zMax; z++) {
+            for (int x = xMin; x <= xMax; x++) {
+                auto& bottom = out.emplace_back();
+                auto& top = out.emplace_back();
+                GetSquare(x, z, bottom, top);
+            }
+        }
+    }
+
+    HeightGrid HeightGrid::Downsample() const {
+        HeightGrid out(Width / 2, Height / 2);
+        out.OriginX = OriginX / 2;
+        out.OriginZ = OriginZ / 2;
+        out.CellSize = CellSize * 2.f;
+        Parallel::For(out.Height, Parallel::GetWorkerCount(out.Height, s_MinRowsPerWorker), [&](size_t begin, size_t end, uint32_t) {
+            for (uint32_t z = static_cast<uint32_t>(begin); z < end; z++) {
+                for (uint32_t x = 0; x < out.Width; x++) {
+                    float height{ 0.f };
+                    glm::vec3 color{ 0.f };
+                    for (uint32_t i = 0; i < 4; i++) {
+                        height += Heights[GetIndex(2 * x + i % 2, 2 * z + i / 2)];
+                        color += GetColor(2 * x + i % 2, 2 * z + i / 2);
+                    }
+                    out.Heights[out.GetIndex(x, z)] = height * 0.25f;
+                    out.Colors[out.GetIndex(x, z)] = PackColor(color * 0.25f);
+                }
+            }
+        });
+        return out;
+    }
+
+    void HeightGrid::FillHoles(const std::vector<uint8_t>& known) {
+        // Height and color, averaged over the known samples a pyramid sample covers. Weight is 0 where it covers
+        // none. The grid itself is the finest level.
+        struct Level {
+            uint32_t Width;
+            uint32_t Height;
+            std::vector<glm::vec4> Values;
+            std::vector<float> Weights;
+        };
+        std::vector<Level> levels;
+
+        // Pull, fine to coarse.
+        uint32_t width = Width;
+        uint32_t height = Height;
+        while (width > 1 || height > 1) {
+            Level coarse{ (width + 1) / 2, (height + 1) / 2 };
+            coarse.Values.resize(static_cast<size_t>(coarse.Width) * coarse.Height);
+            coarse.Weights.resize(coarse.Values.size());
+            const Level* fine = levels.empty() ? nullptr : &levels.back();
+            Parallel::For(coarse.Height, Parallel::GetWorkerCount(coarse.Height, s_MinRowsPerWorker), [&](size_t begin, size_t end, uint32_t) {
+                for (size_t z = begin; z < end; z++) {
+                    for (uint32_t x = 0; x < coarse.Width; x++) {
+                        glm::vec4 sum{ 0.f };
+                        float weight{ 0.f };
+                        for (uint32_t i = 0; i < 4; i++) {
+                            const uint32_t fx = 2 * x + i % 2;
+                            const uint32_t fz = static_cast<uint32_t>(2 * z) + i / 2;
+                            if (fx >= width || fz >= height)
+                                continue;
+                            const size_t index = static_cast<size_t>(fz) * width + fx;
+                            if (fine) {
+                                sum += fine->Values[index] * fine->Weights[index];
+                                weight += fine->Weights[index];
+                            } else if (known[index]) {
+                                sum += glm::vec4(Heights[index], UnpackColor(Colors[index]));
+                                weight += 1.f;
+                            }
+                        }
+                        const size_t index = z * coarse.Width + x;
+                        coarse.Values[index] = weight > 0.f ? sum / weight : glm::vec4(0.f);
+                        coarse.Weights[index] = std::min(weight, 1.f);
+                    }
+                }
+            });
+            width = coarse.Width;
+            height = coarse.Height;
+            levels.push_back(std::move(coarse));
+        }
+        // Nothing known, nothing to spread.
+        if (levels.empty() || levels.back().Weights.front() == 0.f)
+            return;
+
+        auto interpolate = [](const Level& coarse, uint32_t x, uint32_t z) {
+            const float cx = std::clamp(x * 0.5f - 0.25f, 0.f, static_cast<float>(coarse.Width - 1));
+            const float cz = std::clamp(z * 0.5f - 0.25f, 0.f, static_cast<float>(coarse.Height - 1));
+            const uint32_t x0 = static_cast<uint32_t>(cx);
+            const uint32_t z0 = static_cast<uint32_t>(cz);
+            const uint32_t x1 = std::min(x0 + 1, coarse.Width - 1);
+            const uint32_t z1 = std::min(z0 + 1, coarse.Height - 1);
+            const float fx = cx - static_cast<float>(x0);
+            const float fz = cz - static_cast<float>(z0);
+            auto at = [&](uint32_t px, uint32_t pz) { return coarse.Values[static_cast<size_t>(pz) * coarse.Width + px]; };
+            return glm::mix(glm::mix(at(x0, z0), at(x1, z0), fx), glm::mix(at(x0, z1), at(x1, z1), fx), fz);
+        };
+
+        // Push, coarse to fine. Every level is complete before the one below reads it.
+        for (size_t level = levels.size() - 1; level-- > 0;) {
+            auto& fine = levels[level];
+            const auto& coarse = levels[level + 1];
+            Parallel::For(fine.Height, Parallel::GetWorkerCount(fine.Height, s_MinRowsPerWorker), [&](size_t begin, size_t end, uint32_t) {
+                for (size_t z = begin; z < end; z++) {
+                    for (uint32_t x = 0; x < fine.Width; x++) {
+                        const size_t index = z * fine.Width + x;
+                        const float weight = fine.Weights[index];
+                        if (weight < 1.f) {
+                            fine.Values[index] = fine.Values[index] * weight + interpolate(coarse, x, static_cast<uint32_t>(z)) * (1.f - weight);
+                            fine.Weights[index] = 1.f;
+                        }
+                    }
+                }
+            });
+        }
+
+        const auto& first = levels.front();
+        Parallel::For(Height, Parallel::GetWorkerCount(Height, s_MinRowsPerWorker), [&](size_t begin, size_t end, uint32_t) {
+            for (uint32_t z = static_cast<uint32_t>(begin); z < end; z++) {
+                for (uint32_t x = 0; x < Width; x++) {
+                    const size_t index = GetIndex(x, z);
+                    if (known[index])
+                        continue;
+                    const glm::vec4 value = interpolate(first, x, z);
+                    Heights[index] = value.x;
+                    Colors[index] = PackColor(glm::vec3(value.y, value.z, value.w));
+                }
+            }
+        });
+    }
+
+    std::vector<ColorNormalVertex> HeightGrid::MakeVertices() const {
+        std::vector<ColorNormalVertex> vertices(Heights.size());
+        Parallel::For(Height, Parallel::GetWorkerCount(Height, s_MinRowsPerWorker), [&](size_t begin, size_t end, uint32_t) {
+            std::vector<glm::vec3> normals(Width);
+            for (uint32_t z = static_cast<uint32_t>(begin); z < end; z++) {
+                GetNormals(0, z, Width, normals.data());
+                for (uint32_t x = 0; x < Width; x++) {
+                    auto& vertex = vertices[GetIndex(x, z)];
+                    vertex.Pos = GetPosition(x, z);
+                    vertex.Color = GetColor(x, z);
+                    vertex.Normal = normals[x];
+                }
+            }
+        });
+        return vertices;
+    }
+
+    std::vector<uint32_t> HeightGrid::MakeIndices() const {
+        std::vector<uint32_t> indices;
+        if (IsEmpty())
+            return indices;
+        indices.reserve(static_cast<size_t>(Width - 1) * (Height - 1) * 6);
+        for (uint32_t z = 0; z < Height - 1; z++) {
+            for (uint32_t x = 0; x < Width - 1; x++) {
+                const uint32_t a = static_cast<uint32_t>(GetIndex(x, z));
+                const uint32_t b = static_cast<uint32_t>(GetIndex(x + 1, z));
+                const uint32_t c = static_cast<uint32_t>(GetIndex(x + 1, z + 1));
+                const uint32_t d = static_cast<uint32_t>(GetIndex(x, z + 1));
+                indices.insert(indices.end(), { a, c, b, a, d, c });
+            }
+        }
+        return indices;
+    }
+
+    size_t HeightGrid::GetBytes() const {
+        return sizeof(HeightGrid) + Heights.capacity() * sizeof(float) + Colors.capacity() * sizeof(uint32_t);
+    }
+
+    uint32_t HeightGrid::PackColor(const glm::vec3& color) {
+        auto channel = [](float value) {
+            return static_cast<uint32_t>(std::lround(std::clamp(value, 0.f, 1.f) * 255.f));
+        };
+        return channel(color.r) | channel(color.g) << 8 | channel(color.b) << 16 | 0xFF000000u;
+    }
+
+    glm::vec3 HeightGrid::UnpackColor(uint32_t color) {
+        return glm::vec3(color & 0xFF, (color >> 8) & 0xFF, (color >> 16) & 0xFF) * (1.f / 255.f);
+    }
+}
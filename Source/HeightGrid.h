@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "Physics.h"
+#include "Vertex.h"
+
+namespace FLOOF {
+    // The terrain as one height and one packed color per sample, row major. Sample (x, z) sits at
+    // ((OriginX + x) * CellSize, height, (OriginZ + z) * CellSize). Render vertices, normals and collision
+    // triangles are derived from it when they are needed instead of being kept next to it.
+    struct HeightGrid {
+        HeightGrid() = default;
+        HeightGrid(uint32_t width, uint32_t height);
+
+        // Fewer than two samples along an axis leaves no squares.
+        bool IsEmpty() const { return Width < 2 || Height < 2; }
+        size_t GetIndex(uint32_t x, uint32_t z) const { return static_cast<size_t>(z) * Width + x; }
+        glm::vec3 GetPosition(uint32_t x, uint32_t z) const;
+        glm::vec3 GetColor(uint32_t x, uint32_t z) const { return UnpackColor(Colors[GetIndex(x, z)]); }
+        // Average of the six triangle normals around the sample, straight up on the border.
+        glm::vec3 GetNormal(uint32_t x, uint32_t z) const;
+        // GetNormal of count samples of row z from x0 on, four samples at a time where SSE2 is available.
+        void GetNormals(uint32_t x0, uint32_t z, uint32_t count, glm::vec3* out) const;
+        // GetNormal of a samplesX * samplesZ block from (x0, z0), row major and parallel over rows. Samples
+        // around the block are read from the grid, so a tile regenerated from the full grid gets the same normals
+        // along its border as the full grid.
+        void MakeNormals(uint32_t x0, uint32_t z0, uint32_t samplesX, uint32_t samplesZ, std::span<glm::vec3> out) const;
+        std::vector<glm::vec3> MakeNormals() const;
+
+        // The two triangles of square (x, z), wound like the mesh. With a = (x, z), b = (x + 1, z),
+        // c = (x + 1, z + 1) and d = (x, z + 1) they are (a, c, b) and (a, d, c).
+        void GetSquare(uint32_t x, uint32_t z, Triangle& bottom, Triangle& top) const;
+        // Appends both triangles of every square from (xMin, zMin) to (xMax, zMax), clamped to the grid.
+        void GetSquares(int xMin, int zMin, int xMax, int zMax, std::vector<Triangle>& out) const;
+
+        template<typename Func>
+        void ForEachTriangle(Func&& func) const {
+            if (IsEmpty())
+                return;
+            Triangle bottom, top;
+            for (uint32_t z = 0; z < Height - 1; z++) {
+                for (uint32_t x = 0; x < Width - 1; x++) {
+                    GetSquare(x, z, bottom, top);
+                    func(bottom);
+                    func(top);
+                }
+            }
+        }
+
+        // Half the samples along each axis at twice the cell size, every sample the mean of a 2x2 block.
+        HeightGrid Downsample() const;
+        // Push-pull interpolation of the samples whose known flag is 0, heights and colors alike. Known samples
+        // are averaged down a pyramid of half resolution levels, then on the way back up every hole takes the
+        // bilinear value of the level above it. Fills holes of any size in O(samples), known samples are kept.
+        void FillHoles(const std::vector<uint8_t>& known);
+
+        // Vertices for drawing, one per sample, and the indices of the triangles GetSquare returns.
+        std::vector<ColorNormalVertex> MakeVertices() const;
+        std::vector<uint32_t> MakeIndices() const;
+
+        size_t GetBytes() const;
+
+        // RGBA8, alpha is always opaque.
+        static uint32_t PackColor(const glm::vec3& color);
+        static glm::vec3 UnpackColor(uint32_t color);
+
+        uint32_t Width{ 0 };
+        uint32_t Height{ 0 };
+        uint32_t OriginX{ 0 };
+        uint32_t OriginZ{ 0 };
+        float CellSize{ 1.f };
+        std::vector<float> Heights;
+        std::vector<uint32_t> Colors;
+    };
+}
@@ -1,29 +1,258 @@
 #include "LasLoader.h"
 #include <fstream>
-#include <sstream>
+#include <string_view>
 #include <limits>
+#include <algorithm>
+#include <cstring>
+#include <utility>
 #include <stdio.h>
-LasLoader::LasLoader(const std::string& path) : PointData{} {
+#include "MappedFile.h"
+#include "Parallel.h"
+#include "TerrainCache.h"
+#include "TextParser.h"
+#include "Timer.h"
+
+namespace {
+    // LAS is little endian and records are packed, so fields are copied out instead of cast.
+    template<typename T>
+    T Load(const uint8_t* data) {
+        T value;
+        std::memcpy(&value, data, sizeof(T));
+        return value;
+    }
+
+    // Public header block sizes of LAS 1.2, 1.3 and 1.4.
+    constexpr size_t s_LasHeaderSize12 = 227;
+    constexpr size_t s_LasHeaderSize13 = 235;
+    constexpr size_t s_LasHeaderSize14 = 375;
+    constexpr size_t s_LasRecordHeaderSize = 54;
+    constexpr size_t s_LasExtendedRecordHeaderSize = 60;
+
+    bool ReadLasHeader(const uint8_t* data, size_t size, lasHeader& header) {
+        if (size < s_LasHeaderSize12)
+            return false;
+
+        size_t cursor = 0;
+        auto read = [&](auto& field) {
+            std::memcpy(&field, data + cursor, sizeof(field));
+            cursor += sizeof(field);
+        };
+        read(header.fileSignature);
+        read(header.sourceID);
+        read(header.globalEncoding);
+        read(header.GUID1);
+        read(header.GUID2);
+        read(header.GUID3);
+        read(header.GUID4);
+        read(header.versionMajor);
+        read(header.versionMinor);
+        read(header.systemIdentifier);
+        read(header.generatingSoftware);
+        read(header.creationDay);
+        read(header.creationYear);
+        read(header.headerSize);
+        read(header.offsetToPointData);
+        read(header.numberVariableLengthRecords);
+        read(header.pointDataRecordFormat);
+        read(header.pointDataRecordLength);
+        read(header.legacyNumberPointsRecords);
+        read(header.legacyNumberPointReturn);
+        read(header.xScaleFactor);
+        read(header.yScaleFactor);
+        read(header.zScaleFactor);
+        read(header.xOffset);
+        read(header.yOffset);
+        read(header.zOffset);
+        read(header.maxX);
+        read(header.minX);
+        read(header.maxY);
+        read(header.minY);
+        read(header.maxZ);
+        read(header.minZ);
+
+        if (std::memcmp(header.fileSignature, "LASF", 4) != 0
+            || header.headerSize < s_LasHeaderSize12 || header.headerSize > size
+            || header.offsetToPointData < header.headerSize || header.offsetToPointData > size)
+            return false;
+
+        if (header.versionMinor >= 3 && header.headerSize >= s_LasHeaderSize13)
+            read(header.startOfWaveformDataPacketRecord);
+        if (header.versionMinor >= 4 && header.headerSize >= s_LasHeaderSize14) {
+            read(header.startOfFirstExtendedVariableLengthRecord);
+            read(header.numberExtendedVariableLengthRecords);
+            read(header.numberPointRecords);
+            read(header.numberPointsByReturn);
+        }
+        return true;
+    }
+
+    // Collects the records between the header and the point data, and the extended records after it.
+    // Stops at the first record that does not fit in the file.
+    void ReadLasRecords(const uint8_t* data, size_t size, const lasHeader& header, std::vector<lasRecord>& records) {
+        auto text = [](const uint8_t* field, size_t length) {
+            const char* chars = reinterpret_cast<const char*>(field);
+            return std::string(chars, strnlen(chars, length));
+        };
+
+        uint64_t cursor = header.headerSize;
+        for (uint32_t i = 0; i < header.numberVariableLengthRecords; i++) {
+            if (cursor + s_LasRecordHeaderSize > header.offsetToPointData)
+                break;
+            const uint8_t* record = data + cursor;
+            lasRecord info;
+            info.userID = text(record + 2, 16);
+            info.recordID = Load<uint16_t>(record + 18);
+            info.length = Load<uint16_t>(record + 20);
+            info.description = text(record + 22, 32);
+            info.offset = cursor + s_LasRecordHeaderSize;
+            if (info.offset + info.length > header.offsetToPointData)
+                break;
+            records.push_back(std::move(info));
+            cursor = records.back().offset + records.back().length;
+        }
+
+        cursor = header.startOfFirstExtendedVariableLengthRecord;
+        for (uint32_t i = 0; i < header.numberExtendedVariableLengthRecords && cursor != 0; i++) {
+            if (cursor + s_LasExtendedRecordHeaderSize > size)
+                break;
+            const uint8_t* record = data + cursor;
+            lasRecord info;
+            info.userID = text(record + 2, 16);
+            info.recordID = Load<uint16_t>(record + 18);
+            info.length = Load<uint64_t>(record + 20);
+            info.description = text(record + 28, 32);
+            info.offset = cursor + s_LasExtendedRecordHeaderSize;
+            info.extended = true;
+            if (info.length > size - info.offset)
+                break;
+            records.push_back(std::move(info));
+            cursor = records.back().offset + records.back().length;
+        }
+    }
+
+    struct LasTransform {
+        double xScale, yScale, zScale;
+        double xOffset, yOffset, zOffset;
+    };
+
+    // One loop per point format, so field offsets are constants and formats without color skip the branch.
+    template<size_t Format>
+    void DecodeLasPoints(const uint8_t* record, size_t count, size_t recordLength, const LasTransform& transform, FLOOF::ColorVertex* out) {
+        constexpr lasPointFormat format = lasPointFormats[Format];
+        for (size_t i = 0; i < count; i++, record += recordLength) {
+            // Final position = (pos * scale factor) + offset. LAS is z up, we are y up.
+            out[i].Pos.x = static_cast<float>(Load<int32_t>(record) * transform.xScale + transform.xOffset);
+            out[i].Pos.y = static_cast<float>(Load<int32_t>(record + 8) * transform.zScale + transform.zOffset);
+            out[i].Pos.z = static_cast<float>(Load<int32_t>(record + 4) * transform.yScale + transform.yOffset);
+            if constexpr (format.rgbOffset != 0) {
+                out[i].Color = glm::vec3(Load<uint16_t>(record + format.rgbOffset),
+                    Load<uint16_t>(record + format.rgbOffset + 2),
+                    Load<uint16_t>(record + format.rgbOffset + 4)) * 0.00001f;
+            } else {
+                out[i].Color = glm::vec3(0.f, 1.f, 0.f);
+            }
+        }
+    }
+
+    using LasDecoder = void(*)(const uint8_t*, size_t, size_t, const LasTransform&, FLOOF::ColorVertex*);
+
+    template<size_t... Formats>
+    constexpr std::array<LasDecoder, sizeof...(Formats)> MakeLasDecoders(std::index_sequence<Formats...>) {
+        return { &DecodeLasPoints<Formats>... };
+    }
+
+    constexpr auto s_LasDecoders = MakeLasDecoders(std::make_index_sequence<lasPointFormats.size()>());
+
+    // Below this many points per thread, starting threads costs more than it saves.
+    constexpr size_t s_MinPointsPerWorker = 1 << 16;
+    // Every binning worker owns a full height grid, fewer workers are used when the grids would exceed this.
+    constexpr size_t s_BinningMemoryBudget = size_t{ 512 } << 20;
+    constexpr size_t s_MinRowsPerWorker = 64;
+
+    // Sums add up, so a coarse cell is the sum of the four finer cells it covers and the points are only
+    // binned once for every level.
+    std::vector<HeightAndColor> Coarsen(const std::vector<HeightAndColor>& cells, int width, int height) {
+        const int coarseWidth = width / 2;
+        const int coarseHeight = height / 2;
+        std::vector<HeightAndColor> out(static_cast<size_t>(coarseWidth) * coarseHeight);
+        const size_t rows = static_cast<size_t>(coarseHeight);
+        FLOOF::Parallel::For(rows, FLOOF::Parallel::GetWorkerCount(rows, s_MinRowsPerWorker), [&](size_t begin, size_t end, uint32_t) {
+            for (size_t z = begin; z < end; z++) {
+                for (int x = 0; x < coarseWidth; x++) {
+                    auto& cell = out[z * coarseWidth + x];
+                    for (int i = 0; i < 4; i++)
+                        cell.Add(cells[(2 * z + i / 2) * width + 2 * x + i % 2]);
+                }
+            }
+        });
+        return out;
+    }
+
+    // Averages every cell, cells without points are filled in from the ones around them. Heights are shifted
+    // down by top so the highest point ends up at 0.
+    FLOOF::HeightGrid MakeHeightGrid(const std::vector<HeightAndColor>& cells, int width, int height, float cellSize, float top, size_t& holes) {
+        FLOOF::HeightGrid grid(std::max(width, 0), std::max(height, 0));
+        grid.CellSize = cellSize;
+
+        std::vector<uint8_t> known(cells.size());
+        const size_t rows = static_cast<size_t>(std::max(height, 0));
+        FLOOF::Parallel::For(rows, FLOOF::Parallel::GetWorkerCount(rows, s_MinRowsPerWorker), [&](size_t begin, size_t end, uint32_t) {
+            for (size_t i = begin * width; i < end * width; i++) {
+                const auto& cell = cells[i];
+                known[i] = cell.count != 0;
+                // Stays like this only when the whole grid is empty.
+                grid.Heights[i] = known[i] ? cell.GetHeight() - top : -top;
+                grid.Colors[i] = FLOOF::HeightGrid::PackColor(known[i] ? cell.GetColor() : glm::vec3(1.f));
+            }
+        });
+
+        holes = static_cast<size_t>(std::count(known.begin(), known.end(), uint8_t{ 0 }));
+        if (holes > 0)
+            grid.FillHoles(known);
+        return grid;
+    }
+}
+
+LasLoader::LasLoader(const std::string& path, bool useCache, float cellSize, uint32_t levels)
+    : PointData{}, cellSize{ cellSize > 0.f ? cellSize : 1.f }, levelCount{ std::max(levels, 1u) } {
 
     std::string txt(".txt");
     std::string lasbin(".lasbin");
     std::string las(".las");
 
+    const bool isLas = path.find(txt) == std::string::npos && path.find(lasbin) == std::string::npos && path.find(las) != std::string::npos;
+    useCache = useCache && isLas;
+
+    FLOOF::Timer timer;
+    if (useCache && ReadCache(path)) {
+        // The cache only replaces binning and triangulation, the points are still decoded from the source and
+        // moved by the cached offset like a full load would.
+        const glm::vec3 cachedMin = min;
+        const glm::vec3 cachedMax = max;
+        ReadLas(path);
+        min = cachedMin;
+        max = cachedMax;
+        UpdatePoints();
+        readTime = timer.Delta();
+        return;
+    }
+
     if (path.find(txt) != std::string::npos)
-        ReadTxt(path);
+        PointData = ReadTxt(path);
     else if (path.find(lasbin) != std::string::npos)
         ReadBin(path);
-    else if (path.find(las) != std::string::npos)
+    else if (isLas)
         ReadLas(path);
     // TODO: Dont calc center when reading .las (already in header)
 
     CalcCenter();
     UpdatePoints();
+    readTime = timer.Delta();
     Triangulate();
-}
+    triangulateTime = timer.Delta();
 
-std::vector<FLOOF::ColorVertex> LasLoader::GetPointData() {
-    return LasLoader::PointData;
+    if (useCache)
+        WriteCache(path);
 }
 
 
@@ -58,240 +287,150 @@ void LasLoader::CalcCenter() {
 
 void LasLoader::UpdatePoints() {
 
-    for (auto& vertex : PointData) {
-        if (middle != glm::vec3(0.f))
-            vertex.Pos -= offset;
-    }
+    if (middle == glm::vec3(0.f))
+        return;
+
+    const uint32_t workers = FLOOF::Parallel::GetWorkerCount(PointData.size(), s_MinPointsPerWorker);
+    FLOOF::Parallel::For(PointData.size(), workers, [this](size_t begin, size_t end, uint32_t) {
+        for (size_t i = begin; i < end; i++)
+            PointData[i].Pos -= offset;
+    });
 }
 
 void LasLoader::Triangulate() {
 
     // width and height
-    xSquares = (max.x - min.x);
-    zSquares = (max.z - min.z);
-
-    // Save all height data for each vertex
-    std::vector<std::vector<HeightAndColor>> heightmap(zSquares, std::vector<HeightAndColor>(xSquares));
-    for (auto& vertex : PointData) {
-        int xPos = vertex.Pos.x;
-        int zPos = vertex.Pos.z;
-
-        if (xPos < 0.f || xPos > xSquares - 1
-            || zPos < 0.f || zPos > zSquares - 1) {
-            continue;
-        }
-
-        // Instead of push back, add height and increment
-        heightmap[zPos][xPos].count++;
-        heightmap[zPos][xPos].sum += vertex.Pos.y;
-        heightmap[zPos][xPos].color += vertex.Color;
-    }
-
-    std::vector<std::pair<int, int>> noHeight;
-
-    // Calculate average height for each vertex and push
-    for (int z = 0; z < zSquares; ++z) {
-        for (int x = 0; x < xSquares; ++x) {
-            float y;
-            glm::vec3 color{};
-            if (heightmap[z][x].count == 0) {
-                y = -max.y;
-                noHeight.push_back(std::make_pair(x, z));
-                color = glm::vec3(1.f);
-            } else {
-                //y = (average / count) - max.y;
-                y = heightmap[z][x].sum / heightmap[z][x].count - max.y;
-                color = heightmap[z][x].color / glm::vec3(heightmap[z][x].count);
+    FLOOF::Timer timer;
+    const float inverseCellSize = 1.f / cellSize;
+    xSquares = (max.x - min.x) * inverseCellSize;
+    zSquares = (max.z - min.z) * inverseCellSize;
+
+    // Save all height data for each vertex. Every worker bins its share of the points into a private grid,
+    // the grids are summed into the first one afterwards.
+    const size_t cells = static_cast<size_t>(std::max(xSquares, 0)) * static_cast<size_t>(std::max(zSquares, 0));
+    uint32_t workers = FLOOF::Parallel::GetWorkerCount(PointData.size(), s_MinPointsPerWorker);
+    if (cells > 0)
+        workers = static_cast<uint32_t>(std::clamp<size_t>(s_BinningMemoryBudget / (cells * sizeof(HeightAndColor)), 1, workers));
+
+    std::vector<std::vector<HeightAndColor>> bins(workers);
+    bins[0].resize(cells);
+    FLOOF::Parallel::For(PointData.size(), workers, [&](size_t begin, size_t end, uint32_t worker) {
+        auto& grid = bins[worker];
+        grid.resize(cells);
+        for (size_t i = begin; i < end; i++) {
+            const auto& vertex = PointData[i];
+            int xPos = vertex.Pos.x * inverseCellSize;
+            int zPos = vertex.Pos.z * inverseCellSize;
+
+            if (xPos < 0.f || xPos > xSquares - 1
+                || zPos < 0.f || zPos > zSquares - 1) {
+                continue;
             }
-            FLOOF::MeshVertex temp{};
-            FLOOF::ColorNormalVertex temp2{};
-            temp.Pos = glm::vec3(x, y, z);
-            temp2.Pos = temp.Pos;
-            temp2.Color = color;
-            VertexData.push_back(temp);
-            ColorNormalVertexData.push_back(temp2);
-        }
-    }
-
-    // Calculate average height if no height
-    for (auto& vertex : noHeight) {
-        int x = vertex.first;
-        int z = vertex.second;
-        if (x <= 0 || x >= xSquares - 1 || z <= 0 || z >= zSquares - 1) {
-            continue;
-        } else {
-            float averageHeight{ 0.f };
-            averageHeight += VertexData[(x - 1) + (z * xSquares)].Pos.y;
-            averageHeight += VertexData[(x - 1) + ((z - 1) * xSquares)].Pos.y;
-            averageHeight += VertexData[x + ((z - 1) * xSquares)].Pos.y;
-            averageHeight += VertexData[(x + 1) + ((z - 1) * xSquares)].Pos.y;
-            averageHeight += VertexData[(x + 1) + (z * xSquares)].Pos.y;
-            averageHeight += VertexData[(x + 1) + ((z + 1) * xSquares)].Pos.y;
-            averageHeight += VertexData[x + ((z + 1) * xSquares)].Pos.y;
-            averageHeight += VertexData[(x - 1) + ((z + 1) * xSquares)].Pos.y;
-
-            glm::vec3 averageColor{};
-            averageColor += ColorNormalVertexData[(x - 1) + (z * xSquares)].Color;
-            averageColor += ColorNormalVertexData[(x - 1) + ((z - 1) * xSquares)].Color;
-            averageColor += ColorNormalVertexData[x + ((z - 1) * xSquares)].Color;
-            averageColor += ColorNormalVertexData[(x + 1) + ((z - 1) * xSquares)].Color;
-            averageColor += ColorNormalVertexData[(x + 1) + (z * xSquares)].Color;
-            averageColor += ColorNormalVertexData[(x + 1) + ((z + 1) * xSquares)].Color;
-            averageColor += ColorNormalVertexData[x + ((z + 1) * xSquares)].Color;
-            averageColor += ColorNormalVertexData[(x - 1) + ((z + 1) * xSquares)].Color;
-
-            VertexData[x + (z * xSquares)].Pos.y = averageHeight / 8.f;
-            ColorNormalVertexData[x + (z * xSquares)].Pos.y = averageHeight / 8.f;
-            ColorNormalVertexData[x + (z * xSquares)].Color = averageColor / 8.f;
-        }
-    }
-
-    // Create Index
-    for (int z = 0; z < zSquares - 1; ++z) {
-        for (int x = 0; x < xSquares - 1; ++x) {
-            IndexData.emplace_back(x + (xSquares * z));
-            IndexData.emplace_back(x + 1 + (xSquares * (z + 1)));
-            IndexData.emplace_back(x + 1 + (xSquares * z));
 
-            IndexData.emplace_back(x + (xSquares * z));
-            IndexData.emplace_back(x + (xSquares * (z + 1)));
-            IndexData.emplace_back(x + 1 + (xSquares * (z + 1)));
+            // Instead of push back, add height and increment
+            grid[static_cast<size_t>(zPos) * xSquares + xPos].Add(vertex);
         }
+    });
+
+    auto& heightmap = bins[0];
+    if (workers > 1) {
+        FLOOF::Parallel::For(cells, FLOOF::Parallel::GetWorkerCount(cells, s_MinPointsPerWorker), [&](size_t begin, size_t end, uint32_t) {
+            for (uint32_t worker = 1; worker < workers; worker++) {
+                const auto& grid = bins[worker];
+                for (size_t i = begin; i < end; i++)
+                    heightmap[i].Add(grid[i]);
+            }
+        });
+        bins.resize(1);
     }
 
-    // Calculate smooth normals
-    int xmin = 0, xmax = xSquares, zmin = 0, zmax = zSquares; // The size to draw
-
-    // Normals for rest
-    for (int z = zmin; z < zmax; z++) {
-        for (int x = xmin; x < xmax; x++) {
-            if (z == zmin || z == zmax - 1 || x == xmin || x == xmax - 1) {
-                VertexData[x + (xmax * z)].Normal = glm::vec3(0.f, 1.f, 0.f);
-            } else {
-                glm::vec3 a(VertexData[x + (xmax * z)].Pos);
-                glm::vec3 b(VertexData[x + 1 + (xmax * z)].Pos);
-                glm::vec3 c(VertexData[x + 1 + (xmax * (z + 1))].Pos);
-                glm::vec3 d(VertexData[x + (xmax * (z + 1))].Pos);
-                glm::vec3 e(VertexData[x - 1 + (xmax * z)].Pos);
-                glm::vec3 f(VertexData[x - 1 + (xmax * (z - 1))].Pos);
-                glm::vec3 g(VertexData[x + (xmax * (z - 1))].Pos);
-
-                auto n0 = glm::cross(c - a, b - a);
-                auto n1 = glm::cross(d - a, c - a);
-                auto n2 = glm::cross(e - a, d - a);
-                auto n3 = glm::cross(f - a, e - a);
-                auto n4 = glm::cross(g - a, f - a);
-                auto n5 = glm::cross(b - a, g - a);
-
-                glm::vec3 normal = n0 + n1 + n2 + n3 + n4 + n5;
-                normal = glm::normalize(normal);
-
-                VertexData[x + (xmax * z)].Normal = normal;
-                ColorNormalVertexData[x + (xmax * z)].Normal = normal;
-            }
+    grids.clear();
+    levelTimes.clear();
+    levelHoles.clear();
+    int width = xSquares;
+    int height = zSquares;
+    for (uint32_t level = 0; level < levelCount; level++) {
+        if (level > 0) {
+            if (width / 2 < 2 || height / 2 < 2)
+                break;
+            heightmap = Coarsen(heightmap, width, height);
+            width /= 2;
+            height /= 2;
         }
+        size_t holes{ 0 };
+        grids.push_back(MakeHeightGrid(heightmap, width, height, cellSize * static_cast<float>(1u << level), max.y, holes));
+        levelTimes.push_back(timer.Delta());
+        levelHoles.push_back(holes);
     }
 }
 
-
-std::pair<std::vector<FLOOF::MeshVertex>, std::vector<uint32_t>> LasLoader::GetIndexedData() {
-    return { LasLoader::VertexData, LasLoader::IndexData };
-}
-
-std::vector<FLOOF::MeshVertex> LasLoader::GetVertexData() {
-    std::vector<FLOOF::MeshVertex> out;
-    int i = 0;
-    while (i != IndexData.size()) {
-        FLOOF::MeshVertex tempA;
-        tempA = VertexData[IndexData[i]];
-        i++;
-
-        FLOOF::MeshVertex tempB;
-        tempB = VertexData[IndexData[i]];
-        i++;
-
-        FLOOF::MeshVertex tempC;
-        tempC = VertexData[IndexData[i]];
-        i++;
-
-        auto ab = tempB.Pos - tempA.Pos;
-        auto ac = tempC.Pos - tempA.Pos;
-
-        glm::vec3 normal = glm::normalize(glm::cross(ab, ac));
-        tempA.Normal = normal;
-        tempB.Normal = normal;
-        tempC.Normal = normal;
-
-        tempA.UV.x = tempA.Pos.x;
-        tempA.UV.y = tempA.Pos.y;
-        tempB.UV.x = tempB.Pos.x;
-        tempB.UV.y = tempB.Pos.y;
-        tempC.UV.x = tempC.Pos.x;
-        tempC.UV.y = tempC.Pos.y;
-
-        out.push_back(tempA);
-        out.push_back(tempB);
-        out.push_back(tempC);
+bool LasLoader::ReadCache(const std::string& path) {
+    FLOOF::TerrainCache cache;
+    if (!cache.Open(FLOOF::TerrainCache::GetCachePath(path), path))
+        return false;
+
+    const auto bounds = cache.GetBounds();
+    min = bounds.Min;
+    max = bounds.Max;
+    offset = bounds.Offset;
+    middle = bounds.Middle;
+    xSquares = static_cast<int>(cache.GetWidth());
+    zSquares = static_cast<int>(cache.GetHeight());
+    if (cache.GetCellSize() != cellSize)
+        return false;
+
+    // Normals are derived from the heights, the cached ones are for the tiles.
+    FLOOF::Timer timer;
+    const auto heights = cache.GetHeights();
+    const auto colors = cache.GetColors();
+    const size_t cells = heights.size();
+    auto& grid = grids.front();
+    grid = FLOOF::HeightGrid(xSquares, zSquares);
+    grid.CellSize = cellSize;
+    std::copy(heights.begin(), heights.end(), grid.Heights.begin());
+    for (size_t i = 0; i < cells; i++)
+        grid.Colors[i] = FLOOF::HeightGrid::PackColor(colors[i]);
+    levelTimes.front() = timer.Delta();
+
+    // Coarser levels average the finer grid instead of binning the points again.
+    for (uint32_t level = 1; level < levelCount && grids.back().Width / 2 >= 2 && grids.back().Height / 2 >= 2; level++) {
+        grids.push_back(grids.back().Downsample());
+        levelTimes.push_back(timer.Delta());
+        levelHoles.push_back(0);
     }
-    return out;
-}
 
-std::pair<std::vector<FLOOF::ColorNormalVertex>, std::vector<uint32_t>> LasLoader::GetIndexedColorNormalVertexData() {
-    return { ColorNormalVertexData, IndexData };
+    fromCache = true;
+    return true;
 }
 
-std::vector<std::vector<std::pair<FLOOF::Triangle, FLOOF::Triangle>>> LasLoader::GetTerrainData() {
-
-    int width = (max.x - min.x);
-    int height = (max.z - min.z);
-
-    std::vector<std::vector<std::pair<FLOOF::Triangle, FLOOF::Triangle>>> out(height - 1,
-        std::vector<std::pair<FLOOF::Triangle, FLOOF::Triangle>>(width - 1));
-
-    for (int z = 0; z < height - 1; z++) {
-        for (int x = 0; x < width - 1; x++) {
-            FLOOF::Triangle bottom;
-            FLOOF::Triangle top;
-
-            int aIndex = (x + (z * width));
-            int bIndex = ((x + 1) + (z * width));
-            int cIndex = ((x + 1) + ((z + 1) * width));
-            int dIndex = (x + ((z + 1) * width));
-
-            bottom.A = VertexData[aIndex].Pos;
-            bottom.B = VertexData[cIndex].Pos;
-            bottom.C = VertexData[bIndex].Pos;
-
-            top.A = VertexData[aIndex].Pos;
-            top.B = VertexData[dIndex].Pos;
-            top.C = VertexData[cIndex].Pos;
-
-            bottom.N = glm::normalize(glm::cross(bottom.B - bottom.A, bottom.C - bottom.A));
-            top.N = glm::normalize(glm::cross(top.B - top.A, top.C - top.A));
+void LasLoader::WriteCache(const std::string& path) {
+    if (xSquares <= 0 || zSquares <= 0)
+        return;
 
-            out[z][x] = std::make_pair(bottom, top);
-        }
-    }
-    return out;
+    const auto& grid = grids.front();
+    const size_t cells = grid.Heights.size();
+    std::vector<glm::vec3> colors(cells);
+    for (size_t i = 0; i < cells; i++)
+        colors[i] = FLOOF::HeightGrid::UnpackColor(grid.Colors[i]);
+    const auto normals = grid.MakeNormals();
+
+    const FLOOF::TerrainCache::Bounds bounds{ min, max, offset, middle };
+    const std::string cachePath = FLOOF::TerrainCache::GetCachePath(path);
+    if (!FLOOF::TerrainCache::Write(cachePath, path, xSquares, zSquares, cellSize, bounds, grid.Heights, colors, normals))
+        std::cout << "Could not write terrain cache: " << cachePath << std::endl;
 }
 
-void LasLoader::ReadTxt(const std::string& path) {
-    std::ifstream file(path);
-
-    if (!file.is_open()) {
+std::vector<FLOOF::ColorVertex> LasLoader::ReadTxt(const std::string& path) {
+    FLOOF::MappedFile file(path);
+    if (!file.IsOpen()) {
         std::cout << "Cant open file: " << path << std::endl;
-        return;
-    }
-    std::string line;
-    FLOOF::ColorVertex tempVertex{};
-    while (std::getline(file, line)) {
-        std::stringstream ss(line);
-        ss >> tempVertex.Pos.x;
-        ss >> tempVertex.Pos.z;
-        ss >> tempVertex.Pos.y;
-        tempVertex.Color = glm::vec3(0.f, 1.f, 0.f);
-        PointData.push_back(tempVertex);
+        return {};
     }
+
+    const std::string_view text(reinterpret_cast<const char*>(file.GetData()), file.GetSize());
+    return FLOOF::TextParser::ReadRows<3, FLOOF::ColorVertex>(text, [](const std::array<float, 3>& values) {
+        return FLOOF::ColorVertex{ glm::vec3(values[0], values[2], values[1]), glm::vec3(0.f, 1.f, 0.f) };
+    });
 }
 
 void LasLoader::ReadBin(const std::string& path) {
@@ -313,101 +452,55 @@ void LasLoader::ReadBin(const std::string& path) {
 }
 
 void LasLoader::ReadLas(const std::string& path) {
-    lasHeader header;
-    std::ifstream inf(path, std::ios::binary | std::ios::ate);
-    if (inf.is_open()) {
-
-        // Read Header
-        inf.seekg(0);
-        inf.read((char*)&header.fileSignature, sizeof(header.fileSignature));
-        inf.read((char*)&header.sourceID, sizeof(header.sourceID));
-        inf.read((char*)&header.globalEncoding, sizeof(header.globalEncoding));
-        inf.read((char*)&header.GUID1, sizeof(header.GUID1));
-        inf.read((char*)&header.GUID2, sizeof(header.GUID2));
-        inf.read((char*)&header.GUID3, sizeof(header.GUID3));
-        inf.read((char*)&header.GUID4, sizeof(header.GUID4));
-        inf.read((char*)&header.versionMajor, sizeof(header.versionMajor));
-        inf.read((char*)&header.versionMinor, sizeof(header.versionMinor));
-        inf.read((char*)&header.systemIdentifier, sizeof(header.systemIdentifier));
-        inf.read((char*)&header.generatingSoftware, sizeof(header.generatingSoftware));
-        inf.read((char*)&header.creationDay, sizeof(header.creationDay));
-        inf.read((char*)&header.creationYear, sizeof(header.creationYear));
-        inf.read((char*)&header.headerSize, sizeof(header.headerSize));
-        inf.read((char*)&header.offsetToPointData, sizeof(header.offsetToPointData));
-        inf.read((char*)&header.numberVariableLengthRecords, sizeof(header.numberVariableLengthRecords));
-        inf.read((char*)&header.pointDataRecordFormat, sizeof(header.pointDataRecordFormat));
-        inf.read((char*)&header.pointDataRecordLength, sizeof(header.pointDataRecordLength));
-        inf.read((char*)&header.legacyNumberPointsRecords, sizeof(header.legacyNumberPointsRecords));
-        inf.read((char*)&header.legacyNumberPointReturn, sizeof(header.legacyNumberPointReturn));
-        inf.read((char*)&header.xScaleFactor, sizeof(header.xScaleFactor));
-        inf.read((char*)&header.yScaleFactor, sizeof(header.yScaleFactor));
-        inf.read((char*)&header.zScaleFactor, sizeof(header.zScaleFactor));
-        inf.read((char*)&header.xOffset, sizeof(header.xOffset));
-        inf.read((char*)&header.yOffset, sizeof(header.yOffset));
-        inf.read((char*)&header.zOffset, sizeof(header.zOffset));
-        inf.read((char*)&header.maxX, sizeof(header.maxX));
-        inf.read((char*)&header.minX, sizeof(header.minX));
-        inf.read((char*)&header.maxY, sizeof(header.maxY));
-        inf.read((char*)&header.minY, sizeof(header.minY));
-        inf.read((char*)&header.maxZ, sizeof(header.maxZ));
-        inf.read((char*)&header.minZ, sizeof(header.minZ));
-
-        // Save max and min from header (so that we don't need to calculate it later)
-        min.x = header.minX;
-        min.y = header.minZ;
-        min.z = header.minY;
-        max.x = header.maxX;
-        max.y = header.maxZ;
-        max.z = header.maxY;
-
-        // Read pointdata
-        inf.seekg(header.offsetToPointData);
-
-        // Only format 1 and 2 supported
-        ASSERT(header.pointDataRecordFormat == 1 || header.pointDataRecordFormat == 2);
-
-        // Read format 1
-        if (header.pointDataRecordFormat == 1) {
-            for (int i = 0; i < header.legacyNumberPointsRecords; ++i) {
-                lasPointData1 temp;
-                inf.seekg(header.offsetToPointData + (header.pointDataRecordLength * i));
-                inf.read((char*)&temp.xPos, sizeof(temp.xPos));
-                inf.read((char*)&temp.yPos, sizeof(temp.yPos));
-                inf.read((char*)&temp.zPos, sizeof(temp.zPos));
-
-                FLOOF::ColorVertex tempVertex{};
-                // Final position = (pos * scale factor) + offset
-                tempVertex.Pos.x = (temp.xPos * header.xScaleFactor) + header.xOffset;
-                tempVertex.Pos.y = (temp.zPos * header.zScaleFactor) + header.zOffset;
-                tempVertex.Pos.z = (temp.yPos * header.yScaleFactor) + header.yOffset;
-                tempVertex.Color = glm::vec3(0.f, 1.f, 0.f);
-                PointData.push_back(tempVertex);
-            }
-        }
-        // Read format 2
-        else if (header.pointDataRecordFormat == 2) {
-            for (int i = 0; i < header.legacyNumberPointsRecords; ++i) {
-                lasPointData2 temp;
-                inf.read((char*)&temp.xPos, sizeof(temp.xPos));
-                inf.read((char*)&temp.yPos, sizeof(temp.yPos));
-                inf.read((char*)&temp.zPos, sizeof(temp.zPos));
-                inf.read((char*)&temp.intensity, sizeof(temp.intensity));
-                inf.read((char*)&temp.flags, sizeof(temp.flags));
-                inf.read((char*)&temp.classificaton, sizeof(temp.classificaton));
-                inf.read((char*)&temp.scanAngle, sizeof(temp.scanAngle));
-                inf.read((char*)&temp.userData, sizeof(temp.userData));
-                inf.read((char*)&temp.pointSourceID, sizeof(temp.pointSourceID));
-                inf.read((char*)&temp.red, sizeof(temp.red));
-                inf.read((char*)&temp.green, sizeof(temp.green));
-                inf.read((char*)&temp.blue, sizeof(temp.blue));
-
-                FLOOF::ColorVertex tempVertex{};
-                tempVertex.Pos.x = (temp.xPos * header.xScaleFactor) + header.xOffset;
-                tempVertex.Pos.y = (temp.zPos * header.zScaleFactor) + header.zOffset;
-                tempVertex.Pos.z = (temp.yPos * header.yScaleFactor) + header.yOffset;
-                tempVertex.Color = glm::vec3(temp.red * 0.00001, temp.green * 0.00001, temp.blue * 0.00001);
-                PointData.push_back(tempVertex);
-            }
-        }
+    FLOOF::MappedFile file(path);
+    if (!file.IsOpen()) {
+        std::cout << "Cant open file: " << path << std::endl;
+        return;
     }
+
+    const uint8_t* data = file.GetData();
+    const size_t size = file.GetSize();
+
+    lasHeader header{};
+    if (!ReadLasHeader(data, size, header)) {
+        std::cout << "Invalid LAS header: " << path << std::endl;
+        return;
+    }
+
+    // LAZ sets the two high bits of the format, so compressed files end up here as well.
+    const uint8_t format = header.pointDataRecordFormat;
+    if (format >= lasPointFormats.size() || header.pointDataRecordLength < lasPointFormats[format].size) {
+        std::cout << "Unsupported LAS point format " << static_cast<int>(format) << ": " << path << std::endl;
+        return;
+    }
+
+    ReadLasRecords(data, size, header, records);
+
+    // Save max and min from header (so that we don't need to calculate it later)
+    min.x = header.minX;
+    min.y = header.minZ;
+    min.z = header.minY;
+    max.x = header.maxX;
+    max.y = header.maxZ;
+    max.z = header.maxY;
+
+    // 1.4 files keep the 64 bit count, the legacy one is 0 for formats 6-10 and files over 4G points.
+    uint64_t count = header.numberPointRecords != 0 ? header.numberPointRecords : header.legacyNumberPointsRecords;
+    const size_t recordLength = header.pointDataRecordLength;
+    const uint64_t available = (size - header.offsetToPointData) / recordLength;
+    if (count > available) {
+        std::cout << "LAS file truncated, reading " << available << " of " << count << " points: " << path << std::endl;
+        count = available;
+    }
+
+    PointData.resize(count);
+
+    // Records are fixed size, so every worker decodes its own contiguous range.
+    const LasTransform transform{ header.xScaleFactor, header.yScaleFactor, header.zScaleFactor, header.xOffset, header.yOffset, header.zOffset };
+    const LasDecoder decoder = s_LasDecoders[format];
+    const uint8_t* pointData = data + header.offsetToPointData;
+    const uint32_t workers = FLOOF::Parallel::GetWorkerCount(count, s_MinPointsPerWorker);
+    FLOOF::Parallel::For(count, workers, [&](size_t begin, size_t end, uint32_t) {
+        decoder(pointData + begin * recordLength, end - begin, recordLength, transform, PointData.data() + begin);
+    });
 }
@@ -1,30 +1,68 @@
 #pragma once
+#include <array>
 #include <string>
+#include <utility>
 #include <vector>
 #include "Floof.h"
+#include "HeightGrid.h"
 #include "Vertex.h"
 #include "Physics.h"
+
+// Variable length record. Offset and length locate the payload after the record header.
+struct lasRecord {
+    std::string userID;
+    std::string description;
+    uint16_t recordID{ 0 };
+    uint64_t offset{ 0 };
+    uint64_t length{ 0 };
+    bool extended{ false };
+};
+
 class LasLoader {
 
 public:
-    LasLoader(const std::string& path);
-    std::vector<FLOOF::ColorVertex> GetPointData();
-    std::pair<std::vector<FLOOF::MeshVertex>, std::vector<uint32_t>> GetIndexedData();
-    std::vector<FLOOF::MeshVertex> GetVertexData();
-    std::pair<std::vector<FLOOF::ColorNormalVertex>, std::vector<uint32_t>> GetIndexedColorNormalVertexData();
-    std::vector<std::vector<std::pair<FLOOF::Triangle, FLOOF::Triangle>>> GetTerrainData();
+    // .las files are baked to a .floofterrain cache next to them and loaded from it while the source is unchanged.
+    // cellSize is the distance between height samples in world units. levels above 1 add coarser grids, each
+    // with twice the cell size of the one before, all binned from the same pass over the points.
+    LasLoader(const std::string& path, bool useCache = true, float cellSize = 1.f, uint32_t levels = 1);
+    // The decoded points, centered like the grid. Stays valid for the lifetime of the loader.
+    const std::vector<FLOOF::ColorVertex>& GetPointData() const { return PointData; }
+    // The terrain, level 0 is the finest. Meshes and triangles are built from the grid, see HeightGrid.
+    const FLOOF::HeightGrid& GetHeightGrid(uint32_t level = 0) const { return grids[level]; }
+    // Moves a level out, the loader has no grid for it afterwards.
+    FLOOF::HeightGrid TakeHeightGrid(uint32_t level = 0) { return std::move(grids[level]); }
+    // Can be fewer than asked for, levels stop before a grid gets narrower than two samples.
+    uint32_t GetLevelCount() const { return static_cast<uint32_t>(grids.size()); }
+    // Seconds spent building a level, level 0 includes binning the points.
+    double GetLevelTime(uint32_t level) const { return levelTimes[level]; }
+    // Samples of a level without points, filled in from their surroundings. 0 when loaded from the cache.
+    size_t GetLevelHoles(uint32_t level) const { return levelHoles[level]; }
     float GetMinY() { return -max.y; }
+    // Samples of the height grid along x and z.
+    int GetGridWidth() const { return xSquares; }
+    int GetGridHeight() const { return zSquares; }
+    // Seconds spent reading points and building the height grid.
+    double GetReadTime() const { return readTime; }
+    double GetTriangulateTime() const { return triangulateTime; }
+    // Variable length records of a .las file, extended records last.
+    const std::vector<lasRecord>& GetVariableLengthRecords() const { return records; }
+    // True when the terrain came from the cache. The points are still read from the source.
+    bool IsFromCache() const { return fromCache; }
+    // Points of a text export, "x y z" per line with z up like LAS. Mapped and parsed on all workers, lines
+    // without three numbers are skipped.
+    static std::vector<FLOOF::ColorVertex> ReadTxt(const std::string& path);
 private:
     std::vector<FLOOF::ColorVertex> PointData;
-    std::vector<FLOOF::MeshVertex> VertexData;
-    std::vector<FLOOF::ColorNormalVertex> ColorNormalVertexData;
-    std::vector<uint32_t> IndexData;
-    std::vector<FLOOF::MeshVertex> TriangulatedVertexData;
-    std::vector<FLOOF::Triangle> triangles;
+    std::vector<FLOOF::HeightGrid> grids = std::vector<FLOOF::HeightGrid>(1);
+    std::vector<double> levelTimes = std::vector<double>(1, 0.0);
+    std::vector<size_t> levelHoles = std::vector<size_t>(1, 0);
+    float cellSize{ 1.f };
+    uint32_t levelCount{ 1 };
 
-    void ReadTxt(const std::string& path);
     void ReadBin(const std::string& path);
     void ReadLas(const std::string& path);
+    bool ReadCache(const std::string& path);
+    void WriteCache(const std::string& path);
 
     void CalcCenter();
     void FindMinMax();
@@ -37,12 +75,48 @@ private:
     glm::vec3 offset{ 0.f };
     int xSquares{ 0 };
     int zSquares{ 0 };
+
+    double readTime{ 0.0 };
+    double triangulateTime{ 0.0 };
+
+    std::vector<lasRecord> records;
+    bool fromCache{ false };
 };
 
+// Sums are fixed point so a cell adds up to the same value in any order. That keeps binning with several
+// threads bit for bit equal to binning with one.
 struct HeightAndColor {
+    static constexpr double heightScale = 1024.0;
+    static constexpr double colorScale = 65536.0;
+
+    static int64_t ToFixed(double value, double scale) {
+        const double scaled = value * scale;
+        return static_cast<int64_t>(scaled < 0.0 ? scaled - 0.5 : scaled + 0.5);
+    }
+
+    void Add(const FLOOF::ColorVertex& vertex) {
+        count++;
+        sum += ToFixed(vertex.Pos.y, heightScale);
+        for (int i = 0; i < 3; i++)
+            color[i] += ToFixed(vertex.Color[i], colorScale);
+    }
+
+    void Add(const HeightAndColor& other) {
+        count += other.count;
+        sum += other.sum;
+        for (int i = 0; i < 3; i++)
+            color[i] += other.color[i];
+    }
+
+    float GetHeight() const { return static_cast<float>(static_cast<double>(sum) / (heightScale * count)); }
+    glm::vec3 GetColor() const {
+        const double divisor = colorScale * count;
+        return glm::vec3(static_cast<double>(color[0]) / divisor, static_cast<double>(color[1]) / divisor, static_cast<double>(color[2]) / divisor);
+    }
+
     int count{ 0 };
-    float sum{ 0.f };
-    glm::vec3 color{ 0.f };
+    int64_t sum{ 0 };
+    int64_t color[3]{};
 };
 
 // Can't use struct directly because of padding of the size of the struct
@@ -65,53 +139,42 @@ struct lasHeader {
     uint32_t numberVariableLengthRecords;
     uint8_t pointDataRecordFormat;
     uint16_t pointDataRecordLength;
-    int32_t legacyNumberPointsRecords;
-    int32_t legacyNumberPointReturn[5];
+    uint32_t legacyNumberPointsRecords;
+    uint32_t legacyNumberPointReturn[5];
     double xScaleFactor, yScaleFactor, zScaleFactor;
     double xOffset, yOffset, zOffset;
     double maxX, minX;
     double maxY, minY;
     double maxZ, minZ;
+    // LAS 1.3
+    uint64_t startOfWaveformDataPacketRecord;
+    // LAS 1.4
+    uint64_t startOfFirstExtendedVariableLengthRecord;
+    uint32_t numberExtendedVariableLengthRecords;
+    uint64_t numberPointRecords;
+    uint64_t numberPointsByReturn[15];
 };
 
-// Not needed
-struct lasVariableLengthRecords {
-    // Variable Length Records
-    uint16_t lasReserved;
-    char UserID[16];
-    uint16_t recordID;
-    uint16_t recordLengthAfterHeader;
-    char lasDescription[32];
-};
-
-// Can't use struct directly because of padding of the size of the struct
-struct lasPointData1 {
-    int32_t xPos;
-    int32_t yPos;
-    int32_t zPos;
-    uint16_t intensity;
-    int8_t flags;
-    uint8_t classificaton;
-    int8_t scanAngle;
-    uint8_t userData;
-    uint16_t pointSourceID;
-    double GPSTime;
-};
-
-// Can't use struct directly because of padding of the size of the struct
-struct lasPointData2 {
-    int32_t xPos;
-    int32_t yPos;
-    int32_t zPos;
-    uint16_t intensity;
-    int8_t flags;
-    uint8_t classificaton;
-    int8_t scanAngle;
-    uint8_t userData;
-    uint16_t pointSourceID;
-    uint16_t red;
-    uint16_t green;
-    uint16_t blue;
+// Layout of point record formats 0-10. Every format starts with x, y, z as int32. Offsets of fields a format
+// does not have are 0.
+struct lasPointFormat {
+    uint16_t size;
+    uint16_t gpsTimeOffset;
+    uint16_t rgbOffset;
+    uint16_t nirOffset;
+    uint16_t wavePacketOffset;
 };
 
-
+inline constexpr std::array<lasPointFormat, 11> lasPointFormats{ {
+    { 20, 0, 0, 0, 0 },         // 0
+    { 28, 20, 0, 0, 0 },        // 1 gps time
+    { 26, 0, 20, 0, 0 },        // 2 rgb
+    { 34, 20, 28, 0, 0 },       // 3 gps time, rgb
+    { 57, 20, 0, 0, 28 },       // 4 gps time, wave packet
+    { 63, 20, 28, 0, 34 },      // 5 gps time, rgb, wave packet
+    { 30, 22, 0, 0, 0 },        // 6 extended, gps time
+    { 36, 22, 30, 0, 0 },       // 7 extended, gps time, rgb
+    { 38, 22, 30, 36, 0 },      // 8 extended, gps time, rgb, nir
+    { 59, 22, 0, 0, 30 },       // 9 extended, gps time, wave packet
+    { 67, 22, 30, 36, 38 },     // 10 extended, gps time, rgb, nir, wave packet
+} };
@@ -0,0 +1,126 @@
+#include "MappedFile.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define NOGDI
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace FLOOF {
+    MappedFile::MappedFile(const std::string& path) {
+        Open(path);
+    }
+
+    MappedFile::~MappedFile() {
+        Close();
+    }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept {
+        Swap(other);
+    }
+
+    MappedFile& MappedFile::operator = (MappedFile&& other) noexcept {
+        if (this != &other) {
+            Close();
+            Swap(other);
+        }
+        return *this;
+    }
+
+    bool MappedFile::Open(const std::string& path) {
+        Close();
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER size{};
+        if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+            CloseHandle(file);
+            return false;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            CloseHandle(file);
+            return false;
+        }
+
+        void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!data) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return false;
+        }
+
+        m_File = file;
+        m_Mapping = mapping;
+        m_Data = static_cast<const uint8_t*>(data);
+        m_Size = static_cast<size_t>(size.QuadPart);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat info {};
+        if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+            ::close(fd);
+            return false;
+        }
+
+        const size_t size = static_cast<size_t>(info.st_size);
+        void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+        // Loaders walk the file front to back, let the kernel read ahead aggressively.
+        ::madvise(data, size, MADV_SEQUENTIAL);
+
+        m_FileDescriptor = fd;
+        m_Data = static_cast<const uint8_t*>(data);
+        m_Size = size;
+#endif
+        return true;
+    }
+
+    void MappedFile::Close() {
+#ifdef _WIN32
+        if (m_Data)
+            UnmapViewOfFile(m_Data);
+        if (m_Mapping)
+            CloseHandle(m_Mapping);
+        if (m_File)
+            CloseHandle(m_File);
+        m_File = nullptr;
+        m_Mapping = nullptr;
+#else
+        if (m_Data)
+            ::munmap(const_cast<uint8_t*>(m_Data), m_Size);
+        if (m_FileDescriptor >= 0)
+            ::close(m_FileDescriptor);
+        m_FileDescriptor = -1;
+#endif
+        m_Data = nullptr;
+        m_Size = 0;
+    }
+
+    void MappedFile::Swap(MappedFile& other) noexcept {
+        std::swap(m_Data, other.m_Data);
+        std::swap(m_Size, other.m_Size);
+#ifdef _WIN32
+        std::swap(m_File, other.m_File);
+        std::swap(m_Mapping, other.m_Mapping);
+#else
+        std::swap(m_FileDescriptor, other.m_FileDescriptor);
+#endif
+    }
+}
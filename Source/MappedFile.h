@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+namespace FLOOF {
+    // Read-only memory map of a whole file. The bytes stay valid until the map is closed or destroyed.
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        explicit MappedFile(const std::string& path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator = (const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator = (MappedFile&& other) noexcept;
+
+        // Returns false if the file is missing, empty or can not be mapped.
+        bool Open(const std::string& path);
+        void Close();
+
+        bool IsOpen() const { return m_Data != nullptr; }
+        const uint8_t* GetData() const { return m_Data; }
+        size_t GetSize() const { return m_Size; }
+        std::span<const uint8_t> GetBytes() const { return { m_Data, m_Size }; }
+    private:
+        void Swap(MappedFile& other) noexcept;
+
+        const uint8_t* m_Data{ nullptr };
+        size_t m_Size{ 0 };
+#ifdef _WIN32
+        void* m_File{ nullptr };
+        void* m_Mapping{ nullptr };
+#else
+        int m_FileDescriptor{ -1 };
+#endif
+    };
+}
@@ -4,7 +4,6 @@
 #include "glm/glm.hpp"
 #include "glm/gtx/transform.hpp"
 #include "glm/gtx/quaternion.hpp"
-#include <random>
 
 namespace FLOOF {
     namespace Math {
@@ -13,25 +12,11 @@ namespace FLOOF {
 
         static size_t Cantor(size_t a, size_t b) { return (a + b + 1) * (a + b) / 2 + b; }
 
-
-        static std::random_device RandomDevice;
-        static std::mt19937_64 Generator(RandomDevice());
-
-        static double RandDouble(const double min, const double max) {
-            std::uniform_real_distribution<>dist(min, max);
-            return dist(Generator);
-        }
-        static float RandFloat(const float min, const float max) {
-            std::uniform_real_distribution<>dist(min, max);
-            return static_cast<float>(dist(Generator));
+        static float DistanceToSegment(const glm::vec3& point, const glm::vec3& a, const glm::vec3& b) {
+            glm::vec3 ab = b - a;
+            float lengthSquared = glm::dot(ab, ab);
+            float t = lengthSquared > 0.f ? glm::clamp(glm::dot(point - a, ab) / lengthSquared, 0.f, 1.f) : 0.f;
+            return glm::length(point - (a + ab * t));
         }
-        static int RandInt(const int min, const int max) {
-            std::uniform_int_distribution<> dist(min, max);
-            return dist(Generator);
-        }
-
-        static glm::vec3 GetSafeNormal() {
-            return glm::normalize(glm::vec3(RandFloat(0.1f, 1.f), RandFloat(0.1f, 1.f), RandFloat(0.1f, 1.f)));
-        };
     }
 }
@@ -1,5 +1,6 @@
 #include "Octree.h"
 #include "Physics.h"
+#include "Profiler.h"
 
 namespace FLOOF {
     Octree::Octree(const AABB& aabb)
@@ -72,6 +73,7 @@ namespace FLOOF {
         if (IsLeaf()) {
             for (int i = 0; i < (int)m_CollisionObjects.size() - 1; i++) {
                 for (int j = i + 1; j < m_CollisionObjects.size(); j++) {
+                    Profiler::Count(ProfileCounter::PairsTested);
                     // Continue if not intersecting.
                     if (!m_CollisionObjects[i]->Shape->Intersect(m_CollisionObjects[j]->Shape)) {
                         continue;
@@ -79,7 +81,7 @@ namespace FLOOF {
 
                     // Look for j in i. i should then also be in j so dont need to check.
                     auto it = std::find(m_CollisionObjects[i]->OverlappingShapes.begin(),
-                        m_CollisionObjects[i]->OverlappingShapes.end(), m_CollisionObjects[i]->Shape);
+                        m_CollisionObjects[i]->OverlappingShapes.end(), m_CollisionObjects[j]->Shape);
 
                     // Continue if found.
                     if (it != m_CollisionObjects[i]->OverlappingShapes.end()) {
@@ -92,6 +94,7 @@ namespace FLOOF {
                     m_CollisionObjects[j]->OverlappingShapes.push_back(m_CollisionObjects[i]->Shape);
 
                     outVec.emplace_back(std::make_pair(m_CollisionObjects[i].get(), m_CollisionObjects[j].get()));
+                    Profiler::Count(ProfileCounter::PairsColliding);
                 }
             }
         }
@@ -146,6 +149,7 @@ namespace FLOOF {
         h.pos.z -= h.extent.z;
         h.pos.y += h.extent.y;
 
+        Profiler::Count(ProfileCounter::OctreeNodes, 8);
         m_ChildNodes.reserve(8);
         m_ChildNodes.emplace_back(std::make_unique<Octree>(a));
         m_ChildNodes.emplace_back(std::make_unique<Octree>(b));
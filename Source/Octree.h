@@ -1,14 +1,16 @@
 #pragma once
 
 #include <vector>
+#include <entt/entt.hpp>
 #include "Components.h"
 
 
 namespace FLOOF {
     struct CollisionObject {
-        CollisionObject(CollisionShape* shape, TransformComponent& transform, VelocityComponent& velocity, BallComponent& ball)
-            : Shape(shape), Transform(transform), Velocity(velocity), Ball(ball) {
+        CollisionObject(entt::entity entity, CollisionShape* shape, TransformComponent& transform, VelocityComponent& velocity, BallComponent& ball)
+            : Entity(entity), Shape(shape), Transform(transform), Velocity(velocity), Ball(ball) {
         }
+        entt::entity Entity;
         CollisionShape* Shape;
         TransformComponent& Transform;
         VelocityComponent& Velocity;
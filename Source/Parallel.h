@@ -0,0 +1,61 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace FLOOF {
+    // Minimal fork-join helper for loading and baking work. Threads are started per call, so keep it away from
+    // anything that runs every frame.
+    class Parallel {
+    public:
+        // Upper bound on workers, 0 means one per hardware thread.
+        static void SetWorkerCount(uint32_t workers) { s_WorkerCount.store(workers, std::memory_order_relaxed); }
+
+        static uint32_t GetWorkerCount() {
+            const uint32_t workers = s_WorkerCount.load(std::memory_order_relaxed);
+            if (workers != 0)
+                return workers;
+            return std::max(std::thread::hardware_concurrency(), 1u);
+        }
+
+        // Workers worth starting for count items when each should get at least minPerWorker.
+        static uint32_t GetWorkerCount(size_t count, size_t minPerWorker) {
+            const size_t useful = count / std::max<size_t>(minPerWorker, 1);
+            return static_cast<uint32_t>(std::clamp<size_t>(useful, 1, GetWorkerCount()));
+        }
+
+        // Calls func(begin, end, worker) for workers contiguous ranges covering [0, count). The calling thread
+        // runs worker 0. Ranges only depend on count and workers, never on timing.
+        template<typename Func>
+        static void For(size_t count, uint32_t workers, Func&& func) {
+            if (count == 0)
+                return;
+            workers = static_cast<uint32_t>(std::clamp<size_t>(workers, 1, count));
+            if (workers == 1) {
+                func(size_t{ 0 }, count, 0u);
+                return;
+            }
+
+            const size_t perWorker = (count + workers - 1) / workers;
+            std::vector<std::thread> threads;
+            threads.reserve(workers - 1);
+            for (uint32_t worker = 1; worker < workers; worker++) {
+                const size_t begin = std::min(count, worker * perWorker);
+                const size_t end = std::min(count, begin + perWorker);
+                threads.emplace_back([&func, begin, end, worker]() {
+                    func(begin, end, worker);
+                });
+            }
+            func(size_t{ 0 }, std::min(count, perWorker), 0u);
+
+            for (auto& thread : threads)
+                thread.join();
+        }
+    private:
+        inline static std::atomic<uint32_t> s_WorkerCount{ 0 };
+    };
+}
@@ -5,6 +5,7 @@
 #include "Octree.h"
 #include "LoggerMacros.h"
 #include "Components.h"
+#include "Random.h"
 
 
 namespace FLOOF {
@@ -31,11 +32,13 @@ namespace FLOOF {
         v2 += normal;
     }
 
-    glm::vec3 Physics::GetContactNormal(const glm::vec3& pos1, const glm::vec3& pos2) {
-        glm::vec3 contactNormal{ Math::GetSafeNormal() };
+    glm::vec3 Physics::GetContactNormal(const glm::vec3& pos1, const glm::vec3& pos2, uint32_t worker) {
         if (glm::length(pos1 - pos2) != 0)
-            contactNormal = glm::normalize(pos2 - pos1);
-        return contactNormal;
+            return glm::normalize(pos2 - pos1);
+
+        // Coincident centers, any direction will do.
+        auto& random = Random::Get(worker);
+        return glm::normalize(glm::vec3(random.Float(0.1f, 1.f), random.Float(0.1f, 1.f), random.Float(0.1f, 1.f)));
     }
 
     /*
@@ -11,7 +11,7 @@ namespace FLOOF {
     class OBB;
     class Triangle;
     class Frustum;
-    class CameraComponent;
+    struct CameraComponent;
 
     class Physics {
     public:
@@ -24,7 +24,8 @@ namespace FLOOF {
         static void ElasticCollision(glm::vec3 p1, glm::vec3 p2, glm::vec3& v1, glm::vec3& v2);
 
 
-        static glm::vec3 GetContactNormal(const  glm::vec3& pos1, const glm::vec3& pos2);
+        // Coincident positions get a random direction from worker's stream.
+        static glm::vec3 GetContactNormal(const  glm::vec3& pos1, const glm::vec3& pos2, uint32_t worker = 0);
     };
 
     class CollisionShape {
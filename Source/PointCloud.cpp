@@ -0,0 +1,168 @@
+#include "PointCloud.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "Parallel.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FLOOF_POINTCLOUD_PREFETCH
+#include <xmmintrin.h>
+#endif
+
+namespace FLOOF {
+    namespace PointCloud {
+        namespace {
+            constexpr size_t s_MinPointsPerWorker = 1 << 16;
+            // Points are split by the hash of their voxel into this many buckets, so every voxel ends up in one
+            // bucket and buckets are decimated on their own.
+            constexpr uint32_t s_BucketBits = 8;
+            constexpr uint32_t s_Buckets = 1u << s_BucketBits;
+            constexpr uint32_t s_Empty = UINT32_MAX;
+            // Buckets read their points out of order, this many points ahead are requested early.
+            constexpr size_t s_PrefetchDistance = 32;
+
+            void Prefetch(const void* address) {
+#ifdef FLOOF_POINTCLOUD_PREFETCH
+                _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#endif
+            }
+
+            struct Voxel {
+                int32_t X;
+                int32_t Y;
+                int32_t Z;
+
+                bool operator == (const Voxel& other) const { return X == other.X && Y == other.Y && Z == other.Z; }
+            };
+
+            // Point position in voxels. Far outside the int range the voxels clamp instead of overflowing.
+            glm::vec3 ToVoxelSpace(const glm::vec3& pos, float inverseSize) {
+                return glm::clamp(pos * inverseSize, glm::vec3(-2e9f), glm::vec3(2e9f));
+            }
+
+            Voxel GetVoxel(const glm::vec3& voxelPos) {
+                return { static_cast<int32_t>(std::floor(voxelPos.x)), static_cast<int32_t>(std::floor(voxelPos.y)), static_cast<int32_t>(std::floor(voxelPos.z)) };
+            }
+
+            uint64_t Hash(const Voxel& voxel) {
+                uint64_t hash = static_cast<uint32_t>(voxel.X) * 0x9E3779B97F4A7C15ull;
+                hash ^= static_cast<uint32_t>(voxel.Y) * 0xC2B2AE3D27D4EB4Full;
+                hash ^= static_cast<uint32_t>(voxel.Z) * 0x165667B19E3779F9ull;
+                return hash ^ (hash >> 29);
+            }
+
+            uint32_t GetBucket(uint64_t hash) {
+                return static_cast<uint32_t>(hash >> (64 - s_BucketBits));
+            }
+
+            // Sums of the points in one voxel. Positions are summed relative to the voxel corner, so they keep
+            // their precision far from the origin.
+            struct VoxelSum {
+                Voxel Key;
+                glm::vec3 Offset{ 0.f };
+                glm::vec3 Color{ 0.f };
+                uint32_t Count{ 0 };
+            };
+
+            // Open addressing table from voxel to its sum, reused for every bucket a worker takes.
+            struct VoxelTable {
+                std::vector<uint32_t> Slots;
+                std::vector<VoxelSum> Sums;
+
+                void Reset(size_t points) {
+                    size_t size = 16;
+                    while (size < points * 2)
+                        size *= 2;
+                    Slots.assign(size, s_Empty);
+                    Sums.clear();
+                    Sums.reserve(points);
+                }
+
+                VoxelSum& Find(const Voxel& voxel, uint64_t hash) {
+                    const size_t mask = Slots.size() - 1;
+                    for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+                        if (Slots[slot] == s_Empty) {
+                            Slots[slot] = static_cast<uint32_t>(Sums.size());
+                            return Sums.emplace_back(VoxelSum{ voxel });
+                        }
+                        if (Sums[Slots[slot]].Key == voxel)
+                            return Sums[Slots[slot]];
+                    }
+                }
+            };
+        }
+
+        std::vector<ColorVertex> Decimate(std::span<const ColorVertex> points, float voxelSize) {
+            if (!(voxelSize > 0.f) || points.empty())
+                return std::vector<ColorVertex>(points.begin(), points.end());
+
+            const float inverseSize = 1.f / voxelSize;
+            const uint32_t workers = Parallel::GetWorkerCount(points.size(), s_MinPointsPerWorker);
+
+            // Count the points of every bucket per worker, then give every worker its own range in each bucket.
+            // The ranges follow worker order, so every bucket lists its points in their original order.
+            std::vector<size_t> offsets(static_cast<size_t>(workers) * s_Buckets);
+            Parallel::For(points.size(), workers, [&](size_t begin, size_t end, uint32_t worker) {
+                size_t* counts = offsets.data() + static_cast<size_t>(worker) * s_Buckets;
+                for (size_t i = begin; i < end; i++)
+                    counts[GetBucket(Hash(GetVoxel(ToVoxelSpace(points[i].Pos, inverseSize))))]++;
+            });
+            std::vector<size_t> bucketStarts(s_Buckets + 1);
+            size_t total{ 0 };
+            for (uint32_t bucket = 0; bucket < s_Buckets; bucket++) {
+                bucketStarts[bucket] = total;
+                for (uint32_t worker = 0; worker < workers; worker++) {
+                    const size_t count = offsets[static_cast<size_t>(worker) * s_Buckets + bucket];
+                    offsets[static_cast<size_t>(worker) * s_Buckets + bucket] = total;
+                    total += count;
+                }
+            }
+            bucketStarts[s_Buckets] = total;
+
+            std::vector<uint32_t> order(points.size());
+            Parallel::For(points.size(), workers, [&](size_t begin, size_t end, uint32_t worker) {
+                size_t* next = offsets.data() + static_cast<size_t>(worker) * s_Buckets;
+                for (size_t i = begin; i < end; i++)
+                    order[next[GetBucket(Hash(GetVoxel(ToVoxelSpace(points[i].Pos, inverseSize))))]++] = static_cast<uint32_t>(i);
+            });
+
+            std::vector<std::vector<ColorVertex>> decimated(s_Buckets);
+            Parallel::For(s_Buckets, Parallel::GetWorkerCount(), [&](size_t begin, size_t end, uint32_t) {
+                VoxelTable table;
+                for (size_t bucket = begin; bucket < end; bucket++) {
+                    table.Reset(bucketStarts[bucket + 1] - bucketStarts[bucket]);
+                    for (size_t i = bucketStarts[bucket]; i < bucketStarts[bucket + 1]; i++) {
+                        if (i + s_PrefetchDistance < bucketStarts[bucket + 1])
+                            Prefetch(&points[order[i + s_PrefetchDistance]]);
+                        const auto& point = points[order[i]];
+                        const glm::vec3 voxelPos = ToVoxelSpace(point.Pos, inverseSize);
+                        const Voxel voxel = GetVoxel(voxelPos);
+                        auto& sum = table.Find(voxel, Hash(voxel));
+                        sum.Offset += voxelPos - glm::vec3(voxel.X, voxel.Y, voxel.Z);
+                        sum.Color += point.Color;
+                        sum.Count++;
+                    }
+
+                    auto& out = decimated[bucket];
+                    out.reserve(table.Sums.size());
+                    for (const auto& sum : table.Sums) {
+                        const float inverseCount = 1.f / static_cast<float>(sum.Count);
+                        const glm::vec3 corner(sum.Key.X, sum.Key.Y, sum.Key.Z);
+                        out.push_back({ (corner + sum.Offset * inverseCount) * voxelSize, sum.Color * inverseCount });
+                    }
+                }
+            });
+
+            std::vector<size_t> outStarts(s_Buckets + 1, 0);
+            for (uint32_t bucket = 0; bucket < s_Buckets; bucket++)
+                outStarts[bucket + 1] = outStarts[bucket] + decimated[bucket].size();
+            std::vector<ColorVertex> out(outStarts.back());
+            Parallel::For(s_Buckets, Parallel::GetWorkerCount(), [&](size_t begin, size_t end, uint32_t) {
+                for (size_t bucket = begin; bucket < end; bucket++)
+                    std::copy(decimated[bucket].begin(), decimated[bucket].end(), out.begin() + outStarts[bucket]);
+            });
+            return out;
+        }
+    }
+}
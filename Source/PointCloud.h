@@ -0,0 +1,15 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include "Vertex.h"
+
+namespace FLOOF {
+    namespace PointCloud {
+        // Voxel grid decimation for drawing. Points are grouped into cubes of voxelSize and every occupied cube
+        // becomes one point at the mean position and color of its points. Hash based and parallel, the result
+        // is the same on any number of threads. voxelSize <= 0 copies the points as they are. Points are indexed
+        // with 32 bits, so at most 4G of them.
+        std::vector<ColorVertex> Decimate(std::span<const ColorVertex> points, float voxelSize);
+    }
+}
@@ -0,0 +1,210 @@
+#include "PointOctree.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include "Parallel.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FLOOF_POINTOCTREE_PREFETCH
+#include <xmmintrin.h>
+#endif
+
+namespace FLOOF {
+    namespace {
+        constexpr size_t s_MinPointsPerWorker = 1 << 16;
+        // Nodes read their points by index, this many points ahead are requested early.
+        constexpr size_t s_PrefetchDistance = 16;
+        constexpr uint32_t s_CellBits = 21;
+        constexpr uint32_t s_CellMask = (1u << s_CellBits) - 1;
+        static_assert(PointOctree::GridSize * PointOctree::GridSize * PointOctree::GridSize <= (1u << s_CellBits),
+            "PointOctree cells must fit in s_CellBits");
+
+        void Prefetch(const void* address) {
+#ifdef FLOOF_POINTOCTREE_PREFETCH
+            _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#endif
+        }
+
+        // Cell of the node's grid in the low bits, octant of the child the point falls into above them.
+        uint32_t Encode(const glm::vec3& pos, const PointOctree::Node& node) {
+            const glm::vec3 local = (pos - node.Min) * (static_cast<float>(PointOctree::GridSize) / node.Size);
+            const glm::uvec3 cell = glm::clamp(glm::ivec3(glm::floor(local)), glm::ivec3(0), glm::ivec3(PointOctree::GridSize - 1));
+            const glm::uvec3 octant = cell / (PointOctree::GridSize / 2);
+            const uint32_t index = (cell.z * PointOctree::GridSize + cell.y) * PointOctree::GridSize + cell.x;
+            return index | (octant.x | octant.y << 1 | octant.z << 2) << s_CellBits;
+        }
+
+        // Points of a node waiting for their level, by index into the input.
+        struct Pending {
+            uint32_t Node;
+            std::vector<uint32_t> Points;
+        };
+
+        // What a node keeps and what it hands down to each octant.
+        struct Split {
+            std::vector<uint32_t> Kept;
+            std::array<std::vector<uint32_t>, 8> Children;
+        };
+    }
+
+    PointOctree::PointOctree(std::span<const ColorVertex> points, uint32_t leafPoints) {
+        if (points.empty())
+            return;
+        leafPoints = std::max(leafPoints, 1u);
+
+        const uint32_t workers = Parallel::GetWorkerCount(points.size(), s_MinPointsPerWorker);
+        std::vector<glm::vec3> mins(workers, glm::vec3(std::numeric_limits<float>::max()));
+        std::vector<glm::vec3> maxs(workers, glm::vec3(std::numeric_limits<float>::lowest()));
+        Parallel::For(points.size(), workers, [&](size_t begin, size_t end, uint32_t worker) {
+            for (size_t i = begin; i < end; i++) {
+                mins[worker] = glm::min(mins[worker], points[i].Pos);
+                maxs[worker] = glm::max(maxs[worker], points[i].Pos);
+            }
+        });
+        glm::vec3 min = mins.front();
+        glm::vec3 max = maxs.front();
+        for (uint32_t worker = 1; worker < workers; worker++) {
+            min = glm::min(min, mins[worker]);
+            max = glm::max(max, maxs[worker]);
+        }
+        const glm::vec3 extent = max - min;
+        auto& root = m_Nodes.emplace_back();
+        root.Min = min;
+        root.Size = std::max({ extent.x, extent.y, extent.z, 1e-3f });
+
+        // Breadth first, one level at a time, so children end up next to each other and points are stored
+        // coarse to fine.
+        std::vector<Pending> level(1);
+        level.front().Points.resize(points.size());
+        std::iota(level.front().Points.begin(), level.front().Points.end(), 0u);
+
+        m_Points.reserve(points.size());
+        while (!level.empty()) {
+            // Nodes of a level are independent. With fewer nodes than workers the points of each node are
+            // encoded on all workers instead.
+            const uint32_t nodeWorkers = Parallel::GetWorkerCount(level.size(), 1);
+            std::vector<Split> splits(level.size());
+            Parallel::For(level.size(), nodeWorkers, [&](size_t begin, size_t end, uint32_t) {
+                std::vector<uint64_t> occupied(GridSize * GridSize * GridSize / 64);
+                std::vector<uint32_t> codes;
+                for (size_t i = begin; i < end; i++) {
+                    auto& pending = level[i];
+                    auto& split = splits[i];
+                    const Node& node = m_Nodes[pending.Node];
+                    const size_t count = pending.Points.size();
+                    if (count <= leafPoints || node.Depth + 1 >= MaxDepth) {
+                        split.Kept = std::move(pending.Points);
+                        continue;
+                    }
+
+                    codes.resize(count);
+                    const uint32_t pointWorkers = nodeWorkers == 1 ? Parallel::GetWorkerCount(count, s_MinPointsPerWorker) : 1;
+                    Parallel::For(count, pointWorkers, [&](size_t first, size_t last, uint32_t) {
+                        for (size_t j = first; j < last; j++) {
+                            if (j + s_PrefetchDistance < last)
+                                Prefetch(&points[pending.Points[j + s_PrefetchDistance]]);
+                            codes[j] = Encode(points[pending.Points[j]].Pos, node);
+                        }
+                    });
+
+                    for (size_t j = 0; j < count; j++) {
+                        const uint32_t cell = codes[j] & s_CellMask;
+                        uint64_t& word = occupied[cell / 64];
+                        const uint64_t bit = uint64_t{ 1 } << (cell % 64);
+                        if (word & bit) {
+                            split.Children[codes[j] >> s_CellBits].push_back(pending.Points[j]);
+                        } else {
+                            word |= bit;
+                            split.Kept.push_back(pending.Points[j]);
+                        }
+                    }
+                    // Only words this node set can be dirty.
+                    for (size_t j = 0; j < count; j++)
+                        occupied[(codes[j] & s_CellMask) / 64] = 0;
+                    pending.Points = {};
+                }
+            });
+
+            // Store the points and add the children in node order, so the result does not depend on the workers.
+            std::vector<Pending> next;
+            for (size_t i = 0; i < level.size(); i++) {
+                const uint32_t index = level[i].Node;
+                auto& split = splits[i];
+                m_Nodes[index].FirstPoint = static_cast<uint32_t>(m_Points.size());
+                m_Nodes[index].PointCount = static_cast<uint32_t>(split.Kept.size());
+                for (size_t j = 0; j < split.Kept.size(); j++) {
+                    if (j + s_PrefetchDistance < split.Kept.size())
+                        Prefetch(&points[split.Kept[j + s_PrefetchDistance]]);
+                    m_Points.push_back(points[split.Kept[j]]);
+                }
+                split.Kept = {};
+                m_Depth = std::max(m_Depth, m_Nodes[index].Depth + 1);
+
+                m_Nodes[index].FirstChild = static_cast<uint32_t>(m_Nodes.size());
+                const Node node = m_Nodes[index];
+                const float half = node.Size * 0.5f;
+                for (uint32_t octant = 0; octant < 8; octant++) {
+                    if (split.Children[octant].empty())
+                        continue;
+                    auto& child = m_Nodes.emplace_back();
+                    child.Min = node.Min + glm::vec3(octant & 1, (octant >> 1) & 1, (octant >> 2) & 1) * half;
+                    child.Size = half;
+                    child.Depth = node.Depth + 1;
+                    m_Nodes[index].ChildCount++;
+                    next.push_back({ static_cast<uint32_t>(m_Nodes.size() - 1), std::move(split.Children[octant]) });
+                }
+            }
+            level = std::move(next);
+        }
+    }
+
+    uint64_t PointOctree::Select(Frustum& frustum, const glm::vec3& eye, float pixelsPerUnit, float maxPixelSpacing, uint64_t pointBudget,
+        std::vector<uint32_t>& out) const {
+        out.clear();
+        if (m_Nodes.empty())
+            return 0;
+
+        AABB box;
+        auto isVisible = [&](const Node& node) {
+            box.extent = glm::vec3(node.Size * 0.5f);
+            box.pos = node.Min + box.extent;
+            return frustum.Intersect(&box);
+        };
+        auto getPixelSpacing = [&](const Node& node) {
+            const glm::vec3 closest = glm::clamp(eye, node.Min, node.Min + node.Size);
+            const float distance = std::max(glm::length(eye - closest), 0.001f);
+            return node.GetSpacing() * pixelsPerUnit / distance;
+        };
+
+        // Largest spacing on screen first.
+        using Candidate = std::pair<float, uint32_t>;
+        std::priority_queue<Candidate> queue;
+        if (isVisible(m_Nodes.front()))
+            queue.push({ getPixelSpacing(m_Nodes.front()), 0 });
+
+        uint64_t points{ 0 };
+        while (!queue.empty()) {
+            const auto [spacing, index] = queue.top();
+            queue.pop();
+            const auto& node = m_Nodes[index];
+            if (points + node.PointCount > pointBudget)
+                break;
+            out.push_back(index);
+            points += node.PointCount;
+            if (spacing <= maxPixelSpacing)
+                continue;
+            for (uint32_t child = node.FirstChild; child < node.FirstChild + node.ChildCount; child++) {
+                if (isVisible(m_Nodes[child]))
+                    queue.push({ getPixelSpacing(m_Nodes[child]), child });
+            }
+        }
+        return points;
+    }
+
+    size_t PointOctree::GetBytes() const {
+        return sizeof(PointOctree) + m_Nodes.capacity() * sizeof(Node) + m_Points.capacity() * sizeof(ColorVertex);
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "Physics.h"
+#include "Vertex.h"
+
+namespace FLOOF {
+    // Potree style level of detail for large point clouds. Every node is a cube that keeps at most one point per
+    // cell of a GridSize^3 grid over it and hands the rest down to its eight octants, so every level doubles the
+    // density of the one above. Nodes with few enough points left keep all of them and end the branch. Every
+    // point is in exactly one node, and the points of a node are contiguous, so a node can be uploaded and drawn
+    // on its own.
+    class PointOctree {
+    public:
+        inline static constexpr uint32_t GridSize = 128;
+        inline static constexpr uint32_t DefaultLeafPoints = 16384;
+        inline static constexpr uint32_t MaxDepth = 20;
+
+        struct Node {
+            glm::vec3 Min{ 0.f };
+            float Size{ 0.f };
+            uint32_t FirstPoint{ 0 };
+            uint32_t PointCount{ 0 };
+            // Children are stored next to each other, only octants with points get one.
+            uint32_t FirstChild{ 0 };
+            uint32_t ChildCount{ 0 };
+            uint32_t Depth{ 0 };
+
+            // Distance between the points a node keeps, the leaves keep everything that is left.
+            float GetSpacing() const { return Size / static_cast<float>(GridSize); }
+        };
+
+        PointOctree() = default;
+        // Points are copied and reordered by node. Each level is built in parallel, over its nodes or over the
+        // points of its few nodes. Every node keeps the first point of each cell in input order, so the tree is
+        // the same on any number of threads.
+        PointOctree(std::span<const ColorVertex> points, uint32_t leafPoints = DefaultLeafPoints);
+
+        // Adds visible nodes with the coarsest first, ordered by the size of their point spacing on screen, and
+        // opens a node's children while that spacing is above maxPixelSpacing. Stops before the points of the
+        // selected nodes would exceed pointBudget. A node is only selected together with its parent. pixelsPerUnit
+        // is the viewport height over 2 tan(fov / 2). Returns the selected points.
+        uint64_t Select(Frustum& frustum, const glm::vec3& eye, float pixelsPerUnit, float maxPixelSpacing, uint64_t pointBudget,
+            std::vector<uint32_t>& out) const;
+
+        const std::vector<Node>& GetNodes() const { return m_Nodes; }
+        const std::vector<ColorVertex>& GetPoints() const { return m_Points; }
+        std::span<const ColorVertex> GetPoints(const Node& node) const { return std::span(m_Points).subspan(node.FirstPoint, node.PointCount); }
+        uint32_t GetDepth() const { return m_Depth; }
+        size_t GetBytes() const;
+    private:
+        std::vector<Node> m_Nodes;
+        std::vector<ColorVertex> m_Points;
+        uint32_t m_Depth{ 0 };
+    };
+}
@@ -0,0 +1,84 @@
+#include "Profiler.h"
+
+#include <fstream>
+
+namespace FLOOF {
+    void Profiler::BeginFrame() {
+        s_Times.fill(0.0);
+        s_Counters.fill(0);
+        s_FrameAllocations = s_Allocations.load(std::memory_order_relaxed);
+        s_FrameAllocatedBytes = s_AllocatedBytes.load(std::memory_order_relaxed);
+    }
+
+    void Profiler::EndFrame() {
+        if (!s_Enabled)
+            return;
+
+        s_Counters[static_cast<size_t>(ProfileCounter::Allocations)] = s_Allocations.load(std::memory_order_relaxed) - s_FrameAllocations;
+        s_Counters[static_cast<size_t>(ProfileCounter::AllocatedBytes)] = s_AllocatedBytes.load(std::memory_order_relaxed) - s_FrameAllocatedBytes;
+
+        s_LastTimes = s_Times;
+        s_LastCounters = s_Counters;
+
+        for (size_t i = 0; i < StageCount; i++)
+            s_TimeHistory[i][s_HistoryIndex] = static_cast<float>(s_Times[i] * 1000.0);
+        for (size_t i = 0; i < CounterCount; i++)
+            s_CounterHistory[i][s_HistoryIndex] = static_cast<float>(s_Counters[i]);
+
+        s_HistoryIndex = (s_HistoryIndex + 1) % HistorySize;
+        s_Frame++;
+    }
+
+    const char* Profiler::GetName(ProfileStage stage) {
+        switch (stage) {
+        case ProfileStage::Physics: return "Physics";
+        case ProfileStage::OctreeBuild: return "Octree Build";
+        case ProfileStage::PairGeneration: return "Pair Generation";
+        case ProfileStage::BallBallResponse: return "Ball-Ball Response";
+        case ProfileStage::BallUpdate: return "Ball Update";
+        case ProfileStage::TerrainQuery: return "Terrain Query";
+        case ProfileStage::BSplineUpdate: return "BSpline Update";
+        case ProfileStage::EventDispatch: return "Event Dispatch";
+        default: return "Unknown";
+        }
+    }
+
+    const char* Profiler::GetName(ProfileCounter counter) {
+        switch (counter) {
+        case ProfileCounter::BallsSimulated: return "Balls Simulated";
+        case ProfileCounter::OctreeNodes: return "Octree Nodes";
+        case ProfileCounter::PairsTested: return "Pairs Tested";
+        case ProfileCounter::PairsColliding: return "Pairs Colliding";
+        case ProfileCounter::TrianglesTested: return "Triangles Tested";
+        case ProfileCounter::TerrainCollisions: return "Terrain Collisions";
+        case ProfileCounter::Allocations: return "Allocations";
+        case ProfileCounter::AllocatedBytes: return "Allocated Bytes";
+        default: return "Unknown";
+        }
+    }
+
+    bool Profiler::DumpCsv(const std::string& path) {
+        std::ofstream file(path);
+        if (!file)
+            return false;
+
+        file << "Frame";
+        for (size_t i = 0; i < StageCount; i++)
+            file << "," << GetName(static_cast<ProfileStage>(i)) << " (ms)";
+        for (size_t i = 0; i < CounterCount; i++)
+            file << "," << GetName(static_cast<ProfileCounter>(i));
+        file << "\n";
+
+        const size_t frames = s_Frame < HistorySize ? static_cast<size_t>(s_Frame) : HistorySize;
+        for (size_t row = 0; row < frames; row++) {
+            const size_t index = (s_HistoryIndex + HistorySize - frames + row) % HistorySize;
+            file << (s_Frame - frames + row);
+            for (size_t i = 0; i < StageCount; i++)
+                file << "," << s_TimeHistory[i][index];
+            for (size_t i = 0; i < CounterCount; i++)
+                file << "," << static_cast<uint64_t>(s_CounterHistory[i][index]);
+            file << "\n";
+        }
+        return true;
+    }
+}
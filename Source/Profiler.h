@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace FLOOF {
+    enum class ProfileStage : uint8_t {
+        Physics = 0,
+        OctreeBuild,
+        PairGeneration,
+        BallBallResponse,
+        BallUpdate,
+        TerrainQuery,
+        BSplineUpdate,
+        EventDispatch,
+        Count
+    };
+
+    enum class ProfileCounter : uint8_t {
+        BallsSimulated = 0,
+        OctreeNodes,
+        PairsTested,
+        PairsColliding,
+        TrianglesTested,
+        TerrainCollisions,
+        Allocations,
+        AllocatedBytes,
+        Count
+    };
+
+    // Per-frame physics timings and counters with a rolling history. Everything is static so Octree and
+    // Simulate can report without a handle. Not thread safe apart from the allocation counters.
+    class Profiler {
+    public:
+        inline static constexpr size_t StageCount = static_cast<size_t>(ProfileStage::Count);
+        inline static constexpr size_t CounterCount = static_cast<size_t>(ProfileCounter::Count);
+        inline static constexpr size_t HistorySize = 240;
+
+        static void BeginFrame();
+        // Moves the frame's values into the history.
+        static void EndFrame();
+
+        static void AddTime(ProfileStage stage, double seconds) {
+            if (s_Enabled)
+                s_Times[static_cast<size_t>(stage)] += seconds;
+        }
+        static void Count(ProfileCounter counter, uint64_t amount = 1) {
+            if (s_Enabled)
+                s_Counters[static_cast<size_t>(counter)] += amount;
+        }
+
+        // Last completed frame.
+        static double GetTime(ProfileStage stage) { return s_LastTimes[static_cast<size_t>(stage)]; }
+        static uint64_t GetCounter(ProfileCounter counter) { return s_LastCounters[static_cast<size_t>(counter)]; }
+
+        // Oldest first, ready for ImGui::PlotLines with GetHistoryOffset.
+        static const float* GetHistory(ProfileStage stage) { return s_TimeHistory[static_cast<size_t>(stage)].data(); }
+        static const float* GetHistory(ProfileCounter counter) { return s_CounterHistory[static_cast<size_t>(counter)].data(); }
+        static int GetHistoryOffset() { return static_cast<int>(s_HistoryIndex); }
+
+        static const char* GetName(ProfileStage stage);
+        static const char* GetName(ProfileCounter counter);
+
+        // Writes the history as one row per frame, stage times in ms followed by counters.
+        static bool DumpCsv(const std::string& path);
+
+        // Feeds the Allocations and AllocatedBytes counters from any thread. FloofCore does not hook allocations,
+        // programs that show the counters link AllocationCounter.cpp, which reports every operator new here.
+        static void RecordAllocation(size_t bytes) {
+            s_Allocations.fetch_add(1, std::memory_order_relaxed);
+            s_AllocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+        }
+
+        static bool IsEnabled() { return s_Enabled; }
+        static void SetEnabled(bool enabled) { s_Enabled = enabled; }
+    private:
+        inline static bool s_Enabled = true;
+
+        inline static std::array<double, StageCount> s_Times{};
+        inline static std::array<uint64_t, CounterCount> s_Counters{};
+        inline static std::array<double, StageCount> s_LastTimes{};
+        inline static std::array<uint64_t, CounterCount> s_LastCounters{};
+
+        inline static std::array<std::array<float, HistorySize>, StageCount> s_TimeHistory{};
+        inline static std::array<std::array<float, HistorySize>, CounterCount> s_CounterHistory{};
+        inline static size_t s_HistoryIndex = 0;
+        inline static uint64_t s_Frame = 0;
+
+        inline static std::atomic<uint64_t> s_Allocations{ 0 };
+        inline static std::atomic<uint64_t> s_AllocatedBytes{ 0 };
+        inline static uint64_t s_FrameAllocations = 0;
+        inline static uint64_t s_FrameAllocatedBytes = 0;
+    };
+
+    // Adds the time spent in the scope to a stage.
+    class ProfileScope {
+    public:
+        explicit ProfileScope(ProfileStage stage)
+            : m_Stage{ stage }
+            , m_Start{ Profiler::IsEnabled() ? std::chrono::high_resolution_clock::now() : std::chrono::high_resolution_clock::time_point{} } {
+        }
+        ~ProfileScope() {
+            if (Profiler::IsEnabled())
+                Profiler::AddTime(m_Stage, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - m_Start).count());
+        }
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator = (const ProfileScope&) = delete;
+    private:
+        ProfileStage m_Stage;
+        std::chrono::high_resolution_clock::time_point m_Start;
+    };
+}
@@ -0,0 +1,109 @@
+#include "Quantize.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace FLOOF {
+    namespace Quantize {
+        namespace {
+            // Octahedron coordinates map [-1, 1] onto 0..254, so 0 and both ends are exact.
+            constexpr float s_NormalScale = 127.f;
+            constexpr int32_t s_NormalMax = 254;
+
+            float SignNotZero(float value) {
+                return value >= 0.f ? 1.f : -1.f;
+            }
+
+            glm::vec3 DecodeNormal(int32_t x, int32_t z) {
+                const float ex = static_cast<float>(x - 127) / s_NormalScale;
+                const float ez = static_cast<float>(z - 127) / s_NormalScale;
+                glm::vec3 normal(ex, 1.f - std::abs(ex) - std::abs(ez), ez);
+                if (normal.y < 0.f) {
+                    normal.x = (1.f - std::abs(ez)) * SignNotZero(ex);
+                    normal.z = (1.f - std::abs(ex)) * SignNotZero(ez);
+                }
+                return glm::normalize(normal);
+            }
+        }
+
+        Box::Box(const glm::vec3& min, const glm::vec3& max) : Min{ min } {
+            const glm::vec3 extent = glm::max(max - min, glm::vec3(0.f));
+            Step = extent / static_cast<float>(PositionSteps);
+            for (int axis = 0; axis < 3; axis++)
+                InverseStep[axis] = Step[axis] > 0.f ? 1.f / Step[axis] : 0.f;
+        }
+
+        glm::u16vec3 Box::Encode(const glm::vec3& pos) const {
+            const glm::vec3 steps = glm::round((pos - Min) * InverseStep);
+            return glm::u16vec3(glm::clamp(steps, glm::vec3(0.f), glm::vec3(static_cast<float>(PositionSteps))));
+        }
+
+        uint16_t EncodeNormal(const glm::vec3& normal) {
+            const float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+            if (!(length > 0.f))
+                return 127 | 127 << 8;
+
+            const glm::vec3 n = normal / length;
+            float ex = n.x;
+            float ez = n.z;
+            if (n.y < 0.f) {
+                ex = (1.f - std::abs(n.z)) * SignNotZero(n.x);
+                ez = (1.f - std::abs(n.x)) * SignNotZero(n.z);
+            }
+
+            // Rounding each axis on its own is not always the closest code after the fold and normalize.
+            const int32_t x0 = std::clamp(static_cast<int32_t>(std::floor(ex * s_NormalScale + 127.f)), 0, s_NormalMax);
+            const int32_t z0 = std::clamp(static_cast<int32_t>(std::floor(ez * s_NormalScale + 127.f)), 0, s_NormalMax);
+            const glm::vec3 unit = glm::normalize(normal);
+            int32_t bestX = x0;
+            int32_t bestZ = z0;
+            float best = -2.f;
+            for (int32_t z = z0; z <= std::min(z0 + 1, s_NormalMax); z++) {
+                for (int32_t x = x0; x <= std::min(x0 + 1, s_NormalMax); x++) {
+                    const float cosine = glm::dot(DecodeNormal(x, z), unit);
+                    if (cosine > best) {
+                        best = cosine;
+                        bestX = x;
+                        bestZ = z;
+                    }
+                }
+            }
+            return static_cast<uint16_t>(bestX | bestZ << 8);
+        }
+
+        glm::vec3 DecodeNormal(uint16_t normal) {
+            return DecodeNormal(normal & 0xFF, normal >> 8);
+        }
+
+        glm::u8vec4 EncodeColor(const glm::vec3& color) {
+            return glm::u8vec4(glm::round(glm::clamp(color, glm::vec3(0.f), glm::vec3(1.f)) * 255.f), 255);
+        }
+
+        glm::vec3 DecodeColor(const glm::u8vec4& color) {
+            return glm::vec3(color) / 255.f;
+        }
+
+        QuantizedColorVertex Encode(const ColorVertex& vertex, const Box& box) {
+            return { glm::u16vec4(box.Encode(vertex.Pos), 0), EncodeColor(vertex.Color) };
+        }
+
+        QuantizedColorNormalVertex Encode(const ColorNormalVertex& vertex, const Box& box) {
+            return { glm::u16vec4(box.Encode(vertex.Pos), EncodeNormal(vertex.Normal)), EncodeColor(vertex.Color) };
+        }
+
+        ColorVertex Decode(const QuantizedColorVertex& vertex, const Box& box) {
+            return { box.Decode(glm::u16vec3(vertex.Pos)), DecodeColor(vertex.Color) };
+        }
+
+        ColorNormalVertex Decode(const QuantizedColorNormalVertex& vertex, const Box& box) {
+            return { box.Decode(glm::u16vec3(vertex.PosNormal)), DecodeColor(vertex.Color), DecodeNormal(vertex.PosNormal.w) };
+        }
+
+        std::vector<QuantizedColorVertex> Encode(std::span<const ColorVertex> vertices, const Box& box) {
+            std::vector<QuantizedColorVertex> out(vertices.size());
+            for (size_t i = 0; i < vertices.size(); i++)
+                out[i] = Encode(vertices[i], box);
+            return out;
+        }
+    }
+}
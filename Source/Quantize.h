@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "Vertex.h"
+
+namespace FLOOF {
+    // CPU side of the quantized vertices in Vertex.h. The shaders decode the same way, see QuantizedColor.vert and
+    // QuantizedLitColor.vert.
+    namespace Quantize {
+        inline constexpr uint32_t PositionSteps = 65535;
+
+        // 16-bit grid over an axis aligned box, a position is stored as its step along every axis. Encoding is off
+        // by at most half a step, a zero extent axis decodes to Min.
+        struct Box {
+            Box() = default;
+            Box(const glm::vec3& min, const glm::vec3& max);
+
+            glm::u16vec3 Encode(const glm::vec3& pos) const;
+            glm::vec3 Decode(const glm::u16vec3& pos) const { return Min + glm::vec3(pos) * Step; }
+            // Takes steps to positions in the box, goes between the model matrix and the vertices.
+            glm::mat4 GetMatrix() const { return glm::translate(Min) * glm::scale(Step); }
+
+            glm::vec3 Min{ 0.f };
+            glm::vec3 Step{ 0.f };
+            glm::vec3 InverseStep{ 0.f };
+        };
+
+        // Octahedral normal, 8 bits per axis with the upper (y) hemisphere in the middle of the square. Picks the
+        // closest of the four neighbouring codes, about 0.6 degrees off at worst.
+        uint16_t EncodeNormal(const glm::vec3& normal);
+        glm::vec3 DecodeNormal(uint16_t normal);
+        // RGB8 of a color in [0, 1], alpha is always 255.
+        glm::u8vec4 EncodeColor(const glm::vec3& color);
+        glm::vec3 DecodeColor(const glm::u8vec4& color);
+
+        QuantizedColorVertex Encode(const ColorVertex& vertex, const Box& box);
+        QuantizedColorNormalVertex Encode(const ColorNormalVertex& vertex, const Box& box);
+        ColorVertex Decode(const QuantizedColorVertex& vertex, const Box& box);
+        ColorNormalVertex Decode(const QuantizedColorNormalVertex& vertex, const Box& box);
+
+        // Encodes a whole buffer on the calling thread, cheap enough for uploads during a frame.
+        std::vector<QuantizedColorVertex> Encode(std::span<const ColorVertex> vertices, const Box& box);
+    }
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include "Floof.h"
+#include "Math.h"
+
+namespace FLOOF {
+    // xoshiro256** seeded through splitmix64. Small, fast and good enough for gameplay and benchmarks.
+    // Use Random::Get(worker) for a worker's stream. Every worker index gets its own stream, derived from the
+    // global seed and separated from the others by jumps of 2^128 steps, so runs repeat with the same seed and
+    // worker count no matter which threads do the work.
+    class Random {
+    public:
+        explicit Random(uint64_t seed = s_DefaultSeed) {
+            Seed(seed);
+        }
+
+        void Seed(uint64_t seed) {
+            for (auto& state : m_State) {
+                seed += 0x9E3779B97F4A7C15ull;
+                uint64_t z = seed;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                state = z ^ (z >> 31);
+            }
+        }
+
+        uint64_t Next() {
+            const uint64_t result = Rotl(m_State[1] * 5, 7) * 9;
+            const uint64_t t = m_State[1] << 17;
+            m_State[2] ^= m_State[0];
+            m_State[3] ^= m_State[1];
+            m_State[1] ^= m_State[2];
+            m_State[0] ^= m_State[3];
+            m_State[2] ^= t;
+            m_State[3] = Rotl(m_State[3], 45);
+            return result;
+        }
+
+        // Advances the stream by 2^128 steps.
+        void Jump() {
+            static constexpr uint64_t jump[] = { 0x180EC6D33CFD0ABAull, 0xD5A61266F0C9392Cull, 0xA9582618E03FC9AAull, 0x39ABDC4529B1661Cull };
+            uint64_t s[4]{};
+            for (auto bits : jump) {
+                for (int b = 0; b < 64; b++) {
+                    if (bits & (1ull << b)) {
+                        for (int i = 0; i < 4; i++)
+                            s[i] ^= m_State[i];
+                    }
+                    Next();
+                }
+            }
+            for (int i = 0; i < 4; i++)
+                m_State[i] = s[i];
+        }
+
+        // [0, 1)
+        float Float() { return static_cast<float>(Next() >> 40) * 0x1.0p-24f; }
+        double Double() { return static_cast<double>(Next() >> 11) * 0x1.0p-53; }
+
+        // [min, max)
+        float Float(float min, float max) { return min + (max - min) * Float(); }
+        double Double(double min, double max) { return min + (max - min) * Double(); }
+
+        // [min, max]
+        int Int(int min, int max) {
+            const uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(max) - min) + 1;
+            return static_cast<int>(min + static_cast<int64_t>(((Next() >> 32) * range) >> 32));
+        }
+
+        void Fill(std::span<float> out, float min, float max) {
+            for (auto& value : out)
+                value = Float(min, max);
+        }
+
+        // Uniform points in the box [min, max).
+        void Fill(std::span<glm::vec3> out, const glm::vec3& min, const glm::vec3& max) {
+            const glm::vec3 size = max - min;
+            for (auto& value : out)
+                value = min + size * glm::vec3(Float(), Float(), Float());
+        }
+
+        // Stream of worker, the index Parallel::For and the physics step hand their callbacks. Code outside them
+        // uses worker 0. Only one thread may draw from a worker's stream at a time.
+        static Random& Get(uint32_t worker = 0) {
+            struct alignas(64) Stream {
+                Random Generator;
+                uint32_t Generation{ 0 };
+            };
+            static Stream streams[s_MaxWorkers];
+
+            ASSERT(worker < s_MaxWorkers);
+            Stream& stream = streams[worker];
+            const uint32_t current = s_Generation.load(std::memory_order_acquire);
+            if (stream.Generation != current) {
+                stream.Generator.Seed(s_Seed.load(std::memory_order_relaxed));
+                for (uint32_t i = 0; i < worker; i++)
+                    stream.Generator.Jump();
+                stream.Generation = current;
+            }
+            return stream.Generator;
+        }
+
+        // Reseeds every worker's stream. Streams pick up the new seed on their next Get().
+        static void SetSeed(uint64_t seed) {
+            s_Seed.store(seed, std::memory_order_relaxed);
+            s_Generation.fetch_add(1, std::memory_order_release);
+        }
+        static uint64_t GetSeed() { return s_Seed.load(std::memory_order_relaxed); }
+
+        inline static constexpr uint64_t s_DefaultSeed = 0x5EED;
+        inline static constexpr uint32_t s_MaxWorkers = 256;
+    private:
+        static uint64_t Rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+        uint64_t m_State[4];
+
+        inline static std::atomic<uint64_t> s_Seed{ s_DefaultSeed };
+        // Starts at 1 so every stream seeds itself on first use.
+        inline static std::atomic<uint32_t> s_Generation{ 1 };
+    };
+}
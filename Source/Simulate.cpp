@@ -4,45 +4,56 @@
 
 #include "Simulate.h"
 #include "Timer.h"
+#include "Profiler.h"
+#include "CollisionEvents.h"
+#include <algorithm>
 
-void FLOOF::Simulate::CalculateCollision(CollisionObject* obj1, CollisionObject* obj2) {
-    auto& collidingTransform1 = obj1->Transform;
+void FLOOF::Simulate::CalculateCollision(CollisionObject* obj1, CollisionObject* obj2, ContactPoint& contact, float warmStartFactor) {
     auto& collidingVelocity1 = obj1->Velocity;
     auto& collidingBall1 = obj1->Ball;
 
-    auto& collidingTransform2 = obj2->Transform;
     auto& collidingVelocity2 = obj2->Velocity;
     auto& collidingBall2 = obj2->Ball;
 
-    auto contactNormal = Physics::GetContactNormal(collidingTransform1.Position, collidingTransform2.Position);
+    const auto& contactNormal = contact.Normal;
 
     auto combinedMass = collidingBall2.Mass + collidingBall1.Mass;
     auto elasticity = collidingBall2.Elasticity * collidingBall1.Elasticity;
+
+    // The bounce targets the approach speed from before the warm start, so warm starting only changes how the
+    // impulse is split and never eats into the restitution.
+    const float approachVelocity = glm::dot(collidingVelocity2.Velocity - collidingVelocity1.Velocity, contactNormal);
+
+    // Warm start persisting contacts with last frame's impulse.
+    float warmImpulse{ 0.f };
+    if (contact.State == ContactState::Persist) {
+        warmImpulse = contact.AccumulatedImpulse * warmStartFactor;
+        collidingVelocity2.Velocity += (warmImpulse * contactNormal) / combinedMass;
+    }
+
     auto relVelocity = collidingVelocity2.Velocity - collidingVelocity1.Velocity;
 
     float angularComponent = glm::dot(relVelocity, contactNormal);
-    float j = -(1.f + elasticity) * angularComponent / (1.f / combinedMass);
-    if (angularComponent >= 0.f) { // moves opposite dirrections;
-        j = 0.f;
-    }
-    const glm::vec3 vecImpulse = j * contactNormal;
+    float j = -(angularComponent + elasticity * approachVelocity) / (1.f / combinedMass);
+
+    // Clamp the accumulated impulse so the contact never pulls the balls together.
+    float accumulated = std::max(warmImpulse + j, 0.f);
+    const glm::vec3 vecImpulse = (accumulated - warmImpulse) * contactNormal;
     collidingVelocity2.Velocity += vecImpulse / combinedMass;
+    contact.AccumulatedImpulse = accumulated;
 }
 
-void FLOOF::Simulate::BallBallOverlap(FLOOF::CollisionObject* obj1, FLOOF::CollisionObject* obj2) {
-    auto& collidingTransform1 = obj1->Transform;
-    auto& collidingBall1 = obj1->Ball;
+void FLOOF::Simulate::BallBallOverlap(FLOOF::CollisionObject* obj1, FLOOF::CollisionObject* obj2, const ContactPoint& contact) {
     auto& collidingTransform2 = obj2->Transform;
     auto& collidingBall2 = obj2->Ball;
-    auto contactNormal = Physics::GetContactNormal(collidingTransform1.Position, collidingTransform2.Position);
 
-    float dist = glm::length(collidingTransform1.Position - collidingTransform2.Position);
-    collidingTransform2.Position += contactNormal * ((collidingBall1.Radius + collidingBall2.Radius) - dist);
+    collidingTransform2.Position += contact.Normal * contact.Depth;
     collidingBall2.CollisionSphere.pos = collidingTransform2.Position;
 
 }
 
-void FLOOF::Simulate::CalculateCollision(FLOOF::CollisionObject* obj, FLOOF::Triangle& triangle, TimeComponent& time, glm::vec3& friction) {
+float FLOOF::Simulate::CalculateCollision(FLOOF::CollisionObject* obj, FLOOF::Triangle& triangle, TimeComponent& time, glm::vec3& friction) {
+    Profiler::Count(ProfileCounter::TerrainCollisions);
     glm::vec3 acc(Math::GravitationalPull);
 
     auto& transform = obj->Transform;
@@ -66,4 +77,90 @@ void FLOOF::Simulate::CalculateCollision(FLOOF::CollisionObject* obj, FLOOF::Tri
     transform.Position += glm::normalize(triangle.N) * (-dist + ball.Radius);
     ball.CollisionSphere.pos = transform.Position;
 
+    return std::abs(j);
+}
+
+size_t FLOOF::Simulate::ResolveBallCollisions(Octree& octree, ContactCache& contacts, CollisionEventStream& events, uint32_t worker) {
+    Timer stageTimer;
+
+    std::vector<std::pair<CollisionObject*, CollisionObject*>> collisionPairs;
+    octree.GetCollisionPairs(collisionPairs);
+    Profiler::AddTime(ProfileStage::PairGeneration, stageTimer.Delta());
+
+    contacts.BeginFrame();
+    const float warmStartFactor = contacts.WarmStarting ? contacts.WarmStartFactor : 0.f;
+    for (auto [obj1, obj2] : collisionPairs) {
+        if (obj2->Entity < obj1->Entity)
+            std::swap(obj1, obj2);
+
+        auto& contact = contacts.Touch(obj1, obj2, worker);
+        CalculateCollision(obj1, obj2, contact, warmStartFactor);
+        BallBallOverlap(obj1, obj2, contact);
+
+        if (contact.State == ContactState::Begin && events.IsListening(CollisionEventType::ContactBegin)) {
+            CollisionEvent event;
+            event.Type = CollisionEventType::ContactBegin;
+            event.A = contact.A;
+            event.B = contact.B;
+            event.Normal = contact.Normal;
+            event.Point = obj1->Transform.Position + contact.Normal * obj1->Ball.Radius;
+            event.Impulse = contact.AccumulatedImpulse;
+            events.Push(worker, event);
+        }
+    }
+    contacts.EndFrame();
+
+    if (events.IsListening(CollisionEventType::ContactEnd)) {
+        contacts.ForEach(ContactState::End, [&events, worker](const ContactPoint& contact) {
+            CollisionEvent event;
+            event.Type = CollisionEventType::ContactEnd;
+            event.A = contact.A;
+            event.B = contact.B;
+            event.Normal = contact.Normal;
+            events.Push(worker, event);
+        });
+    }
+    Profiler::AddTime(ProfileStage::BallBallResponse, stageTimer.Delta());
+
+    return collisionPairs.size();
+}
+
+bool FLOOF::Simulate::StepBall(CollisionObject& obj, TerrainComponent& terrain, TimeComponent& time, CollisionEventStream& events, uint32_t worker, float deltaTime, glm::vec3& friction) {
+    auto& transform = obj.Transform;
+    auto& velocity = obj.Velocity;
+    auto& ball = obj.Ball;
+
+    velocity.Force = Math::GravitationalPull * ball.Mass;
+
+    bool touched{ false };
+    {	//ball Large terrain collision//
+        ProfileScope scope(ProfileStage::TerrainQuery);
+        auto collisions = terrain.GetOverlappingTriangles(&ball.CollisionSphere);
+        Profiler::Count(ProfileCounter::TrianglesTested, collisions.size());
+        for (auto& tri : collisions) {
+            if (!ball.CollisionSphere.Intersect(&tri))
+                continue;
+
+            touched = true;
+            float impulse = CalculateCollision(&obj, tri, time, friction);
+            if (events.IsListening(CollisionEventType::TerrainImpact) && impulse >= events.MinTerrainImpulse) {
+                CollisionEvent event;
+                event.Type = CollisionEventType::TerrainImpact;
+                event.A = obj.Entity;
+                event.Normal = tri.N;
+                event.Point = transform.Position - tri.N * ball.Radius;
+                event.Impulse = impulse;
+                events.Push(worker, event);
+            }
+        }
+    }
+
+    //https://en.wikipedia.org/wiki/Verlet_integration
+    transform.Position += (velocity.Velocity * deltaTime) + (((velocity.Force) + friction) * (deltaTime * deltaTime * 0.5f));
+    velocity.Velocity += (((velocity.Force / ball.Mass) + friction) * deltaTime * 0.5f);
+
+    //set collision sphere location
+    ball.CollisionSphere.pos = transform.Position;
+
+    return touched;
 }
@@ -6,15 +6,24 @@
 #define FLOOF_SIMULATE_H
 
 #include "Octree.h"
+#include "ContactCache.h"
 
 namespace FLOOF {
+    class CollisionEventStream;
+
     class Simulate {
     public:
         Simulate() = delete;
 
-        static void CalculateCollision(CollisionObject* obj1, CollisionObject* obj2);
-        static void BallBallOverlap(CollisionObject* obj1, CollisionObject* obj2);
-        static void CalculateCollision(CollisionObject* obj, Triangle& triangle, TimeComponent& time, glm::vec3& friction);
+        static void CalculateCollision(CollisionObject* obj1, CollisionObject* obj2, ContactPoint& contact, float warmStartFactor);
+        static void BallBallOverlap(CollisionObject* obj1, CollisionObject* obj2, const ContactPoint& contact);
+        // Returns the magnitude of the impulse applied to the ball.
+        static float CalculateCollision(CollisionObject* obj, Triangle& triangle, TimeComponent& time, glm::vec3& friction);
+
+        // Broadphase pairs and ball-ball response for every object in the octree. Returns the number of pairs.
+        static size_t ResolveBallCollisions(Octree& octree, ContactCache& contacts, CollisionEventStream& events, uint32_t worker);
+        // Gravity, terrain response and Verlet integration of one ball. Returns true if it touched the terrain.
+        static bool StepBall(CollisionObject& obj, TerrainComponent& terrain, TimeComponent& time, CollisionEventStream& events, uint32_t worker, float deltaTime, glm::vec3& friction);
 
     };
 }
@@ -0,0 +1,75 @@
+#include "SimulationLod.h"
+#include "Components.h"
+#include <algorithm>
+
+namespace FLOOF {
+    SimulationLod::SimulationLod() {
+        Tiers = {
+            { 50.f, 1 },
+            { 150.f, 2 },
+            { 400.f, 4 },
+        };
+    }
+
+    void SimulationLod::BeginFrame(CameraComponent& camera) {
+        m_Frustum.emplace(camera);
+        m_Eye = camera.Position;
+        m_Frame++;
+        m_TierCounts.assign(Tiers.size() + 1, 0);
+        m_Stepped = 0;
+    }
+
+    float SimulationLod::Schedule(entt::entity entity, Sphere& sphere, SimulationLodComponent& lod, float deltaTime) {
+        const uint32_t tier = ClassifyTier(sphere);
+        lod.Tier = static_cast<uint8_t>(tier);
+        m_TierCounts[tier]++;
+        lod.AccumulatedTime += deltaTime;
+
+        uint32_t interval = 1;
+        if (Enabled) {
+            interval = tier < Tiers.size() ? Tiers[tier].Interval : OffscreenInterval;
+            if (tier > 0)
+                interval *= m_IntervalScale;
+        }
+
+        // Spread balls of the same tier over the frames of its interval.
+        if (interval > 1 && (m_Frame + entt::to_entity(entity)) % interval != 0)
+            return 0.f;
+
+        float step = std::min(lod.AccumulatedTime, MaxStep);
+        lod.AccumulatedTime = 0.f;
+        m_Stepped++;
+        return step;
+    }
+
+    void SimulationLod::EndFrame(double physicsTime) {
+        m_PhysicsTime = physicsTime;
+        if (!Enabled) {
+            m_IntervalScale = 1;
+            return;
+        }
+
+        const double budget = BudgetMs / 1000.0;
+        if (physicsTime > budget) {
+            m_IntervalScale = std::min(m_IntervalScale * 2, 16u);
+            m_FramesUnderBudget = 0;
+        } else if (m_IntervalScale > 1 && physicsTime < budget * 0.5 && ++m_FramesUnderBudget > 30) {
+            // Relax slowly so the scale does not flip every frame.
+            m_IntervalScale /= 2;
+            m_FramesUnderBudget = 0;
+        }
+    }
+
+    uint32_t SimulationLod::ClassifyTier(Sphere& sphere) {
+        if (Tiers.empty() || !m_Frustum->Intersect(&sphere))
+            return static_cast<uint32_t>(Tiers.size());
+
+        const glm::vec3 offset = sphere.pos - m_Eye;
+        const float distanceSquared = glm::dot(offset, offset);
+        for (uint32_t i = 0; i + 1 < Tiers.size(); i++) {
+            if (distanceSquared < Tiers[i].MaxDistance * Tiers[i].MaxDistance)
+                return i;
+        }
+        return static_cast<uint32_t>(Tiers.size()) - 1;
+    }
+}
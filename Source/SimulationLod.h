@@ -0,0 +1,59 @@
+#pragma once
+
+#include <entt/entt.hpp>
+#include <optional>
+#include <vector>
+#include "Physics.h"
+
+namespace FLOOF {
+    struct CameraComponent;
+    struct SimulationLodComponent;
+
+    // Decides which balls are simulated each frame. Balls near the camera step every frame, balls further
+    // away or outside the view frustum step every few frames in round-robin buckets and take the time they
+    // skipped as one larger step. When physics runs over budget the intervals of every tier but the first
+    // are stretched until it fits again.
+    class SimulationLod {
+    public:
+        struct Tier {
+            // Visible balls closer than this belong to the tier. The last visible tier takes the rest.
+            float MaxDistance;
+            uint32_t Interval;
+        };
+
+        SimulationLod();
+
+        void BeginFrame(CameraComponent& camera);
+        // Returns the time step to simulate the ball with this frame, or 0 if it waits for its bucket.
+        float Schedule(entt::entity entity, Sphere& sphere, SimulationLodComponent& lod, float deltaTime);
+        void EndFrame(double physicsTime);
+
+        // Visible tiers ordered by distance. Off-screen balls use OffscreenInterval.
+        std::vector<Tier> Tiers;
+        uint32_t OffscreenInterval{ 8 };
+        // Physics time per frame in ms before intervals are stretched.
+        float BudgetMs{ 4.f };
+        // Longest single step a waiting ball may take. Skipped time beyond this is dropped.
+        float MaxStep{ 0.2f };
+        bool Enabled{ true };
+
+        // One count per visible tier followed by the off-screen count.
+        const std::vector<uint32_t>& GetTierCounts() const { return m_TierCounts; }
+        uint32_t GetSteppedCount() const { return m_Stepped; }
+        uint32_t GetIntervalScale() const { return m_IntervalScale; }
+        double GetPhysicsTime() const { return m_PhysicsTime; }
+    private:
+        uint32_t ClassifyTier(Sphere& sphere);
+
+        std::optional<Frustum> m_Frustum;
+        glm::vec3 m_Eye{ 0.f };
+        uint64_t m_Frame{ 0 };
+
+        uint32_t m_IntervalScale{ 1 };
+        uint32_t m_FramesUnderBudget{ 0 };
+        double m_PhysicsTime{ 0.0 };
+
+        std::vector<uint32_t> m_TierCounts;
+        uint32_t m_Stepped{ 0 };
+    };
+}
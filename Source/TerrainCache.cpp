@@ -0,0 +1,183 @@
+#include "TerrainCache.h"
+
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace FLOOF {
+    namespace {
+        constexpr char s_Magic[8]{ 'F', 'L', 'O', 'O', 'F', 'T', 'R', 'N' };
+
+        void StoreVec3(float out[3], const glm::vec3& v) {
+            out[0] = v.x;
+            out[1] = v.y;
+            out[2] = v.z;
+        }
+    }
+
+    std::string TerrainCache::GetCachePath(const std::string& sourcePath) {
+        return std::filesystem::path(sourcePath).replace_extension(".floofterrain").string();
+    }
+
+    bool TerrainCache::Open(const std::string& cachePath, const std::string& sourcePath) {
+        Close();
+
+        SourceInfo source;
+        if (!GetSourceInfo(sourcePath, source) || !m_File.Open(cachePath))
+            return false;
+
+        if (m_File.GetSize() < sizeof(Header)) {
+            Close();
+            return false;
+        }
+
+        const auto* header = reinterpret_cast<const Header*>(m_File.GetData());
+        const uint64_t cells = static_cast<uint64_t>(header->Width) * header->Height;
+        const uint64_t size = m_File.GetSize();
+        auto fits = [&](uint64_t offset, uint64_t elementSize) {
+            return offset % alignof(float) == 0 && offset <= size && cells * elementSize <= size - offset;
+        };
+        if (std::memcmp(header->Magic, s_Magic, sizeof(s_Magic)) != 0 || header->Version != Version || !(header->CellSize > 0.f)
+            || !fits(header->HeightsOffset, sizeof(float)) || !fits(header->ColorsOffset, sizeof(glm::vec3))
+            || !fits(header->NormalsOffset, sizeof(glm::vec3))) {
+            Close();
+            return false;
+        }
+
+        // Size and time are enough normally. A touched but unchanged source (copied, checked out again) is
+        // confirmed by hashing it, which is still far cheaper than rebuilding.
+        if (header->SourceSize != source.Size || (header->SourceTime != source.Time && header->SourceHash != HashFile(sourcePath))) {
+            Close();
+            return false;
+        }
+
+        // Store the new time so the next launch does not hash the source again. The file is written around the
+        // map, so it is mapped again afterwards.
+        if (header->SourceTime != source.Time) {
+            m_File.Close();
+            if (!WriteSourceTime(cachePath, source.Time) || !m_File.Open(cachePath) || m_File.GetSize() != size) {
+                Close();
+                return false;
+            }
+            header = reinterpret_cast<const Header*>(m_File.GetData());
+        }
+
+        m_Header = header;
+        return true;
+    }
+
+    void TerrainCache::Close() {
+        m_Header = nullptr;
+        m_File.Close();
+    }
+
+    TerrainCache::Bounds TerrainCache::GetBounds() const {
+        Bounds bounds;
+        bounds.Min = glm::vec3(m_Header->Min[0], m_Header->Min[1], m_Header->Min[2]);
+        bounds.Max = glm::vec3(m_Header->Max[0], m_Header->Max[1], m_Header->Max[2]);
+        bounds.Offset = glm::vec3(m_Header->Offset[0], m_Header->Offset[1], m_Header->Offset[2]);
+        bounds.Middle = glm::vec3(m_Header->Middle[0], m_Header->Middle[1], m_Header->Middle[2]);
+        return bounds;
+    }
+
+    std::span<const float> TerrainCache::GetHeights() const {
+        return { reinterpret_cast<const float*>(m_File.GetData() + m_Header->HeightsOffset), static_cast<size_t>(m_Header->Width) * m_Header->Height };
+    }
+
+    std::span<const glm::vec3> TerrainCache::GetColors() const {
+        return { reinterpret_cast<const glm::vec3*>(m_File.GetData() + m_Header->ColorsOffset), static_cast<size_t>(m_Header->Width) * m_Header->Height };
+    }
+
+    std::span<const glm::vec3> TerrainCache::GetNormals() const {
+        return { reinterpret_cast<const glm::vec3*>(m_File.GetData() + m_Header->NormalsOffset), static_cast<size_t>(m_Header->Width) * m_Header->Height };
+    }
+
+    bool TerrainCache::Write(const std::string& cachePath, const std::string& sourcePath, uint32_t width, uint32_t height, float cellSize, const Bounds& bounds,
+        std::span<const float> heights, std::span<const glm::vec3> colors, std::span<const glm::vec3> normals) {
+        const size_t cells = static_cast<size_t>(width) * height;
+        if (heights.size() != cells || colors.size() != cells || normals.size() != cells)
+            return false;
+
+        SourceInfo source;
+        if (!GetSourceInfo(sourcePath, source))
+            return false;
+
+        Header header{};
+        std::memcpy(header.Magic, s_Magic, sizeof(s_Magic));
+        header.Version = Version;
+        header.Width = width;
+        header.Height = height;
+        header.CellSize = cellSize;
+        header.SourceSize = source.Size;
+        header.SourceTime = source.Time;
+        header.SourceHash = HashFile(sourcePath);
+        StoreVec3(header.Min, bounds.Min);
+        StoreVec3(header.Max, bounds.Max);
+        StoreVec3(header.Offset, bounds.Offset);
+        StoreVec3(header.Middle, bounds.Middle);
+        header.HeightsOffset = sizeof(Header);
+        header.ColorsOffset = header.HeightsOffset + heights.size_bytes();
+        header.NormalsOffset = header.ColorsOffset + colors.size_bytes();
+
+        const std::string tempPath = cachePath + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            if (!file)
+                return false;
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(heights.data()), heights.size_bytes());
+            file.write(reinterpret_cast<const char*>(colors.data()), colors.size_bytes());
+            file.write(reinterpret_cast<const char*>(normals.data()), normals.size_bytes());
+            if (!file)
+                return false;
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tempPath, cachePath, error);
+        if (error) {
+            std::filesystem::remove(tempPath, error);
+            return false;
+        }
+        return true;
+    }
+
+    bool TerrainCache::WriteSourceTime(const std::string& cachePath, int64_t time) {
+        std::fstream file(cachePath, std::ios::binary | std::ios::in | std::ios::out);
+        if (!file)
+            return false;
+        file.seekp(offsetof(Header, SourceTime));
+        file.write(reinterpret_cast<const char*>(&time), sizeof(time));
+        return static_cast<bool>(file);
+    }
+
+    bool TerrainCache::GetSourceInfo(const std::string& sourcePath, SourceInfo& info) {
+        std::error_code error;
+        info.Size = std::filesystem::file_size(sourcePath, error);
+        if (error)
+            return false;
+        info.Time = static_cast<int64_t>(std::filesystem::last_write_time(sourcePath, error).time_since_epoch().count());
+        return !error;
+    }
+
+    uint64_t TerrainCache::HashFile(const std::string& path) {
+        MappedFile file(path);
+        if (!file.IsOpen())
+            return 0;
+
+        // 64 bit words through a multiply-xorshift mix, the tail byte by byte.
+        const uint8_t* data = file.GetData();
+        const size_t size = file.GetSize();
+        uint64_t hash = 0x9E3779B97F4A7C15ull ^ size;
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            hash = (hash ^ word) * 0xBF58476D1CE4E5B9ull;
+            hash ^= hash >> 31;
+        }
+        for (; i < size; i++)
+            hash = (hash ^ data[i]) * 0x100000001B3ull;
+        return hash;
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include "Math.h"
+#include "MappedFile.h"
+
+namespace FLOOF {
+    // Baked height grid of a point cloud, stored next to the source as .floofterrain. Holds heights, colors,
+    // normals, cell size and bounds so a terrain can be rebuilt without touching the points. A cache is only
+    // used while its source has the same size and modification time, or failing that the same content hash.
+    class TerrainCache {
+    public:
+        inline static constexpr uint32_t Version = 2;
+
+        struct Bounds {
+            glm::vec3 Min{ 0.f };
+            glm::vec3 Max{ 0.f };
+            glm::vec3 Offset{ 0.f };
+            glm::vec3 Middle{ 0.f };
+        };
+
+        // foo.las -> foo.floofterrain
+        static std::string GetCachePath(const std::string& sourcePath);
+
+        // Maps the cache and checks it against the source. Returns false if either is missing, the cache is
+        // from another version or the source changed.
+        bool Open(const std::string& cachePath, const std::string& sourcePath);
+        void Close();
+        bool IsOpen() const { return m_Header != nullptr; }
+
+        uint32_t GetWidth() const { return m_Header->Width; }
+        uint32_t GetHeight() const { return m_Header->Height; }
+        // World units between samples.
+        float GetCellSize() const { return m_Header->CellSize; }
+        Bounds GetBounds() const;
+        // Content hash of the source the cache was baked from.
+        uint64_t GetSourceHash() const { return m_Header->SourceHash; }
+        // Row major, Width * Height values each.
+        std::span<const float> GetHeights() const;
+        std::span<const glm::vec3> GetColors() const;
+        std::span<const glm::vec3> GetNormals() const;
+
+        // Writes to a temporary file first and renames it over the cache, so a crash never leaves a half cache.
+        static bool Write(const std::string& cachePath, const std::string& sourcePath, uint32_t width, uint32_t height, float cellSize, const Bounds& bounds,
+            std::span<const float> heights, std::span<const glm::vec3> colors, std::span<const glm::vec3> normals);
+    private:
+        struct Header {
+            char Magic[8];
+            uint32_t Version;
+            uint32_t Width;
+            uint32_t Height;
+            float CellSize;
+            uint64_t SourceSize;
+            int64_t SourceTime;
+            uint64_t SourceHash;
+            float Min[3];
+            float Max[3];
+            float Offset[3];
+            float Middle[3];
+            uint64_t HeightsOffset;
+            uint64_t ColorsOffset;
+            uint64_t NormalsOffset;
+        };
+        static_assert(sizeof(Header) == 120, "TerrainCache::Header must not contain padding");
+
+        struct SourceInfo {
+            uint64_t Size{ 0 };
+            int64_t Time{ 0 };
+        };
+        static bool GetSourceInfo(const std::string& sourcePath, SourceInfo& info);
+        // Rewrites SourceTime in place, after a hash confirmed the source is unchanged.
+        static bool WriteSourceTime(const std::string& cachePath, int64_t time);
+        static uint64_t HashFile(const std::string& path);
+
+        MappedFile m_File;
+        const Header* m_Header{ nullptr };
+    };
+}
@@ -0,0 +1,70 @@
+#include "TerrainLoader.h"
+
+#include <utility>
+#include "LasLoader.h"
+#include "PointCloud.h"
+
+namespace FLOOF {
+    TerrainLoader::TerrainLoader(const std::string& path, const Settings& settings) {
+        m_Thread = std::thread(&TerrainLoader::Load, this, path, settings);
+    }
+
+    TerrainLoader::~TerrainLoader() {
+        m_Thread.join();
+    }
+
+    std::vector<TerrainLoader::Stage> TerrainLoader::TakeStages() {
+        std::lock_guard lock(m_Mutex);
+        return std::exchange(m_Finished, {});
+    }
+
+    bool TerrainLoader::IsDone() {
+        std::lock_guard lock(m_Mutex);
+        return m_Done && m_Finished.empty();
+    }
+
+    void TerrainLoader::Load(std::string path, Settings settings) {
+        // Every level comes out of the same pass over the points, so the preview costs a downsample.
+        const uint32_t levels = std::max(settings.PhysicsLevel, settings.PreviewLevel) + 1;
+        LasLoader mapData(path, true, settings.CellSize, levels);
+        const uint32_t levelCount = mapData.GetLevelCount();
+        const uint32_t physicsLevel = std::min(settings.PhysicsLevel, levelCount - 1);
+        const uint32_t previewLevel = std::min(settings.PreviewLevel, levelCount - 1);
+        m_Step = 1;
+
+        // A preview finer than the physics level would only be thrown away.
+        if (previewLevel > physicsLevel) {
+            const auto& grid = mapData.GetHeightGrid(previewLevel);
+            Stage preview;
+            preview.Mesh.emplace(grid.MakeVertices(), grid.Width, grid.Height);
+            preview.Collision = grid;
+            preview.MinY = mapData.GetMinY();
+            preview.IsPreview = true;
+            Finish(std::move(preview));
+        }
+        m_Step = 2;
+
+        {
+            const auto& grid = mapData.GetHeightGrid();
+            Stage terrain;
+            terrain.Mesh.emplace(grid.MakeVertices(), grid.Width, grid.Height);
+            terrain.Collision = mapData.TakeHeightGrid(physicsLevel);
+            terrain.MinY = mapData.GetMinY();
+            Finish(std::move(terrain));
+        }
+        m_Step = 3;
+
+        Stage points;
+        points.Points.emplace(PointCloud::Decimate(mapData.GetPointData(), settings.PointCloudVoxelSize));
+        Finish(std::move(points));
+        m_Step = s_StepCount;
+
+        std::lock_guard lock(m_Mutex);
+        m_Done = true;
+    }
+
+    void TerrainLoader::Finish(Stage&& stage) {
+        std::lock_guard lock(m_Mutex);
+        m_Finished.push_back(std::move(stage));
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "HeightGrid.h"
+#include "PointOctree.h"
+#include "TerrainLod.h"
+#include "Timer.h"
+
+namespace FLOOF {
+    // Loads a whole terrain on a background thread while the main thread keeps drawing. What is built is handed
+    // over in stages: a coarse preview when the loader has a coarser level, then the full terrain, then the point
+    // cloud. Nothing here touches the renderer or the registry, uploading is left to the main thread.
+    class TerrainLoader {
+    public:
+        struct Settings {
+            float CellSize{ 1.f };
+            uint32_t PhysicsLevel{ 0 };
+            // Level drawn and collided with until the full terrain is built, 0 skips the preview.
+            uint32_t PreviewLevel{ 3 };
+            float PointCloudVoxelSize{ 0.5f };
+        };
+
+        // Everything a stage replaces, parts it does not bring are empty.
+        struct Stage {
+            std::optional<TerrainLodMesh> Mesh;
+            std::optional<HeightGrid> Collision;
+            std::optional<PointOctree> Points;
+            float MinY{ 0.f };
+            bool IsPreview{ false };
+        };
+
+        TerrainLoader(const std::string& path, const Settings& settings);
+        // Waits for the load to finish, a LasLoader can not be stopped halfway.
+        ~TerrainLoader();
+
+        TerrainLoader(const TerrainLoader&) = delete;
+        TerrainLoader& operator = (const TerrainLoader&) = delete;
+
+        // Stages finished since the last call, in load order.
+        std::vector<Stage> TakeStages();
+        // True once every stage is built and taken.
+        bool IsDone();
+
+        // Steps finished out of GetStepCount and what is being worked on, for a progress bar.
+        uint32_t GetStep() const { return m_Step.load(std::memory_order_relaxed); }
+        static constexpr uint32_t GetStepCount() { return s_StepCount; }
+        const char* GetStepName() const { return s_StepNames[std::min(GetStep(), s_StepCount - 1)]; }
+        double GetSeconds() const { return Timer::GetTimeSince(m_StartTime); }
+    private:
+        static constexpr uint32_t s_StepCount = 4;
+        static constexpr const char* s_StepNames[s_StepCount] = { "Reading survey", "Building preview", "Building terrain", "Building point cloud" };
+
+        void Load(std::string path, Settings settings);
+        void Finish(Stage&& stage);
+
+        std::atomic<uint32_t> m_Step{ 0 };
+        const std::chrono::high_resolution_clock::time_point m_StartTime{ Timer::GetTime() };
+
+        // Guards everything below.
+        std::mutex m_Mutex;
+        std::vector<Stage> m_Finished;
+        bool m_Done{ false };
+        std::thread m_Thread;
+    };
+}
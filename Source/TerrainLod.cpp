@@ -0,0 +1,204 @@
+#include "TerrainLod.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include "Parallel.h"
+
+namespace FLOOF {
+    namespace {
+        // Skirts reach this far below the coarsest level's error, so float rounding never opens a gap.
+        constexpr float s_SkirtMargin = 1.f;
+        constexpr size_t s_MinChunksPerWorker = 16;
+    }
+
+    void TerrainLod::Select(const glm::vec3& eye, float pixelsPerUnit, float maxPixelError, std::vector<Selection>& out) const {
+        out.clear();
+        if (m_Levels.empty())
+            return;
+        out.reserve(m_Chunks.size());
+
+        const uint32_t coarsest = static_cast<uint32_t>(m_Levels.size()) - 1;
+        for (uint32_t i = 0; i < m_Chunks.size(); i++) {
+            const auto& chunk = m_Chunks[i];
+            const glm::vec3 closest = glm::clamp(eye, chunk.Min, chunk.Max);
+            const float distance = std::max(glm::length(eye - closest), 0.001f);
+            // error * pixelsPerUnit / distance <= maxPixelError, without dividing per level.
+            const float allowed = maxPixelError * distance / pixelsPerUnit;
+            uint32_t level = coarsest;
+            while (level > 0 && chunk.Errors[level] > allowed)
+                level--;
+            out.push_back({ i, level });
+        }
+    }
+
+    uint32_t TerrainLod::GetTriangleCount(std::span<const Selection> selection) const {
+        uint32_t triangles{ 0 };
+        for (const auto& selected : selection)
+            triangles += m_Levels[selected.Level].IndexCount / 3;
+        return triangles;
+    }
+
+    TerrainLodMesh::TerrainLodMesh(std::span<const ColorNormalVertex> grid, uint32_t width, uint32_t height, uint32_t chunkSize) {
+        if (width < 2 || height < 2 || grid.size() < static_cast<size_t>(width) * height)
+            return;
+
+        const uint32_t size = std::bit_floor(std::clamp(chunkSize, 1u, 1u << (TerrainLod::MaxLevels - 1)));
+        const uint32_t side = size + 1;
+        const uint32_t gridVertices = side * side;
+        const uint32_t chunkVertices = gridVertices + 4 * side;
+        const uint32_t chunksX = (width - 2) / size + 1;
+        const uint32_t chunksZ = (height - 2) / size + 1;
+        Lod.m_ChunkSize = size;
+
+        // Skirt vertices follow the grid, one row per edge: z = 0, z = size, x = 0, x = size.
+        auto gridIndex = [side](uint32_t x, uint32_t z) { return z * side + x; };
+        auto borderIndex = [&](uint32_t edge, uint32_t i) {
+            switch (edge) {
+            case 0: return gridIndex(i, 0);
+            case 1: return gridIndex(i, size);
+            case 2: return gridIndex(0, i);
+            default: return gridIndex(size, i);
+            }
+        };
+        auto skirtIndex = [&](uint32_t edge, uint32_t i) { return gridVertices + edge * side + i; };
+
+        // Grid triangles face up with cross(b - a, c - a), see LasLoader. Skirts get the winding that faces
+        // away from the chunk, decided on a flat chunk since only the direction matters.
+        auto flatPosition = [&](uint32_t index) {
+            if (index < gridVertices)
+                return glm::vec3(static_cast<float>(index % side), 0.f, static_cast<float>(index / side));
+            const uint32_t border = borderIndex((index - gridVertices) / side, (index - gridVertices) % side);
+            return glm::vec3(static_cast<float>(border % side), -1.f, static_cast<float>(border / side));
+        };
+        const glm::vec3 outward[4]{ { 0.f, 0.f, -1.f }, { 0.f, 0.f, 1.f }, { -1.f, 0.f, 0.f }, { 1.f, 0.f, 0.f } };
+        auto addSkirtTriangle = [&](uint32_t a, uint32_t b, uint32_t c, const glm::vec3& facing) {
+            const glm::vec3 pa = flatPosition(a);
+            if (glm::dot(glm::cross(flatPosition(b) - pa, flatPosition(c) - pa), facing) < 0.f)
+                std::swap(b, c);
+            Indices.insert(Indices.end(), { a, b, c });
+        };
+
+        Indices.reserve(GetIndexCount(size));
+        Lod.m_Levels.reserve(std::countr_zero(size) + 1);
+        for (uint32_t step = 1; step <= size; step *= 2) {
+            TerrainLod::Level level;
+            level.FirstIndex = static_cast<uint32_t>(Indices.size());
+            for (uint32_t z = 0; z < size; z += step) {
+                for (uint32_t x = 0; x < size; x += step) {
+                    const uint32_t a = gridIndex(x, z);
+                    const uint32_t b = gridIndex(x + step, z);
+                    const uint32_t c = gridIndex(x + step, z + step);
+                    const uint32_t d = gridIndex(x, z + step);
+                    Indices.insert(Indices.end(), { a, c, b, a, d, c });
+                }
+            }
+            for (uint32_t edge = 0; edge < 4; edge++) {
+                for (uint32_t i = 0; i < size; i += step) {
+                    const uint32_t top0 = borderIndex(edge, i);
+                    const uint32_t top1 = borderIndex(edge, i + step);
+                    const uint32_t bottom0 = skirtIndex(edge, i);
+                    const uint32_t bottom1 = skirtIndex(edge, i + step);
+                    addSkirtTriangle(top0, top1, bottom0, outward[edge]);
+                    addSkirtTriangle(top1, bottom1, bottom0, outward[edge]);
+                }
+            }
+            level.IndexCount = static_cast<uint32_t>(Indices.size()) - level.FirstIndex;
+            Lod.m_Levels.push_back(level);
+        }
+        const uint32_t levels = static_cast<uint32_t>(Lod.m_Levels.size());
+
+        const size_t chunks = static_cast<size_t>(chunksX) * chunksZ;
+        Vertices.resize(chunks * chunkVertices);
+        Lod.m_Chunks.resize(chunks);
+        Parallel::For(chunks, Parallel::GetWorkerCount(chunks, s_MinChunksPerWorker), [&](size_t begin, size_t end, uint32_t) {
+            // A chunk is built in floats, then quantized to its own box.
+            std::vector<ColorNormalVertex> scratch(chunkVertices);
+            for (size_t c = begin; c < end; c++) {
+                auto& chunk = Lod.m_Chunks[c];
+                const uint32_t x0 = static_cast<uint32_t>(c % chunksX) * size;
+                const uint32_t z0 = static_cast<uint32_t>(c / chunksX) * size;
+                ColorNormalVertex* vertices = scratch.data();
+                chunk.VertexOffset = static_cast<int32_t>(c * chunkVertices);
+
+                chunk.Min = glm::vec3(std::numeric_limits<float>::max());
+                chunk.Max = glm::vec3(std::numeric_limits<float>::lowest());
+                for (uint32_t z = 0; z < side; z++) {
+                    const size_t row = static_cast<size_t>(std::min(z0 + z, height - 1)) * width;
+                    for (uint32_t x = 0; x < side; x++) {
+                        const auto& vertex = grid[row + std::min(x0 + x, width - 1)];
+                        vertices[gridIndex(x, z)] = vertex;
+                        chunk.Min = glm::min(chunk.Min, vertex.Pos);
+                        chunk.Max = glm::max(chunk.Max, vertex.Pos);
+                    }
+                }
+
+                // Every level is compared against the full grid, through the same triangle split it is drawn with.
+                auto h = [&](uint32_t x, uint32_t z) { return vertices[gridIndex(x, z)].Pos.y; };
+                chunk.Errors.fill(0.f);
+                for (uint32_t level = 1, step = 2; level < levels; level++, step *= 2) {
+                    float error = chunk.Errors[level - 1];
+                    const float inverseStep = 1.f / static_cast<float>(step);
+                    for (uint32_t qz = 0; qz < size; qz += step) {
+                        for (uint32_t qx = 0; qx < size; qx += step) {
+                            const float ha = h(qx, qz);
+                            const float hb = h(qx + step, qz);
+                            const float hc = h(qx + step, qz + step);
+                            const float hd = h(qx, qz + step);
+                            for (uint32_t j = 0; j <= step; j++) {
+                                for (uint32_t i = 0; i <= step; i++) {
+                                    const float u = i * inverseStep;
+                                    const float v = j * inverseStep;
+                                    const float coarse = u >= v ? ha + u * (hb - ha) + v * (hc - hb) : ha + v * (hd - ha) + u * (hc - hd);
+                                    error = std::max(error, std::abs(h(qx + i, qz + j) - coarse));
+                                }
+                            }
+                        }
+                    }
+                    chunk.Errors[level] = error;
+                }
+                for (uint32_t level = levels; level < TerrainLod::MaxLevels; level++)
+                    chunk.Errors[level] = chunk.Errors[levels - 1];
+
+                const float depth = chunk.Errors[levels - 1] + s_SkirtMargin;
+                for (uint32_t edge = 0; edge < 4; edge++) {
+                    for (uint32_t i = 0; i < side; i++) {
+                        auto& skirt = vertices[skirtIndex(edge, i)];
+                        skirt = vertices[borderIndex(edge, i)];
+                        skirt.Pos.y -= depth;
+                    }
+                }
+
+                chunk.Box = Quantize::Box(chunk.Min - glm::vec3(0.f, depth, 0.f), chunk.Max);
+                QuantizedColorNormalVertex* quantized = Vertices.data() + c * chunkVertices;
+                for (uint32_t i = 0; i < chunkVertices; i++)
+                    quantized[i] = Quantize::Encode(vertices[i], chunk.Box);
+            }
+        });
+    }
+
+    size_t TerrainLodMesh::GetBytes() const {
+        return sizeof(TerrainLodMesh) + Vertices.capacity() * sizeof(QuantizedColorNormalVertex) + Indices.capacity() * sizeof(uint32_t)
+            + Lod.GetLevels().capacity() * sizeof(TerrainLod::Level) + Lod.GetChunks().capacity() * sizeof(TerrainLod::Chunk);
+    }
+
+    size_t TerrainLodMesh::GetBytes(uint32_t width, uint32_t height, uint32_t chunkSize) {
+        if (width < 2 || height < 2)
+            return sizeof(TerrainLodMesh);
+        const uint32_t size = std::bit_floor(std::clamp(chunkSize, 1u, 1u << (TerrainLod::MaxLevels - 1)));
+        const size_t chunks = static_cast<size_t>((width - 2) / size + 1) * ((height - 2) / size + 1);
+        const size_t chunkVertices = static_cast<size_t>(size + 1) * (size + 1) + 4 * (size + 1);
+        return sizeof(TerrainLodMesh) + chunks * chunkVertices * sizeof(QuantizedColorNormalVertex) + GetIndexCount(size) * sizeof(uint32_t)
+            + (std::countr_zero(size) + 1) * sizeof(TerrainLod::Level) + chunks * sizeof(TerrainLod::Chunk);
+    }
+
+    size_t TerrainLodMesh::GetIndexCount(uint32_t chunkSize) {
+        size_t indices{ 0 };
+        for (uint32_t step = 1; step <= chunkSize; step *= 2) {
+            const size_t quads = chunkSize / step;
+            indices += quads * quads * 6 + 4 * quads * 6;
+        }
+        return indices;
+    }
+}
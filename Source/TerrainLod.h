@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "Quantize.h"
+
+namespace FLOOF {
+    // Geomipmapped terrain. The grid is cut into square chunks and every chunk can be drawn at any level,
+    // level l using every 2^l th sample. Chunks have their own block of vertices, so one index range per
+    // level draws any chunk with a vertex offset. Skirts hanging down from the chunk borders hide the cracks
+    // between neighbours at different levels.
+    class TerrainLod {
+    public:
+        inline static constexpr uint32_t DefaultChunkSize = 64;
+        inline static constexpr uint32_t MaxLevels = 16;
+
+        struct Level {
+            uint32_t FirstIndex{ 0 };
+            uint32_t IndexCount{ 0 };
+        };
+
+        struct Chunk {
+            int32_t VertexOffset{ 0 };
+            glm::vec3 Min{ 0.f };
+            glm::vec3 Max{ 0.f };
+            // Grid the chunk's vertices are quantized to, skirts included.
+            Quantize::Box Box;
+            // Largest height difference between level l and the full grid, never decreasing with l.
+            std::array<float, MaxLevels> Errors{};
+        };
+
+        struct Selection {
+            uint32_t Chunk;
+            uint32_t Level;
+        };
+
+        // Picks the coarsest level of every chunk whose error projects to at most maxPixelError pixels at
+        // the chunk's closest point. pixelsPerUnit is the viewport height over 2 tan(fov / 2).
+        void Select(const glm::vec3& eye, float pixelsPerUnit, float maxPixelError, std::vector<Selection>& out) const;
+        uint32_t GetTriangleCount(std::span<const Selection> selection) const;
+
+        uint32_t GetChunkSize() const { return m_ChunkSize; }
+        const std::vector<Level>& GetLevels() const { return m_Levels; }
+        const std::vector<Chunk>& GetChunks() const { return m_Chunks; }
+    private:
+        friend struct TerrainLodMesh;
+
+        uint32_t m_ChunkSize{ 0 };
+        std::vector<Level> m_Levels;
+        std::vector<Chunk> m_Chunks;
+    };
+
+    // Vertices and indices of a TerrainLod, only needed until they are uploaded. Vertices are quantized to the box
+    // of their chunk.
+    struct TerrainLodMesh {
+        TerrainLodMesh() = default;
+        // grid is width * height vertices, row major like LasLoader and TerrainTile lay them out. chunkSize is
+        // rounded down to a power of two. Chunks past the grid edge repeat the last row and column.
+        TerrainLodMesh(std::span<const ColorNormalVertex> grid, uint32_t width, uint32_t height, uint32_t chunkSize = TerrainLod::DefaultChunkSize);
+
+        size_t GetBytes() const;
+        // What GetBytes returns for a mesh built with these arguments.
+        static size_t GetBytes(uint32_t width, uint32_t height, uint32_t chunkSize = TerrainLod::DefaultChunkSize);
+
+        TerrainLod Lod;
+        std::vector<QuantizedColorNormalVertex> Vertices;
+        std::vector<uint32_t> Indices;
+    private:
+        static size_t GetIndexCount(uint32_t chunkSize);
+    };
+}
@@ -0,0 +1,210 @@
+#include "TerrainStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace FLOOF {
+    namespace {
+        constexpr float s_NotWanted = std::numeric_limits<float>::infinity();
+        // Tiles under bodies are needed for collision, they go before anything the camera wants.
+        constexpr float s_BodyPriority = -1.f;
+    }
+
+    TerrainStreamer::TerrainStreamer(TerrainTileSet&& tiles, uint32_t threads) : m_Tiles(std::move(tiles)) {
+        const uint32_t count = m_Tiles.GetTileCount();
+        m_Resident.resize(count);
+        m_Priority.resize(count, s_NotWanted);
+        m_IsWanted.resize(count, 0);
+        m_States.resize(count, TileState::Unloaded);
+
+        threads = std::max(threads, 1u);
+        m_Threads.reserve(threads);
+        for (uint32_t i = 0; i < threads; i++)
+            m_Threads.emplace_back(&TerrainStreamer::LoadTiles, this);
+    }
+
+    TerrainStreamer::~TerrainStreamer() {
+        {
+            std::lock_guard lock(m_Mutex);
+            m_Stop = true;
+        }
+        m_Condition.notify_all();
+        for (auto& thread : m_Threads)
+            thread.join();
+    }
+
+    void TerrainStreamer::Update(const glm::vec3& camera, std::span<const glm::vec3> bodies) {
+        // In world units.
+        const float tileSize = static_cast<float>(m_Tiles.GetTileSize()) * m_Tiles.GetCellSize();
+        const int tilesX = static_cast<int>(m_Tiles.GetTilesX());
+        const int tilesZ = static_cast<int>(m_Tiles.GetTilesZ());
+
+        m_Wanted.clear();
+        auto want = [this, tilesX](int tileX, int tileZ, float priority) {
+            const uint32_t tile = static_cast<uint32_t>(tileZ * tilesX + tileX);
+            if (m_Priority[tile] == s_NotWanted)
+                m_Wanted.emplace_back(0.f, tile);
+            m_Priority[tile] = std::min(m_Priority[tile], priority);
+        };
+
+        const int ring = static_cast<int>(BodyTileRing);
+        for (const auto& body : bodies) {
+            const int tileX = static_cast<int>(std::floor(body.x / tileSize));
+            const int tileZ = static_cast<int>(std::floor(body.z / tileSize));
+            if (tileX < -ring || tileX >= tilesX + ring || tileZ < -ring || tileZ >= tilesZ + ring)
+                continue;
+            for (int z = std::max(tileZ - ring, 0); z <= std::min(tileZ + ring, tilesZ - 1); z++) {
+                for (int x = std::max(tileX - ring, 0); x <= std::min(tileX + ring, tilesX - 1); x++)
+                    want(x, z, s_BodyPriority);
+            }
+        }
+
+        // Distance from the camera to the closest point of each tile's square, ignoring height.
+        const int minX = std::max(static_cast<int>(std::floor((camera.x - LoadRadius) / tileSize)), 0);
+        const int maxX = std::min(static_cast<int>(std::floor((camera.x + LoadRadius) / tileSize)), tilesX - 1);
+        const int minZ = std::max(static_cast<int>(std::floor((camera.z - LoadRadius) / tileSize)), 0);
+        const int maxZ = std::min(static_cast<int>(std::floor((camera.z + LoadRadius) / tileSize)), tilesZ - 1);
+        for (int z = minZ; z <= maxZ; z++) {
+            for (int x = minX; x <= maxX; x++) {
+                const float x0 = static_cast<float>(x) * tileSize;
+                const float z0 = static_cast<float>(z) * tileSize;
+                const float dx = std::max({ x0 - camera.x, camera.x - (x0 + tileSize), 0.f });
+                const float dz = std::max({ z0 - camera.z, camera.z - (z0 + tileSize), 0.f });
+                const float distance = std::sqrt(dx * dx + dz * dz);
+                if (distance <= LoadRadius)
+                    want(x, z, distance);
+            }
+        }
+
+        // Nearest first, ties by index so the order never depends on the order of the bodies.
+        for (auto& [priority, tile] : m_Wanted) {
+            priority = m_Priority[tile];
+            m_Priority[tile] = s_NotWanted;
+        }
+        std::sort(m_Wanted.begin(), m_Wanted.end());
+
+        size_t wantedBytes{ 0 };
+        size_t keep{ 0 };
+        for (; keep < m_Wanted.size(); keep++) {
+            const size_t bytes = TerrainTile::GetBytes(m_Tiles.GetTileInfo(m_Wanted[keep].second));
+            if (wantedBytes + bytes > MemoryBudget)
+                break;
+            wantedBytes += bytes;
+            m_IsWanted[m_Wanted[keep].second] = 1;
+        }
+
+        bool queued{ false };
+        {
+            std::lock_guard lock(m_Mutex);
+
+            for (auto& tile : m_Finished) {
+                const uint32_t index = tile->Index;
+                if (!m_IsWanted[index]) {
+                    m_States[index] = TileState::Unloaded;
+                    continue;
+                }
+                m_States[index] = TileState::Resident;
+                m_ResidentBytes += tile->GetBytes();
+                m_ResidentCount++;
+                m_LoadedTotal++;
+                m_Loaded.emplace_back(tile);
+                m_Resident[index] = std::move(tile);
+            }
+            m_Finished.clear();
+
+            for (uint32_t tile = 0; tile < m_Resident.size(); tile++) {
+                if (m_Resident[tile] && !m_IsWanted[tile])
+                    Evict(tile);
+            }
+
+            for (uint32_t tile : m_Queue)
+                m_States[tile] = TileState::Unloaded;
+            m_Queue.clear();
+            for (size_t i = 0; i < keep; i++) {
+                const uint32_t tile = m_Wanted[i].second;
+                if (m_States[tile] == TileState::Unloaded) {
+                    m_States[tile] = TileState::Queued;
+                    m_Queue.push_back(tile);
+                }
+            }
+            queued = !m_Queue.empty();
+        }
+        if (queued)
+            m_Condition.notify_all();
+
+        for (size_t i = 0; i < keep; i++)
+            m_IsWanted[m_Wanted[i].second] = 0;
+    }
+
+    std::vector<std::shared_ptr<const TerrainTile>> TerrainStreamer::TakeLoaded() {
+        return std::exchange(m_Loaded, {});
+    }
+
+    std::vector<uint32_t> TerrainStreamer::TakeEvicted() {
+        return std::exchange(m_Evicted, {});
+    }
+
+    std::vector<Triangle> TerrainStreamer::GetOverlappingTriangles(CollisionShape* shape) {
+        std::vector<Triangle> overlapping;
+
+        // In squares, not world units.
+        const float cellSize = m_Tiles.GetCellSize();
+        const int xPos = shape->pos.x / cellSize;
+        const int zPos = shape->pos.z / cellSize;
+
+        int extent = 1;
+        if (shape->shape == CollisionShape::Shape::Sphere)
+            extent += (int)(reinterpret_cast<Sphere*>(shape)->radius / cellSize);
+
+        const int tileSize = static_cast<int>(m_Tiles.GetTileSize());
+        const int tilesX = static_cast<int>(m_Tiles.GetTilesX());
+        const int squaresX = static_cast<int>(m_Tiles.GetWidth()) - 1;
+        const int squaresZ = static_cast<int>(m_Tiles.GetHeight()) - 1;
+        for (int z = std::max(zPos - extent, 0); z <= std::min(zPos + extent, squaresZ - 1); z++) {
+            for (int x = std::max(xPos - extent, 0); x <= std::min(xPos + extent, squaresX - 1); x++) {
+                auto* tile = m_Resident[(z / tileSize) * tilesX + x / tileSize].get();
+                if (!tile)
+                    continue;
+                auto& bottom = overlapping.emplace_back();
+                auto& top = overlapping.emplace_back();
+                tile->Grid.GetSquare(x % tileSize, z % tileSize, bottom, top);
+            }
+        }
+
+        return overlapping;
+    }
+
+    uint32_t TerrainStreamer::GetQueuedCount() {
+        std::lock_guard lock(m_Mutex);
+        return static_cast<uint32_t>(m_Queue.size());
+    }
+
+    void TerrainStreamer::LoadTiles() {
+        std::unique_lock lock(m_Mutex);
+        while (true) {
+            m_Condition.wait(lock, [this]() { return m_Stop || !m_Queue.empty(); });
+            if (m_Stop)
+                return;
+
+            const uint32_t tile = m_Queue.front();
+            m_Queue.pop_front();
+            m_States[tile] = TileState::Loading;
+
+            lock.unlock();
+            auto loaded = std::make_shared<TerrainTile>(m_Tiles.LoadTile(tile));
+            lock.lock();
+            m_Finished.emplace_back(std::move(loaded));
+        }
+    }
+
+    void TerrainStreamer::Evict(uint32_t tile) {
+        m_ResidentBytes -= m_Resident[tile]->GetBytes();
+        m_ResidentCount--;
+        m_EvictedTotal++;
+        m_Resident[tile].reset();
+        m_States[tile] = TileState::Unloaded;
+        m_Evicted.push_back(tile);
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+#include "TerrainTiles.h"
+
+namespace FLOOF {
+    // Keeps the tiles around the camera and the simulated bodies in memory. Tiles are read and built on
+    // background threads, Update on the main thread decides what is wanted and hands finished tiles over.
+    // Everything but the loading threads runs on the main thread.
+    class TerrainStreamer {
+    public:
+        TerrainStreamer(TerrainTileSet&& tiles, uint32_t threads = 2);
+        ~TerrainStreamer();
+
+        TerrainStreamer(const TerrainStreamer&) = delete;
+        TerrainStreamer& operator = (const TerrainStreamer&) = delete;
+
+        // Queues the tiles under each body and its BodyTileRing neighbours first, then the tiles within
+        // LoadRadius of the camera nearest first, as many as fit in MemoryBudget. Resident tiles that are no
+        // longer wanted are dropped.
+        void Update(const glm::vec3& camera, std::span<const glm::vec3> bodies);
+
+        // Tiles that became resident or were dropped since the last call, for creating and freeing GPU meshes.
+        // A tile can be in both, so take the loaded ones first.
+        std::vector<std::shared_ptr<const TerrainTile>> TakeLoaded();
+        std::vector<uint32_t> TakeEvicted();
+
+        // Triangles of resident tiles under the shape, like TerrainComponent::GetOverlappingTriangles.
+        std::vector<Triangle> GetOverlappingTriangles(CollisionShape* shape);
+
+        const TerrainTileSet& GetTileSet() const { return m_Tiles; }
+        // Bytes of resident tiles. Tiles already being read when they fall out of range are dropped on the
+        // next Update, so this can pass the budget by up to one tile per thread.
+        size_t GetResidentBytes() const { return m_ResidentBytes; }
+        uint32_t GetResidentCount() const { return m_ResidentCount; }
+        uint32_t GetQueuedCount();
+        uint64_t GetLoadedTotal() const { return m_LoadedTotal; }
+        uint64_t GetEvictedTotal() const { return m_EvictedTotal; }
+
+        float LoadRadius{ 512.f };
+        uint32_t BodyTileRing{ 1 };
+        size_t MemoryBudget{ size_t(256) << 20 };
+    private:
+        enum class TileState : uint8_t {
+            Unloaded,
+            Queued,
+            Loading,
+            Resident
+        };
+
+        void LoadTiles();
+        void Evict(uint32_t tile);
+
+        TerrainTileSet m_Tiles;
+        std::vector<std::shared_ptr<TerrainTile>> m_Resident;
+        size_t m_ResidentBytes{ 0 };
+        uint32_t m_ResidentCount{ 0 };
+        uint64_t m_LoadedTotal{ 0 };
+        uint64_t m_EvictedTotal{ 0 };
+
+        // Lowest priority a tile got this Update, negative for tiles under bodies. Infinity when not wanted.
+        std::vector<float> m_Priority;
+        std::vector<std::pair<float, uint32_t>> m_Wanted;
+        std::vector<uint8_t> m_IsWanted;
+
+        std::vector<std::shared_ptr<const TerrainTile>> m_Loaded;
+        std::vector<uint32_t> m_Evicted;
+
+        // Guards everything below.
+        std::mutex m_Mutex;
+        std::condition_variable m_Condition;
+        std::vector<TileState> m_States;
+        std::deque<uint32_t> m_Queue;
+        std::vector<std::shared_ptr<TerrainTile>> m_Finished;
+        bool m_Stop{ false };
+        std::vector<std::thread> m_Threads;
+    };
+}
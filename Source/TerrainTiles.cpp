@@ -0,0 +1,205 @@
+#include "TerrainTiles.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace FLOOF {
+    namespace {
+        constexpr char s_Magic[8]{ 'F', 'L', 'O', 'O', 'F', 'T', 'I', 'L' };
+
+        void StoreVec3(float out[3], const glm::vec3& v) {
+            out[0] = v.x;
+            out[1] = v.y;
+            out[2] = v.z;
+        }
+
+        size_t GetTileBlockSize(const TerrainTileInfo& info) {
+            return static_cast<size_t>(info.SamplesX) * info.SamplesZ * (sizeof(float) + 2 * sizeof(glm::vec3));
+        }
+    }
+
+    size_t TerrainTile::GetBytes() const {
+        return sizeof(TerrainTile) - sizeof(TerrainLodMesh) - sizeof(HeightGrid) + Mesh.GetBytes() + Grid.GetBytes();
+    }
+
+    size_t TerrainTile::GetBytes(const TerrainTileInfo& info) {
+        const size_t samples = static_cast<size_t>(info.SamplesX) * info.SamplesZ;
+        return sizeof(TerrainTile) - sizeof(TerrainLodMesh) + TerrainLodMesh::GetBytes(info.SamplesX, info.SamplesZ)
+            + samples * (sizeof(float) + sizeof(uint32_t));
+    }
+
+    std::string TerrainTileSet::GetTilePath(const std::string& sourcePath) {
+        return std::filesystem::path(sourcePath).replace_extension(".flooftiles").string();
+    }
+
+    bool TerrainTileSet::Open(const std::string& tilePath, uint64_t sourceHash, float cellSize) {
+        Close();
+        if (!m_File.Open(tilePath))
+            return false;
+
+        const uint64_t size = m_File.GetSize();
+        const auto* header = reinterpret_cast<const Header*>(m_File.GetData());
+        if (size < sizeof(Header) || std::memcmp(header->Magic, s_Magic, sizeof(s_Magic)) != 0 || header->Version != Version
+            || header->SourceHash != sourceHash || header->CellSize != cellSize || header->TileSize == 0 || header->Width < 2 || header->Height < 2
+            || !(header->CellSize > 0.f)) {
+            Close();
+            return false;
+        }
+
+        const uint64_t tiles = static_cast<uint64_t>(header->TilesX) * header->TilesZ;
+        if (header->TableOffset % alignof(uint64_t) != 0 || header->TableOffset > size || tiles * sizeof(uint64_t) > size - header->TableOffset) {
+            Close();
+            return false;
+        }
+
+        const auto* table = reinterpret_cast<const uint64_t*>(m_File.GetData() + header->TableOffset);
+        for (uint32_t tile = 0; tile < tiles; tile++) {
+            const auto info = GetTileInfo(header->TileSize, header->TilesX, header->Width, header->Height, tile);
+            if (table[tile] % alignof(float) != 0 || table[tile] > size || GetTileBlockSize(info) > size - table[tile]) {
+                Close();
+                return false;
+            }
+        }
+
+        m_Header = header;
+        m_Table = table;
+        return true;
+    }
+
+    void TerrainTileSet::Close() {
+        m_Header = nullptr;
+        m_Table = nullptr;
+        m_File.Close();
+    }
+
+    TerrainCache::Bounds TerrainTileSet::GetBounds() const {
+        TerrainCache::Bounds bounds;
+        bounds.Min = glm::vec3(m_Header->Min[0], m_Header->Min[1], m_Header->Min[2]);
+        bounds.Max = glm::vec3(m_Header->Max[0], m_Header->Max[1], m_Header->Max[2]);
+        bounds.Offset = glm::vec3(m_Header->Offset[0], m_Header->Offset[1], m_Header->Offset[2]);
+        bounds.Middle = glm::vec3(m_Header->Middle[0], m_Header->Middle[1], m_Header->Middle[2]);
+        return bounds;
+    }
+
+    TerrainTileInfo TerrainTileSet::GetTileInfo(uint32_t tile) const {
+        return GetTileInfo(m_Header->TileSize, m_Header->TilesX, m_Header->Width, m_Header->Height, tile);
+    }
+
+    TerrainTileInfo TerrainTileSet::GetTileInfo(uint32_t tileSize, uint32_t tilesX, uint32_t width, uint32_t height, uint32_t tile) {
+        TerrainTileInfo info;
+        info.X0 = (tile % tilesX) * tileSize;
+        info.Z0 = (tile / tilesX) * tileSize;
+        info.SamplesX = std::min(tileSize, width - 1 - info.X0) + 1;
+        info.SamplesZ = std::min(tileSize, height - 1 - info.Z0) + 1;
+        return info;
+    }
+
+    TerrainTile TerrainTileSet::LoadTile(uint32_t tile) const {
+        TerrainTile out;
+        out.Index = tile;
+        out.Info = GetTileInfo(tile);
+        const auto& info = out.Info;
+
+        const size_t samples = static_cast<size_t>(info.SamplesX) * info.SamplesZ;
+        const uint8_t* block = m_File.GetData() + m_Table[tile];
+        const auto* heights = reinterpret_cast<const float*>(block);
+        const auto* colors = reinterpret_cast<const glm::vec3*>(block + samples * sizeof(float));
+        const auto* normals = reinterpret_cast<const glm::vec3*>(block + samples * (sizeof(float) + sizeof(glm::vec3)));
+
+        out.Grid = HeightGrid(info.SamplesX, info.SamplesZ);
+        out.Grid.OriginX = info.X0;
+        out.Grid.OriginZ = info.Z0;
+        out.Grid.CellSize = m_Header->CellSize;
+        std::copy_n(heights, samples, out.Grid.Heights.begin());
+
+        // Normals come from the file, the tile grid alone would flatten them along the tile border.
+        std::vector<ColorNormalVertex> vertices(samples);
+        for (uint32_t z = 0; z < info.SamplesZ; z++) {
+            for (uint32_t x = 0; x < info.SamplesX; x++) {
+                const size_t i = out.Grid.GetIndex(x, z);
+                auto& vertex = vertices[i];
+                vertex.Pos = out.Grid.GetPosition(x, z);
+                vertex.Color = colors[i];
+                vertex.Normal = normals[i];
+                out.Grid.Colors[i] = HeightGrid::PackColor(colors[i]);
+            }
+        }
+
+        out.Mesh = TerrainLodMesh(vertices, info.SamplesX, info.SamplesZ);
+        return out;
+    }
+
+    bool TerrainTileSet::Write(const std::string& tilePath, const TerrainCache& cache, uint32_t tileSize) {
+        const uint32_t width = cache.GetWidth();
+        const uint32_t height = cache.GetHeight();
+        if (tileSize == 0 || width < 2 || height < 2)
+            return false;
+
+        Header header{};
+        std::memcpy(header.Magic, s_Magic, sizeof(s_Magic));
+        header.Version = Version;
+        header.TileSize = tileSize;
+        header.TilesX = (width - 2) / tileSize + 1;
+        header.TilesZ = (height - 2) / tileSize + 1;
+        header.Width = width;
+        header.Height = height;
+        header.CellSize = cache.GetCellSize();
+        header.SourceHash = cache.GetSourceHash();
+        const auto bounds = cache.GetBounds();
+        StoreVec3(header.Min, bounds.Min);
+        StoreVec3(header.Max, bounds.Max);
+        StoreVec3(header.Offset, bounds.Offset);
+        StoreVec3(header.Middle, bounds.Middle);
+        header.TableOffset = sizeof(Header);
+
+        const uint32_t tiles = header.TilesX * header.TilesZ;
+        std::vector<uint64_t> table(tiles);
+        uint64_t offset = header.TableOffset + tiles * sizeof(uint64_t);
+        for (uint32_t tile = 0; tile < tiles; tile++) {
+            table[tile] = offset;
+            offset += GetTileBlockSize(GetTileInfo(tileSize, header.TilesX, width, height, tile));
+        }
+
+        const std::string tempPath = tilePath + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            if (!file)
+                return false;
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(uint64_t));
+
+            const auto heights = cache.GetHeights();
+            const auto colors = cache.GetColors();
+            const auto normals = cache.GetNormals();
+            std::vector<uint8_t> block;
+            for (uint32_t tile = 0; tile < tiles; tile++) {
+                const auto info = GetTileInfo(tileSize, header.TilesX, width, height, tile);
+                const size_t samples = static_cast<size_t>(info.SamplesX) * info.SamplesZ;
+                block.resize(GetTileBlockSize(info));
+                auto* tileHeights = reinterpret_cast<float*>(block.data());
+                auto* tileColors = reinterpret_cast<glm::vec3*>(block.data() + samples * sizeof(float));
+                auto* tileNormals = reinterpret_cast<glm::vec3*>(block.data() + samples * (sizeof(float) + sizeof(glm::vec3)));
+                for (uint32_t z = 0; z < info.SamplesZ; z++) {
+                    const size_t source = static_cast<size_t>(info.Z0 + z) * width + info.X0;
+                    const size_t target = static_cast<size_t>(z) * info.SamplesX;
+                    std::copy_n(heights.data() + source, info.SamplesX, tileHeights + target);
+                    std::copy_n(colors.data() + source, info.SamplesX, tileColors + target);
+                    std::copy_n(normals.data() + source, info.SamplesX, tileNormals + target);
+                }
+                file.write(reinterpret_cast<const char*>(block.data()), block.size());
+            }
+            if (!file)
+                return false;
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tempPath, tilePath, error);
+        if (error) {
+            std::filesystem::remove(tempPath, error);
+            return false;
+        }
+        return true;
+    }
+}
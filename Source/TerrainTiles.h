@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+#include "HeightGrid.h"
+#include "MappedFile.h"
+#include "TerrainCache.h"
+#include "TerrainLod.h"
+#include "Vertex.h"
+
+namespace FLOOF {
+    // Samples of one tile. Tiles share their border row and column with the next tile, so tile meshes meet
+    // without gaps. X0 and Z0 are the grid coordinates of the first sample.
+    struct TerrainTileInfo {
+        uint32_t X0{ 0 };
+        uint32_t Z0{ 0 };
+        uint32_t SamplesX{ 0 };
+        uint32_t SamplesZ{ 0 };
+    };
+
+    // A tile ready for drawing and collision. Positions are in the same space as the full terrain.
+    struct TerrainTile {
+        uint32_t Index{ 0 };
+        TerrainTileInfo Info;
+        TerrainLodMesh Mesh;
+        // The tile's samples with their origin at (X0, Z0), collision triangles are built from it.
+        HeightGrid Grid;
+
+        size_t GetBytes() const;
+        // What GetBytes returns once a tile with these samples is loaded.
+        static size_t GetBytes(const TerrainTileInfo& info);
+    };
+
+    // A baked terrain cut into fixed size tiles, stored next to the source as .flooftiles. Every tile is one
+    // contiguous block, so loading it touches only its own pages of the memory map.
+    class TerrainTileSet {
+    public:
+        inline static constexpr uint32_t Version = 2;
+        inline static constexpr uint32_t DefaultTileSize = 128;
+
+        // foo.las -> foo.flooftiles
+        static std::string GetTilePath(const std::string& sourcePath);
+
+        // Maps the tiles. Returns false if the file is missing, from another version or was cut from a
+        // different source than sourceHash (TerrainCache::GetSourceHash) or at another cell size.
+        bool Open(const std::string& tilePath, uint64_t sourceHash, float cellSize);
+        void Close();
+        bool IsOpen() const { return m_Header != nullptr; }
+
+        uint32_t GetTileSize() const { return m_Header->TileSize; }
+        uint32_t GetTilesX() const { return m_Header->TilesX; }
+        uint32_t GetTilesZ() const { return m_Header->TilesZ; }
+        uint32_t GetTileCount() const { return m_Header->TilesX * m_Header->TilesZ; }
+        // Samples of the whole grid.
+        uint32_t GetWidth() const { return m_Header->Width; }
+        uint32_t GetHeight() const { return m_Header->Height; }
+        // World units between samples, a tile spans GetTileSize() * GetCellSize() units.
+        float GetCellSize() const { return m_Header->CellSize; }
+        TerrainCache::Bounds GetBounds() const;
+        TerrainTileInfo GetTileInfo(uint32_t tile) const;
+
+        // Copies a tile out of the map and builds its LOD mesh and height grid. Safe to call
+        // from several threads at once.
+        TerrainTile LoadTile(uint32_t tile) const;
+
+        // Cuts a baked terrain into tiles of tileSize squares. Reads the cache through its map and writes one
+        // tile at a time, so the grid is never copied as a whole.
+        static bool Write(const std::string& tilePath, const TerrainCache& cache, uint32_t tileSize = DefaultTileSize);
+    private:
+        struct Header {
+            char Magic[8];
+            uint32_t Version;
+            uint32_t TileSize;
+            uint32_t TilesX;
+            uint32_t TilesZ;
+            uint32_t Width;
+            uint32_t Height;
+            float CellSize;
+            uint32_t Reserved;
+            uint64_t SourceHash;
+            float Min[3];
+            float Max[3];
+            float Offset[3];
+            float Middle[3];
+            // Followed by TilesX * TilesZ offsets to the tile blocks. A block holds the heights, then the
+            // colors, then the normals of its samples.
+            uint64_t TableOffset;
+        };
+        static_assert(sizeof(Header) == 104, "TerrainTileSet::Header must not contain padding");
+
+        static TerrainTileInfo GetTileInfo(uint32_t tileSize, uint32_t tilesX, uint32_t width, uint32_t height, uint32_t tile);
+
+        MappedFile m_File;
+        const Header* m_Header{ nullptr };
+        const uint64_t* m_Table{ nullptr };
+    };
+}
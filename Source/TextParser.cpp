@@ -0,0 +1,36 @@
+#include "TextParser.h"
+
+#include <charconv>
+
+namespace FLOOF {
+    namespace TextParser {
+        const char* ParseFloat(const char* first, const char* last, float& out) {
+            while (first < last && (*first == ' ' || *first == '\t' || *first == ','))
+                first++;
+            // from_chars only takes a sign when it is a minus.
+            if (first < last && *first == '+')
+                first++;
+            const auto [end, error] = std::from_chars(first, last, out);
+            return error == std::errc() ? end : nullptr;
+        }
+
+        const char* ParseUint(const char* first, const char* last, uint32_t& out) {
+            while (first < last && (*first == ' ' || *first == '\t'))
+                first++;
+            const auto [end, error] = std::from_chars(first, last, out);
+            return error == std::errc() ? end : nullptr;
+        }
+
+        std::vector<size_t> SplitLines(std::string_view text, uint32_t workers) {
+            workers = std::max(workers, 1u);
+            std::vector<size_t> starts(workers + 1, text.size());
+            starts.front() = 0;
+            for (uint32_t worker = 1; worker < workers; worker++) {
+                const size_t guess = std::max(text.size() / workers * worker, starts[worker - 1]);
+                const size_t lineBreak = text.find('\n', guess);
+                starts[worker] = lineBreak == std::string_view::npos ? text.size() : lineBreak + 1;
+            }
+            return starts;
+        }
+    }
+}
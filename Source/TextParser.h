@@ -0,0 +1,68 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+#include "Parallel.h"
+
+namespace FLOOF {
+    // Numbers in line based text files like XYZ point exports and .visim, parsed with std::from_chars instead of a
+    // stream per line.
+    namespace TextParser {
+        inline constexpr size_t MinBytesPerWorker = size_t{ 1 } << 20;
+
+        // Skips spaces, tabs and commas, then parses a float. Returns the end of the number, or nullptr if there
+        // is none before last.
+        const char* ParseFloat(const char* first, const char* last, float& out);
+        // Returns the end of the unsigned integer at the start of the text, after spaces and tabs, or nullptr.
+        const char* ParseUint(const char* first, const char* last, uint32_t& out);
+        // Cuts text into workers ranges at line breaks, so every line is in one range. Returns workers + 1 offsets.
+        std::vector<size_t> SplitLines(std::string_view text, uint32_t workers);
+
+        // Calls makeRow(values) with the first Columns numbers of every line and returns the rows in file order.
+        // Lines with fewer than minColumns numbers are skipped, values past the ones a line has are 0 and anything
+        // after the last column is ignored. Ranges of lines are parsed on all workers.
+        template<size_t Columns, typename Row, typename MakeRow>
+        std::vector<Row> ReadRows(std::string_view text, MakeRow&& makeRow, size_t minColumns = Columns) {
+            const uint32_t workers = Parallel::GetWorkerCount(text.size(), MinBytesPerWorker);
+            const std::vector<size_t> starts = SplitLines(text, workers);
+            std::vector<std::vector<Row>> rows(workers);
+            Parallel::For(workers, workers, [&](size_t begin, size_t end, uint32_t) {
+                for (size_t worker = begin; worker < end; worker++) {
+                    const char* cursor = text.data() + starts[worker];
+                    const char* last = text.data() + starts[worker + 1];
+                    while (cursor < last) {
+                        const void* lineBreak = std::memchr(cursor, '\n', static_cast<size_t>(last - cursor));
+                        const char* lineEnd = lineBreak ? static_cast<const char*>(lineBreak) : last;
+                        std::array<float, Columns> values{};
+                        size_t column{ 0 };
+                        for (const char* number = cursor; column < Columns; column++) {
+                            number = ParseFloat(number, lineEnd, values[column]);
+                            if (!number)
+                                break;
+                        }
+                        if (column >= minColumns)
+                            rows[worker].push_back(makeRow(values));
+                        cursor = lineEnd + 1;
+                    }
+                }
+            });
+
+            std::vector<size_t> offsets(workers + 1, 0);
+            for (uint32_t worker = 0; worker < workers; worker++)
+                offsets[worker + 1] = offsets[worker] + rows[worker].size();
+            if (workers == 1)
+                return std::move(rows.front());
+            std::vector<Row> out(offsets.back());
+            Parallel::For(workers, workers, [&](size_t begin, size_t end, uint32_t) {
+                for (size_t worker = begin; worker < end; worker++)
+                    std::copy(rows[worker].begin(), rows[worker].end(), out.begin() + offsets[worker]);
+            });
+            return out;
+        }
+    }
+}
@@ -0,0 +1,260 @@
+#include "TrailPool.h"
+
+#include <cstring>
+#include <algorithm>
+#include "Floof.h"
+
+namespace FLOOF {
+    TrailPool::TrailPool(uint32_t controlPointCapacity, uint32_t verticesPerSlot, uint32_t initialSlotCount)
+        : m_ControlPointCapacity{ controlPointCapacity }
+        , m_VerticesPerSlot{ verticesPerSlot } {
+        ASSERT(controlPointCapacity > 0 && verticesPerSlot > 0 && initialSlotCount > 0);
+        auto* renderer = VulkanRenderer::Get();
+        m_MultiDrawIndirect = renderer->GetPhysicalDeviceFeatures().multiDrawIndirect == VK_TRUE;
+        Grow(initialSlotCount);
+    }
+
+    TrailPool::~TrailPool() {
+        DestroyBuffers();
+    }
+
+    uint32_t TrailPool::Acquire() {
+        if (m_FreeSlots.empty())
+            Grow(GetSlotCount() * 2);
+
+        uint32_t slot = m_FreeSlots.back();
+        m_FreeSlots.pop_back();
+        ClearControlPoints(slot);
+        m_VertexHead[slot] = 0;
+        m_VertexCount[slot] = 0;
+        return slot;
+    }
+
+    void TrailPool::Release(uint32_t slot) {
+        if (slot == InvalidSlot)
+            return;
+        ASSERT(slot < GetSlotCount());
+        ClearControlPoints(slot);
+        m_VertexHead[slot] = 0;
+        m_VertexCount[slot] = 0;
+        m_FreeSlots.push_back(slot);
+    }
+
+    bool TrailPool::PushControlPoint(uint32_t slot, const glm::vec3& point) {
+        auto& head = m_Head[slot];
+        auto& count = m_ControlPointCount[slot];
+
+        uint32_t ringIndex;
+        bool dropped = count == m_ControlPointCapacity;
+        if (!dropped) {
+            ringIndex = (head + count) % m_ControlPointCapacity;
+            count++;
+        } else {
+            ringIndex = head;
+            head = (head + 1) % m_ControlPointCapacity;
+        }
+
+        const size_t i = static_cast<size_t>(slot) * m_ControlPointCapacity + ringIndex;
+        m_X[i] = point.x;
+        m_Y[i] = point.y;
+        m_Z[i] = point.z;
+        m_SpanVertexCount[i] = 0;
+        return dropped;
+    }
+
+    void TrailPool::SetControlPoint(uint32_t slot, uint32_t index, const glm::vec3& point) {
+        ASSERT(index < m_ControlPointCount[slot]);
+        const size_t i = static_cast<size_t>(slot) * m_ControlPointCapacity + GetRingIndex(slot, index);
+        m_X[i] = point.x;
+        m_Y[i] = point.y;
+        m_Z[i] = point.z;
+    }
+
+    void TrailPool::PopControlPoint(uint32_t slot) {
+        if (m_ControlPointCount[slot] == 0)
+            return;
+        m_Head[slot] = (m_Head[slot] + 1) % m_ControlPointCapacity;
+        m_ControlPointCount[slot]--;
+    }
+
+    void TrailPool::ClearControlPoints(uint32_t slot) {
+        m_Head[slot] = 0;
+        m_ControlPointCount[slot] = 0;
+    }
+
+    ColorVertex* TrailPool::MapVertices(uint32_t slot) {
+        ASSERT(slot < GetSlotCount());
+        auto* vertices = reinterpret_cast<ColorVertex*>(m_VertexBuffer.AllocationInfo.pMappedData);
+        return vertices + static_cast<size_t>(slot) * GetSlotStride();
+    }
+
+    void TrailPool::PushVertex(uint32_t slot, const ColorVertex& vertex) {
+        ASSERT(m_VertexCount[slot] < m_VerticesPerSlot);
+        const uint32_t index = (m_VertexHead[slot] + m_VertexCount[slot]) % m_VerticesPerSlot;
+        auto* vertices = MapVertices(slot);
+        vertices[index] = vertex;
+        if (index == 0)
+            vertices[m_VerticesPerSlot] = vertex;
+        m_VertexCount[slot]++;
+    }
+
+    void TrailPool::PopVertices(uint32_t slot, uint32_t count) {
+        count = std::min(count, m_VertexCount[slot]);
+        m_VertexHead[slot] = (m_VertexHead[slot] + count) % m_VerticesPerSlot;
+        m_VertexCount[slot] -= count;
+    }
+
+    void TrailPool::TruncateVertices(uint32_t slot, uint32_t count) {
+        m_VertexCount[slot] = std::min(count, m_VertexCount[slot]);
+    }
+
+    void TrailPool::Draw(VkCommandBuffer commandBuffer) {
+        auto* renderer = VulkanRenderer::Get();
+        auto& indirectBuffer = m_IndirectBuffers[renderer->GetCurrentFrame()];
+        auto* commands = reinterpret_cast<VkDrawIndirectCommand*>(indirectBuffer.AllocationInfo.pMappedData);
+
+        uint32_t drawCount = 0;
+        auto addCommand = [&](uint32_t firstVertex, uint32_t vertexCount) {
+            auto& command = commands[drawCount++];
+            command.vertexCount = vertexCount;
+            command.instanceCount = 1;
+            command.firstVertex = firstVertex;
+            command.firstInstance = 0;
+        };
+
+        for (uint32_t slot = 0; slot < GetSlotCount(); slot++) {
+            const uint32_t count = m_VertexCount[slot];
+            if (count < 2)
+                continue;
+            const uint32_t base = slot * GetSlotStride();
+            const uint32_t head = m_VertexHead[slot];
+            if (head + count <= m_VerticesPerSlot) {
+                addCommand(base + head, count);
+            } else {
+                // Runs through the mirrored vertex, then continues from the start of the slot.
+                const uint32_t tail = m_VerticesPerSlot - head;
+                addCommand(base + head, tail + 1);
+                addCommand(base, count - tail);
+            }
+        }
+
+        if (drawCount == 0)
+            return;
+
+        VkDeviceSize offset{ 0 };
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_VertexBuffer.Buffer, &offset);
+
+        if (m_MultiDrawIndirect) {
+            vkCmdDrawIndirect(commandBuffer, indirectBuffer.Buffer, 0, drawCount, sizeof(VkDrawIndirectCommand));
+        } else {
+            for (uint32_t i = 0; i < drawCount; i++) {
+                vkCmdDraw(commandBuffer, commands[i].vertexCount, 1, commands[i].firstVertex, 0);
+            }
+        }
+    }
+
+    uint32_t TrailPool::GetUsedVertexCount() const {
+        uint32_t count = 0;
+        for (auto vertexCount : m_VertexCount)
+            count += vertexCount;
+        return count;
+    }
+
+    size_t TrailPool::GetGpuMemoryUsage() const {
+        size_t slots = GetSlotCount();
+        return slots * GetSlotStride() * sizeof(ColorVertex)
+            + m_IndirectBuffers.size() * slots * 2 * sizeof(VkDrawIndirectCommand);
+    }
+
+    size_t TrailPool::GetCpuMemoryUsage() const {
+        return (m_X.capacity() + m_Y.capacity() + m_Z.capacity()) * sizeof(float)
+            + (m_SpanVertexCount.capacity() + m_Head.capacity() + m_ControlPointCount.capacity()
+                + m_VertexHead.capacity() + m_VertexCount.capacity() + m_FreeSlots.capacity()) * sizeof(uint32_t);
+    }
+
+    void TrailPool::Grow(uint32_t slotCount) {
+        const uint32_t oldSlotCount = GetSlotCount();
+        ASSERT(slotCount > oldSlotCount);
+
+        const size_t controlPoints = static_cast<size_t>(slotCount) * m_ControlPointCapacity;
+        m_X.resize(controlPoints);
+        m_Y.resize(controlPoints);
+        m_Z.resize(controlPoints);
+        m_SpanVertexCount.resize(controlPoints, 0);
+        m_Head.resize(slotCount, 0);
+        m_ControlPointCount.resize(slotCount, 0);
+        m_VertexHead.resize(slotCount, 0);
+        m_VertexCount.resize(slotCount, 0);
+
+        // Hand out low slots first.
+        for (uint32_t slot = slotCount; slot > oldSlotCount; slot--) {
+            m_FreeSlots.push_back(slot - 1);
+        }
+
+        VulkanBuffer oldVertexBuffer = m_VertexBuffer;
+        std::vector<VulkanBuffer> oldIndirectBuffers = std::move(m_IndirectBuffers);
+
+        CreateVertexBuffer(slotCount);
+        CreateIndirectBuffers(slotCount);
+
+        if (oldVertexBuffer.Buffer != VK_NULL_HANDLE) {
+            auto* renderer = VulkanRenderer::Get();
+            // Old buffers may still be used by frames in flight.
+            renderer->FinishAllFrames();
+            memcpy(m_VertexBuffer.AllocationInfo.pMappedData, oldVertexBuffer.AllocationInfo.pMappedData,
+                static_cast<size_t>(oldSlotCount) * GetSlotStride() * sizeof(ColorVertex));
+            renderer->DestroyVulkanBuffer(&oldVertexBuffer);
+            for (auto& buffer : oldIndirectBuffers)
+                renderer->DestroyVulkanBuffer(&buffer);
+        }
+    }
+
+    void TrailPool::CreateVertexBuffer(uint32_t slotCount) {
+        auto* renderer = VulkanRenderer::Get();
+
+        VkBufferCreateInfo bufCreateInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+        bufCreateInfo.size = static_cast<VkDeviceSize>(slotCount) * GetSlotStride() * sizeof(ColorVertex);
+        bufCreateInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+
+        VmaAllocationCreateInfo allocCreateInfo = {};
+        allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO;
+        allocCreateInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+            VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+        m_VertexBuffer = VulkanBuffer{};
+        vmaCreateBuffer(renderer->m_Allocator, &bufCreateInfo, &allocCreateInfo, &m_VertexBuffer.Buffer,
+            &m_VertexBuffer.Allocation, &m_VertexBuffer.AllocationInfo);
+        ASSERT(m_VertexBuffer.AllocationInfo.pMappedData != nullptr);
+    }
+
+    void TrailPool::CreateIndirectBuffers(uint32_t slotCount) {
+        auto* renderer = VulkanRenderer::Get();
+
+        VkBufferCreateInfo bufCreateInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+        bufCreateInfo.size = static_cast<VkDeviceSize>(slotCount) * 2 * sizeof(VkDrawIndirectCommand);
+        bufCreateInfo.usage = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+
+        VmaAllocationCreateInfo allocCreateInfo = {};
+        allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO;
+        allocCreateInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+            VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+        m_IndirectBuffers.resize(renderer->GetFramesInFlight());
+        for (auto& buffer : m_IndirectBuffers) {
+            buffer = VulkanBuffer{};
+            vmaCreateBuffer(renderer->m_Allocator, &bufCreateInfo, &allocCreateInfo, &buffer.Buffer,
+                &buffer.Allocation, &buffer.AllocationInfo);
+            ASSERT(buffer.AllocationInfo.pMappedData != nullptr);
+        }
+    }
+
+    void TrailPool::DestroyBuffers() {
+        auto* renderer = VulkanRenderer::Get();
+        if (m_VertexBuffer.Buffer != VK_NULL_HANDLE)
+            renderer->DestroyVulkanBuffer(&m_VertexBuffer);
+        for (auto& buffer : m_IndirectBuffers)
+            renderer->DestroyVulkanBuffer(&buffer);
+        m_VertexBuffer = VulkanBuffer{};
+        m_IndirectBuffers.clear();
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "VulkanRenderer.h"
+#include <limits>
+#include <vector>
+
+namespace FLOOF {
+    // Shared storage for all ball trails. Control points live in a CPU-side SoA ring per slot and the
+    // tessellated line strips live in one host-visible vertex buffer split into fixed-size slots.
+    // Each slot's vertices form a ring as well, so trails are extended and trimmed without moving data.
+    // All trails are submitted with a single indirect draw.
+    class TrailPool {
+    public:
+        inline static constexpr uint32_t InvalidSlot = std::numeric_limits<uint32_t>::max();
+
+        TrailPool(uint32_t controlPointCapacity, uint32_t verticesPerSlot, uint32_t initialSlotCount = 64);
+        ~TrailPool();
+        TrailPool(const TrailPool&) = delete;
+        TrailPool& operator = (const TrailPool&) = delete;
+
+        uint32_t Acquire();
+        void Release(uint32_t slot);
+
+        // Appends to the slot's ring. Overwrites the oldest point when the ring is full and returns true if it did.
+        bool PushControlPoint(uint32_t slot, const glm::vec3& point);
+        void SetControlPoint(uint32_t slot, uint32_t index, const glm::vec3& point);
+        // Drops the oldest point.
+        void PopControlPoint(uint32_t slot);
+        void ClearControlPoints(uint32_t slot);
+        // Index 0 is the oldest point still in the ring.
+        glm::vec3 GetControlPoint(uint32_t slot, uint32_t index) const {
+            const size_t i = static_cast<size_t>(slot) * m_ControlPointCapacity + GetRingIndex(slot, index);
+            return glm::vec3(m_X[i], m_Y[i], m_Z[i]);
+        }
+        uint32_t GetControlPointCount(uint32_t slot) const { return m_ControlPointCount[slot]; }
+        uint32_t GetControlPointCapacity() const { return m_ControlPointCapacity; }
+
+        // Number of vertices emitted for the span starting at control point index. Lets the owner trim
+        // the vertex ring when the oldest control point is dropped.
+        uint32_t& SpanVertexCount(uint32_t slot, uint32_t index) {
+            return m_SpanVertexCount[static_cast<size_t>(slot) * m_ControlPointCapacity + GetRingIndex(slot, index)];
+        }
+
+        void PushVertex(uint32_t slot, const ColorVertex& vertex);
+        // Drops the oldest vertices.
+        void PopVertices(uint32_t slot, uint32_t count);
+        // Keeps the oldest count vertices and drops the rest.
+        void TruncateVertices(uint32_t slot, uint32_t count);
+        uint32_t GetVertexCount(uint32_t slot) const { return m_VertexCount[slot]; }
+        uint32_t GetVerticesPerSlot() const { return m_VerticesPerSlot; }
+
+        // Draws every slot with vertices. Expects a line strip pipeline to be bound.
+        void Draw(VkCommandBuffer commandBuffer);
+
+        uint32_t GetSlotCount() const { return static_cast<uint32_t>(m_VertexCount.size()); }
+        uint32_t GetActiveSlotCount() const { return GetSlotCount() - static_cast<uint32_t>(m_FreeSlots.size()); }
+        uint32_t GetUsedVertexCount() const;
+        size_t GetGpuMemoryUsage() const;
+        size_t GetCpuMemoryUsage() const;
+    private:
+        uint32_t GetRingIndex(uint32_t slot, uint32_t index) const { return (m_Head[slot] + index) % m_ControlPointCapacity; }
+        // One extra vertex per slot mirrors vertex 0, so a strip that wraps around stays connected.
+        uint32_t GetSlotStride() const { return m_VerticesPerSlot + 1; }
+        ColorVertex* MapVertices(uint32_t slot);
+
+        void Grow(uint32_t slotCount);
+        void CreateVertexBuffer(uint32_t slotCount);
+        void CreateIndirectBuffers(uint32_t slotCount);
+        void DestroyBuffers();
+
+        const uint32_t m_ControlPointCapacity;
+        const uint32_t m_VerticesPerSlot;
+
+        // Control point ring, SoA. Slot s owns [s * capacity, (s + 1) * capacity).
+        std::vector<float> m_X;
+        std::vector<float> m_Y;
+        std::vector<float> m_Z;
+        std::vector<uint32_t> m_SpanVertexCount;
+        std::vector<uint32_t> m_Head;
+        std::vector<uint32_t> m_ControlPointCount;
+
+        std::vector<uint32_t> m_VertexHead;
+        std::vector<uint32_t> m_VertexCount;
+        std::vector<uint32_t> m_FreeSlots;
+
+        VulkanBuffer m_VertexBuffer{};
+        // One indirect buffer per frame in flight so the CPU never writes commands the GPU is reading.
+        // A wrapped slot needs two commands.
+        std::vector<VulkanBuffer> m_IndirectBuffers;
+        bool m_MultiDrawIndirect{ false };
+    };
+}
@@ -2,40 +2,49 @@
 
 #include "Floof.h"
 
-#include <fstream>
+#include <algorithm>
 #include <string>
-#include <sstream>
+#include <string_view>
 
 #include "LoggerMacros.h"
+#include "MappedFile.h"
 #include "ObjLoader.h"
+#include "TextParser.h"
 
 
 namespace FLOOF {
     namespace Utils {
         static void SubDivide(glm::vec3& a, glm::vec3& b, glm::vec3& c, int recursions, std::vector<FLOOF::MeshVertex>& vertexData, float radius);
 
-        std::vector<MeshVertex> GetVisimVertexData(const std::string& path) {
-            std::vector<MeshVertex> vertexData;
+        // A .visim file is a count on the first line and then one "x y z ..." line per vertex. Returns the lines
+        // after the count, they stay valid while file is open.
+        static bool OpenVisim(const std::string& path, MappedFile& file, uint32_t& count, std::string_view& lines) {
+            if (!file.Open(path))
+                return false;
+            const std::string_view text(reinterpret_cast<const char*>(file.GetData()), file.GetSize());
+            const size_t headerEnd = std::min(text.find('\n'), text.size());
+            count = 0;
+            TextParser::ParseUint(text.data(), text.data() + headerEnd, count);
+            lines = text.substr(std::min(headerEnd + 1, text.size()));
+            return true;
+        }
 
-            std::ifstream file(path);
-            if (!file.is_open()) {
+        std::vector<MeshVertex> GetVisimVertexData(const std::string& path) {
+            MappedFile file;
+            uint32_t vertexCount{};
+            std::string_view lines;
+            if (!OpenVisim(path, file, vertexCount, lines)) {
                 std::cout << "Cant open file: " << path << std::endl;
-                return vertexData;
+                return {};
             }
 
-            uint32_t vertexCount{};
-            file >> vertexCount;
-            std::string s;
-            std::getline(file, s);
+            // Every line is a vertex, even a short or blank one, so it can not shift the vertices after it.
+            auto vertexData = TextParser::ReadRows<3, MeshVertex>(lines, [](const std::array<float, 3>& values) {
+                MeshVertex vertex{};
+                vertex.Pos = glm::vec3(values[0], values[1], values[2]);
+                return vertex;
+            }, 0);
             vertexData.resize(vertexCount);
-            for (MeshVertex& vertex : vertexData) {
-                std::string line;
-                std::getline(file, line);
-                std::stringstream ss(line);
-                ss >> vertex.Pos.x;
-                ss >> vertex.Pos.y;
-                ss >> vertex.Pos.z;
-            }
 
             for (uint32_t i = 2; i < vertexData.size(); i += 3) {
                 MeshVertex& a = vertexData[i - 2];
@@ -163,20 +172,21 @@ namespace FLOOF {
 
         std::vector<Triangle> GetVisimTriangles(const std::string& path) {
 
-            std::ifstream file(path);
-            if (!file.is_open()) {
+            MappedFile file;
+            uint32_t vertexCount{};
+            std::string_view lines;
+            if (!OpenVisim(path, file, vertexCount, lines)) {
                 std::string msg = path;
                 msg += " could not open";
                 LOG_ERROR(msg.c_str());
                 return {};
             }
-            std::string line;
-            std::getline(file, line);
-            std::stringstream ss(line);
-            int tricount;
-            ss >> tricount;
-            tricount = tricount / 3;
-            std::vector<Triangle> triangles(tricount);
+            // The friction of a triangle follows the position of its last vertex. Every line is a vertex, even a
+            // short or blank one, so it can not shift the triangles after it.
+            const auto rows = TextParser::ReadRows<4, glm::vec4>(lines, [](const std::array<float, 4>& values) {
+                return glm::vec4(values[0], values[1], values[2], values[3]);
+            }, 0);
+            std::vector<Triangle> triangles(std::min<size_t>(vertexCount, rows.size()) / 3);
 
             auto calcNormal = [](Triangle& triangle) {
                 auto ab = triangle.A - triangle.B;
@@ -184,33 +194,12 @@ namespace FLOOF {
                 triangle.N = glm::normalize(glm::cross(ab, ac));
             };
 
-            for (auto& tri : triangles) {
-                {
-                    std::string line;
-                    std::getline(file, line);
-                    std::stringstream ss(line);
-                    ss >> tri.A.x;
-                    ss >> tri.A.y;
-                    ss >> tri.A.z;
-                }
-                {
-                    std::string line;
-                    std::getline(file, line);
-                    std::stringstream ss(line);
-                    ss >> tri.B.x;
-                    ss >> tri.B.y;
-                    ss >> tri.B.z;
-                }
-                {
-                    std::string line;
-                    std::getline(file, line);
-                    std::stringstream ss(line);
-                    ss >> tri.C.x;
-                    ss >> tri.C.y;
-                    ss >> tri.C.z;
-
-                    ss >> tri.FrictionConstant;
-                }
+            for (size_t i = 0; i < triangles.size(); i++) {
+                auto& tri = triangles[i];
+                tri.A = glm::vec3(rows[i * 3]);
+                tri.B = glm::vec3(rows[i * 3 + 1]);
+                tri.C = glm::vec3(rows[i * 3 + 2]);
+                tri.FrictionConstant = rows[i * 3 + 2].w;
 
                 calcNormal(tri);
             }
@@ -5,6 +5,8 @@
 #include <functional>
 
 #include "Math.h"
+#include "glm/ext/vector_uint3_sized.hpp"
+#include "glm/ext/vector_uint4_sized.hpp"
 
 namespace FLOOF {
     struct MeshVertex {
@@ -125,6 +127,72 @@ namespace FLOOF {
         }
     };
 
+    // ColorVertex in 12 bytes instead of 24. Pos.xyz are steps on a 16-bit grid over a box, the box matrix in
+    // front of the MVP takes them back, see Quantize::Box. Pos.w and the alpha are unused.
+    struct QuantizedColorVertex {
+        glm::u16vec4 Pos{};
+        glm::u8vec4 Color{};
+
+        static VkVertexInputBindingDescription GetBindingDescription() {
+            VkVertexInputBindingDescription bindingDescription{};
+
+            bindingDescription.binding = 0;
+            bindingDescription.stride = sizeof(QuantizedColorVertex);
+            bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+            return bindingDescription;
+        }
+
+        static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions() {
+            std::vector<VkVertexInputAttributeDescription> attributeDescriptions(2);
+
+            attributeDescriptions[0].binding = 0;
+            attributeDescriptions[0].location = 0;
+            attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UINT;
+            attributeDescriptions[0].offset = offsetof(QuantizedColorVertex, Pos);
+
+            attributeDescriptions[1].binding = 0;
+            attributeDescriptions[1].location = 1;
+            attributeDescriptions[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+            attributeDescriptions[1].offset = offsetof(QuantizedColorVertex, Color);
+
+            return attributeDescriptions;
+        }
+    };
+
+    // ColorNormalVertex in 12 bytes instead of 36. Positions as in QuantizedColorVertex, the octahedral normal
+    // of Quantize::EncodeNormal goes in PosNormal.w.
+    struct QuantizedColorNormalVertex {
+        glm::u16vec4 PosNormal{};
+        glm::u8vec4 Color{};
+
+        static VkVertexInputBindingDescription GetBindingDescription() {
+            VkVertexInputBindingDescription bindingDescription{};
+
+            bindingDescription.binding = 0;
+            bindingDescription.stride = sizeof(QuantizedColorNormalVertex);
+            bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+            return bindingDescription;
+        }
+
+        static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions() {
+            std::vector<VkVertexInputAttributeDescription> attributeDescriptions(2);
+
+            attributeDescriptions[0].binding = 0;
+            attributeDescriptions[0].location = 0;
+            attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UINT;
+            attributeDescriptions[0].offset = offsetof(QuantizedColorNormalVertex, PosNormal);
+
+            attributeDescriptions[1].binding = 0;
+            attributeDescriptions[1].location = 1;
+            attributeDescriptions[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+            attributeDescriptions[1].offset = offsetof(QuantizedColorNormalVertex, Color);
+
+            return attributeDescriptions;
+        }
+    };
+
     struct NormalVertex {
         glm::vec3 Pos{};
         glm::vec3 Normal{};
@@ -49,6 +49,19 @@ namespace FLOOF {
             params.PushConstantSize = sizeof(MeshPushConstants);
             InitGraphicsPipeline(params);
         }
+        {	// Lit color shader for quantized terrain.
+            RenderPipelineParams params;
+            params.Flags = RenderPipelineFlags::AlphaBlend | RenderPipelineFlags::DepthPass;
+            params.FragmentPath = "Shaders/LitColor.frag.spv";
+            params.VertexPath = "Shaders/QuantizedLitColor.vert.spv";
+            params.Key = RenderPipelineKeys::QuantizedLitColor;
+            params.PolygonMode = VK_POLYGON_MODE_FILL;
+            params.Topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+            params.BindingDescription = QuantizedColorNormalVertex::GetBindingDescription();
+            params.AttributeDescriptions = QuantizedColorNormalVertex::GetAttributeDescriptions();
+            params.PushConstantSize = sizeof(MeshPushConstants);
+            InitGraphicsPipeline(params);
+        }
         {	// Line drawing shader
             RenderPipelineParams params;
             params.Flags = RenderPipelineFlags::AlphaBlend;
@@ -114,6 +127,19 @@ namespace FLOOF {
             params.PushConstantSize = sizeof(ColorPushConstants);
             InitGraphicsPipeline(params);
         }
+        {	// Point drawing shader for quantized point clouds
+            RenderPipelineParams params;
+            params.Flags = RenderPipelineFlags::AlphaBlend | RenderPipelineFlags::DepthPass;
+            params.FragmentPath = "Shaders/Color.frag.spv";
+            params.VertexPath = "Shaders/QuantizedColor.vert.spv";
+            params.Key = RenderPipelineKeys::QuantizedPoint;
+            params.PolygonMode = VK_POLYGON_MODE_POINT;
+            params.Topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+            params.BindingDescription = QuantizedColorVertex::GetBindingDescription();
+            params.AttributeDescriptions = QuantizedColorVertex::GetAttributeDescriptions();
+            params.PushConstantSize = sizeof(ColorPushConstants);
+            InitGraphicsPipeline(params);
+        }
         {	// Debug shader for normals
             RenderPipelineParams params;
             params.Flags = RenderPipelineFlags::DepthPass;
@@ -138,6 +164,10 @@ namespace FLOOF {
     VulkanRenderer::~VulkanRenderer() {
         vkDestroyImageView(m_LogicalDevice, m_DepthBufferImageView, nullptr);
         vmaDestroyImage(m_Allocator, m_DepthBuffer.Image, m_DepthBuffer.Allocation);
+        for (auto& stagingBuffers : m_UploadStagingBuffers) {
+            for (auto& buffer : stagingBuffers)
+                vmaDestroyBuffer(m_Allocator, buffer.Buffer, buffer.Allocation);
+        }
         vmaDestroyAllocator(m_Allocator);
         CleanupSwapChain();
 
@@ -184,6 +214,12 @@ namespace FLOOF {
     VkCommandBuffer VulkanRenderer::StartRecording() {
         m_CurrentImageIndex = GetNextSwapchainImage();
 
+        // The fence is signaled, so the uploads this frame slot submitted last time are done.
+        for (auto& buffer : m_UploadStagingBuffers[m_CurrentFrame])
+            vmaDestroyBuffer(m_Allocator, buffer.Buffer, buffer.Allocation);
+        m_UploadStagingBuffers[m_CurrentFrame].clear();
+        m_UploadRecording[m_CurrentFrame] = 0;
+
         vkResetCommandBuffer(m_CommandBuffers[m_CurrentFrame], 0);
 
         VkCommandBufferBeginInfo beginInfo{};
@@ -250,8 +286,20 @@ namespace FLOOF {
         submitInfo.waitSemaphoreCount = 1;
         submitInfo.pWaitSemaphores = waitSemaphores;
         submitInfo.pWaitDstStageMask = waitStages;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &m_CommandBuffers[m_CurrentFrame];
+        // Queued uploads go first, the barrier makes their writes visible to the frame's vertex input.
+        VkCommandBuffer commandBuffers[] = { m_UploadCommandBuffers[m_CurrentFrame], m_CommandBuffers[m_CurrentFrame] };
+        const bool uploading = m_UploadRecording[m_CurrentFrame] != 0;
+        if (uploading) {
+            VkMemoryBarrier barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+            vkCmdPipelineBarrier(commandBuffers[0], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0,
+                1, &barrier, 0, nullptr, 0, nullptr);
+            VkResult endResult = vkEndCommandBuffer(commandBuffers[0]);
+            ASSERT(endResult == VK_SUCCESS);
+        }
+        submitInfo.commandBufferCount = uploading ? 2 : 1;
+        submitInfo.pCommandBuffers = uploading ? commandBuffers : &commandBuffers[1];
         submitInfo.signalSemaphoreCount = 1;
         submitInfo.pSignalSemaphores = signalSemaphores;
 
@@ -430,6 +478,47 @@ namespace FLOOF {
         vkFreeCommandBuffers(m_LogicalDevice, m_CommandPool, 1, &commandBuffer);
     }
 
+    VulkanBuffer VulkanRenderer::QueueBufferUpload(const void* data, VkDeviceSize size, VkBufferUsageFlags usage) {
+        VkBufferCreateInfo bufferInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+        bufferInfo.size = size;
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VmaAllocationCreateInfo allocInfo = {};
+        allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+        allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+            VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+        VulkanBuffer stagingBuffer{};
+        vmaCreateBuffer(m_Allocator, &bufferInfo, &allocInfo,
+            &stagingBuffer.Buffer, &stagingBuffer.Allocation, &stagingBuffer.AllocationInfo);
+        memcpy(stagingBuffer.AllocationInfo.pMappedData, data, size);
+        m_UploadStagingBuffers[m_CurrentFrame].push_back(stagingBuffer);
+
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage;
+        allocInfo.flags = 0;
+        VulkanBuffer buffer{};
+        vmaCreateBuffer(m_Allocator, &bufferInfo, &allocInfo,
+            &buffer.Buffer, &buffer.Allocation, &buffer.AllocationInfo);
+
+        VkCommandBuffer commandBuffer = m_UploadCommandBuffers[m_CurrentFrame];
+        if (!m_UploadRecording[m_CurrentFrame]) {
+            vkResetCommandBuffer(commandBuffer, 0);
+            VkCommandBufferBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            VkResult beginResult = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+            ASSERT(beginResult == VK_SUCCESS);
+            m_UploadRecording[m_CurrentFrame] = 1;
+        }
+
+        VkBufferCopy copyRegion{};
+        copyRegion.size = size;
+        vkCmdCopyBuffer(commandBuffer, stagingBuffer.Buffer, buffer.Buffer, 1, &copyRegion);
+
+        return buffer;
+    }
+
     void VulkanRenderer::DestroyVulkanBuffer(VulkanBuffer* buffer) {
         vmaDestroyBuffer(m_Allocator, buffer->Buffer, buffer->Allocation);
     }
@@ -980,6 +1069,12 @@ namespace FLOOF {
 
         VkResult result = vkAllocateCommandBuffers(m_LogicalDevice, &allocInfo, m_CommandBuffers.data());
         ASSERT(result == VK_SUCCESS);
+
+        m_UploadCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+        m_UploadRecording.resize(MAX_FRAMES_IN_FLIGHT, 0);
+        m_UploadStagingBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+        result = vkAllocateCommandBuffers(m_LogicalDevice, &allocInfo, m_UploadCommandBuffers.data());
+        ASSERT(result == VK_SUCCESS);
         LOG("Command buffer created.\n");
     }
 
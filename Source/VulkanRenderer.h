@@ -2,6 +2,7 @@
 #define GLFW_INCLUDE_VULKAN
 #define VK_ENABLE_BETA_EXTENSIONS
 #include <GLFW/glfw3.h>
+#include <span>
 #include <vector>
 
 #include "Math.h"
@@ -66,6 +67,8 @@ namespace FLOOF {
         LineWithDepth,
         LineStripWithDepth,
         LitColor,
+        QuantizedLitColor,
+        QuantizedPoint,
     };
 
     inline RenderPipelineFlags operator | (RenderPipelineFlags lhs, RenderPipelineFlags rhs) {
@@ -98,6 +101,8 @@ namespace FLOOF {
         friend class MeshComponent;
         friend class LineMeshComponent;
         friend class PointCloudComponent;
+        friend struct TerrainLodComponent;
+        friend class TrailPool;
     public:
         VulkanRenderer(GLFWwindow* window);
         ~VulkanRenderer();
@@ -114,12 +119,19 @@ namespace FLOOF {
         VkRenderPass GetImguiRenderPass();
 
         void FinishAllFrames();
+        const VkPhysicalDeviceFeatures& GetPhysicalDeviceFeatures() const { return m_PhysicalDeviceFeatures; }
+        uint32_t GetCurrentFrame() const { return m_CurrentFrame; }
+        uint32_t GetFramesInFlight() const { return static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT); }
         VkPipelineLayout BindGraphicsPipeline(VkCommandBuffer cmdBuffer, RenderPipelineKeys Key);
 
         static VulkanRenderer* Get() { return s_Singleton; }
 
         template<typename VertexType>
         VulkanBuffer CreateVertexBuffer(const std::vector<VertexType>& vertices) {
+            return CreateVertexBuffer(std::span<const VertexType>(vertices));
+        }
+        template<typename VertexType>
+        VulkanBuffer CreateVertexBuffer(std::span<const VertexType> vertices) {
             std::size_t size = sizeof(VertexType) * vertices.size();
             VkBufferCreateInfo bufferInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
             bufferInfo.size = size;
@@ -151,9 +163,17 @@ namespace FLOOF {
 
             return vertexBuffer;
         }
+        // Like CreateVertexBuffer, but the copy is recorded into this frame's upload commands and submitted ahead
+        // of the frame instead of waiting for the queue. Only between StartRecording and SubmitAndPresent, the
+        // buffer can be drawn in the same frame.
+        template<typename VertexType>
+        VulkanBuffer QueueVertexBuffer(std::span<const VertexType> vertices) {
+            return QueueBufferUpload(vertices.data(), sizeof(VertexType) * vertices.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+        }
         VulkanBuffer CreateIndexBuffer(const std::vector<uint32_t>& indices);
         void DestroyVulkanBuffer(VulkanBuffer* buffer);
     private:
+        VulkanBuffer QueueBufferUpload(const void* data, VkDeviceSize size, VkBufferUsageFlags usage);
         inline static VulkanRenderer* s_Singleton = nullptr;
 
         void CopyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize size);
@@ -239,6 +259,11 @@ namespace FLOOF {
         std::unordered_map<RenderPipelineKeys, VkPipeline> m_GraphicsPipelines;
         VkCommandPool m_CommandPool;
         std::vector<VkCommandBuffer> m_CommandBuffers;
+        // Copies queued during a frame, submitted in front of its command buffer. Staging buffers are freed once
+        // the frame's fence has signaled.
+        std::vector<VkCommandBuffer> m_UploadCommandBuffers;
+        std::vector<uint8_t> m_UploadRecording;
+        std::vector<std::vector<VulkanBuffer>> m_UploadStagingBuffers;
 
     public:
         VkDescriptorSet AllocateTextureDescriptorSet();